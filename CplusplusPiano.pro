@@ -2,11 +2,6 @@ QT += core widgets
 
 CONFIG += c++17 sdk_no_version_check
 
-# Core Audio (macOS native)
-macx {
-    LIBS += -framework CoreAudio -framework AudioToolbox -framework AudioUnit
-}
-
 TARGET = CplusplusPiano
 TEMPLATE = app
 
@@ -19,6 +14,15 @@ SOURCES += \
 HEADERS += \
     src/mainwindow.h
 
+# Sound engine
+include(src/engine.pri)
+
+# Audio output (Core Audio, ALSA, JACK, null/file)
+include(src/audio.pri)
+
+# MIDI input (ALSA sequencer, virtual)
+include(src/midi.pri)
+
 # Resources (optional - for icons, sounds, etc.)
 # RESOURCES +=
 
@@ -15,6 +15,10 @@ make
 echo "✅ Build complete!"
 echo "🎹 Launching Virtual Piano..."
 
-# Run the application
-./build/CplusplusPiano.app/Contents/MacOS/CplusplusPiano
+# Run the application (options such as --audio are passed through)
+if [ "$(uname)" = "Darwin" ]; then
+    ./build/CplusplusPiano.app/Contents/MacOS/CplusplusPiano "$@"
+else
+    ./build/CplusplusPiano "$@"
+fi
 
@@ -0,0 +1,141 @@
+#include "alsabackend.h"
+#include "pianoengine.h"
+
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+static bool fail(std::string *errorMessage, const std::string &message, int err = 0)
+{
+    if (errorMessage) {
+        *errorMessage = err == 0 ? message : message + ": " + snd_strerror(err);
+    }
+    return false;
+}
+
+AlsaBackend::AlsaBackend()
+    : pcm(nullptr), running(false), underruns(0)
+{
+}
+
+AlsaBackend::~AlsaBackend()
+{
+    stop();
+}
+
+bool AlsaBackend::open(const AudioSettings &requested, std::string *errorMessage)
+{
+    stop();
+    current = requested;
+    current.backend = name();
+    const std::string device = current.device.empty() ? "default" : current.device;
+    int err = snd_pcm_open(&pcm, device.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+        pcm = nullptr;
+        return fail(errorMessage, "Failed to open ALSA device '" + device + "'", err);
+    }
+
+    // Hardware parameters: whatever is nearest to the request, then read back
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_hw_params_alloca(&hw);
+    unsigned int rate = static_cast<unsigned int>(current.sampleRate);
+    snd_pcm_uframes_t periodFrames = static_cast<snd_pcm_uframes_t>(current.bufferFrames);
+    unsigned int periods = static_cast<unsigned int>(current.periods);
+    if ((err = snd_pcm_hw_params_any(pcm, hw)) < 0 ||
+        (err = snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0 ||
+        (err = snd_pcm_hw_params_set_format(pcm, hw, SND_PCM_FORMAT_S16)) < 0 ||
+        (err = snd_pcm_hw_params_set_channels(pcm, hw, static_cast<unsigned int>(current.channels))) < 0 ||
+        (err = snd_pcm_hw_params_set_rate_near(pcm, hw, &rate, nullptr)) < 0 ||
+        (err = snd_pcm_hw_params_set_period_size_near(pcm, hw, &periodFrames, nullptr)) < 0 ||
+        (err = snd_pcm_hw_params_set_periods_near(pcm, hw, &periods, nullptr)) < 0 ||
+        (err = snd_pcm_hw_params(pcm, hw)) < 0) {
+        close();
+        return fail(errorMessage, "Unsupported ALSA settings for '" + device + "'", err);
+    }
+    current.sampleRate = static_cast<int>(rate);
+    current.bufferFrames = static_cast<int>(periodFrames);
+    current.periods = static_cast<int>(periods);
+
+    // Start once the whole buffer is queued, wake up whenever a period is free
+    snd_pcm_sw_params_t *sw;
+    snd_pcm_sw_params_alloca(&sw);
+    if ((err = snd_pcm_sw_params_current(pcm, sw)) < 0 ||
+        (err = snd_pcm_sw_params_set_start_threshold(pcm, sw, periodFrames * periods)) < 0 ||
+        (err = snd_pcm_sw_params_set_avail_min(pcm, sw, periodFrames)) < 0 ||
+        (err = snd_pcm_sw_params(pcm, sw)) < 0) {
+        close();
+        return fail(errorMessage, "Failed to set ALSA software parameters", err);
+    }
+
+    buffer.assign(static_cast<std::size_t>(current.bufferFrames) * current.channels, 0);
+    return true;
+}
+
+bool AlsaBackend::start(PianoEngine *engine, std::string *errorMessage)
+{
+    if (!pcm) {
+        return fail(errorMessage, "The alsa backend is not open");
+    }
+    if (running.load()) {
+        return true;
+    }
+    running.store(true);
+    resetCounters();
+    underruns.store(0, std::memory_order_relaxed);
+    thread = std::thread(&AlsaBackend::run, this, engine);
+    return true;
+}
+
+void AlsaBackend::stop()
+{
+    running.store(false);
+    if (thread.joinable()) {
+        thread.join();  // snd_pcm_writei returns within a period
+    }
+    close();
+}
+
+void AlsaBackend::close()
+{
+    if (pcm) {
+        snd_pcm_drop(pcm);
+        snd_pcm_close(pcm);
+        pcm = nullptr;
+    }
+}
+
+void AlsaBackend::run(PianoEngine *engine)
+{
+    // A high real-time priority, above the render pool's workers; needs permission (an rtprio
+    // limit, or root) - without it the thread stays at normal priority
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 10;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    const snd_pcm_uframes_t periodFrames = static_cast<snd_pcm_uframes_t>(current.bufferFrames);
+    while (running.load(std::memory_order_relaxed)) {
+        renderBuffer(engine, buffer.data(), current.bufferFrames);
+        const std::int16_t *out = buffer.data();
+        snd_pcm_uframes_t remaining = periodFrames;
+        while (remaining > 0 && running.load(std::memory_order_relaxed)) {
+            const snd_pcm_sframes_t written = snd_pcm_writei(pcm, out, remaining);
+            if (written < 0) {
+                // -EPIPE is an underrun; recover (re-prepare or resume) and write the period again
+                if (written == -EPIPE) {
+                    underruns.fetch_add(1, std::memory_order_relaxed);
+                }
+                const int err = snd_pcm_recover(pcm, static_cast<int>(written), 1);
+                if (err < 0) {
+                    // Gone for good (a device unplugged, say): stop, and leave the why for failed()
+                    std::string message;
+                    fail(&message, "ALSA output stopped: could not recover from a write error", err);
+                    deviceFailed(message);
+                    running.store(false);
+                }
+                continue;
+            }
+            out += written * current.channels;
+            remaining -= static_cast<snd_pcm_uframes_t>(written);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef ALSABACKEND_H
+#define ALSABACKEND_H
+
+#include "audiobackend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+typedef struct _snd_pcm snd_pcm_t;
+
+// Linux output through an ALSA PCM ("default", or settings().device such as "hw:1,0"):
+// 16-bit interleaved, the rate, period size and period count set as near to the request
+// as the device allows. A real-time thread renders one period at a time and blocks in
+// snd_pcm_writei until the device has room for it; underruns are recovered and counted,
+// and an error it can't recover from stops the thread and is reported through failed().
+class AlsaBackend : public AudioBackend {
+public:
+    AlsaBackend();
+    ~AlsaBackend() override;
+
+    const char *name() const override { return "alsa"; }
+    bool open(const AudioSettings &requested, std::string *errorMessage = nullptr) override;
+    bool start(PianoEngine *engine, std::string *errorMessage = nullptr) override;
+    void stop() override;
+
+    // Device underruns recovered from
+    std::uint64_t xrunCount() const override { return underruns.load(std::memory_order_relaxed); }
+
+private:
+    void run(PianoEngine *engine);
+    void close();
+
+    snd_pcm_t *pcm;
+    std::vector<std::int16_t> buffer;  // One period, interleaved
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<std::uint64_t> underruns;
+};
+
+#endif // ALSABACKEND_H
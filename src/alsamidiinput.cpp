@@ -0,0 +1,262 @@
+#include "alsamidiinput.h"
+#include "noteeventqueue.h"
+
+#include <alsa/asoundlib.h>
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <vector>
+
+static bool fail(std::string *errorMessage, const std::string &message, int err = 0)
+{
+    if (errorMessage) {
+        *errorMessage = err == 0 ? message : message + ": " + snd_strerror(err);
+    }
+    return false;
+}
+
+AlsaMidiInput::AlsaMidiInput()
+    : seq(nullptr), port(-1), queue(-1), running(false), overruns(0), clockOffset(0), clockKnown(false), lastTime(0)
+{
+    wakePipe[0] = wakePipe[1] = -1;
+}
+
+AlsaMidiInput::~AlsaMidiInput()
+{
+    stop();
+}
+
+bool AlsaMidiInput::start(PianoEngine *target, const std::string &source, std::string *errorMessage)
+{
+    stop();
+    if (!target) {
+        return fail(errorMessage, "No engine for the ALSA MIDI input");
+    }
+    engine = target;
+    int err = snd_seq_open(&seq, "default", SND_SEQ_OPEN_DUPLEX, SND_SEQ_NONBLOCK);
+    if (err < 0) {
+        seq = nullptr;
+        return fail(errorMessage, "Failed to open the ALSA sequencer", err);
+    }
+    snd_seq_set_client_name(seq, "CplusplusPiano");
+
+    // A queue of our own, only to have the sequencer time stamp incoming events
+    if ((queue = snd_seq_alloc_named_queue(seq, "CplusplusPiano")) < 0) {
+        err = queue;
+        close();
+        return fail(errorMessage, "Failed to create an ALSA sequencer queue", err);
+    }
+
+    // The input port, open to any source; events sent to it are stamped on arrival
+    snd_seq_port_info_t *info;
+    snd_seq_port_info_alloca(&info);
+    snd_seq_port_info_set_name(info, "MIDI In");
+    snd_seq_port_info_set_capability(info, SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE);
+    snd_seq_port_info_set_type(info, SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    snd_seq_port_info_set_timestamping(info, 1);
+    snd_seq_port_info_set_timestamp_real(info, 1);
+    snd_seq_port_info_set_timestamp_queue(info, queue);
+    if ((err = snd_seq_create_port(seq, info)) < 0 || (err = snd_seq_start_queue(seq, queue, nullptr)) < 0 ||
+        (err = snd_seq_drain_output(seq)) < 0) {
+        close();
+        return fail(errorMessage, "Failed to set up the ALSA MIDI input port", err);
+    }
+    port = snd_seq_port_info_get_port(info);
+    clockKnown = false;
+    lastTime = 0;
+    sourceNames = "ALSA sequencer port " + std::to_string(snd_seq_client_id(seq)) + ":" + std::to_string(port);
+
+    if (source.empty()) {
+        connectHardwareSources(errorMessage);
+    } else {
+        snd_seq_addr_t address;
+        if ((err = snd_seq_parse_address(seq, &address, source.c_str())) < 0) {
+            close();
+            return fail(errorMessage, "No ALSA MIDI source '" + source + "'", err);
+        }
+        if (!connect(address.client, address.port, errorMessage)) {
+            close();
+            return false;
+        }
+        sourceNames += " <- " + source;
+    }
+
+    if (pipe(wakePipe) != 0) {
+        wakePipe[0] = wakePipe[1] = -1;
+        close();
+        return fail(errorMessage, "Failed to create the MIDI input's wake-up pipe");
+    }
+    resetParser();
+    running = true;
+    thread = std::thread(&AlsaMidiInput::run, this);
+    return true;
+}
+
+bool AlsaMidiInput::connect(int sourceClient, int sourcePort, std::string *errorMessage)
+{
+    snd_seq_port_subscribe_t *subscription;
+    snd_seq_port_subscribe_alloca(&subscription);
+    snd_seq_addr_t sender;
+    sender.client = static_cast<unsigned char>(sourceClient);
+    sender.port = static_cast<unsigned char>(sourcePort);
+    snd_seq_addr_t destination;
+    destination.client = static_cast<unsigned char>(snd_seq_client_id(seq));
+    destination.port = static_cast<unsigned char>(port);
+    snd_seq_port_subscribe_set_sender(subscription, &sender);
+    snd_seq_port_subscribe_set_dest(subscription, &destination);
+    snd_seq_port_subscribe_set_queue(subscription, queue);
+    snd_seq_port_subscribe_set_time_update(subscription, 1);
+    snd_seq_port_subscribe_set_time_real(subscription, 1);
+    const int err = snd_seq_subscribe_port(seq, subscription);
+    if (err < 0) {
+        return fail(errorMessage, "Failed to connect ALSA MIDI source " + std::to_string(sourceClient) + ":" +
+                    std::to_string(sourcePort), err);
+    }
+    return true;
+}
+
+bool AlsaMidiInput::connectHardwareSources(std::string *errorMessage)
+{
+    // Every readable port of a hardware device (keyboards, interfaces); software sources and
+    // the system client are left to connect themselves
+    snd_seq_client_info_t *client;
+    snd_seq_port_info_t *info;
+    snd_seq_client_info_alloca(&client);
+    snd_seq_port_info_alloca(&info);
+    const unsigned int readable = SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+    int connected = 0;
+    snd_seq_client_info_set_client(client, -1);
+    while (snd_seq_query_next_client(seq, client) >= 0) {
+        const int id = snd_seq_client_info_get_client(client);
+        if (id == SND_SEQ_CLIENT_SYSTEM || id == snd_seq_client_id(seq)) {
+            continue;
+        }
+        snd_seq_port_info_set_client(info, id);
+        snd_seq_port_info_set_port(info, -1);
+        while (snd_seq_query_next_port(seq, info) >= 0) {
+            if ((snd_seq_port_info_get_capability(info) & readable) == readable &&
+                (snd_seq_port_info_get_type(info) & SND_SEQ_PORT_TYPE_HARDWARE) &&
+                connect(id, snd_seq_port_info_get_port(info), errorMessage)) {
+                sourceNames += std::string(connected == 0 ? " <- " : ", ") + snd_seq_port_info_get_name(info);
+                ++connected;
+            }
+        }
+    }
+    if (connected == 0) {
+        sourceNames += " (no hardware sources; connect one with aconnect)";
+    }
+    return connected > 0;
+}
+
+void AlsaMidiInput::stop()
+{
+    if (running.exchange(false)) {
+        const char wake = 0;
+        const ssize_t written = write(wakePipe[1], &wake, 1);  // Wakes the thread out of poll()
+        static_cast<void>(written);
+        thread.join();
+    }
+    close();
+}
+
+void AlsaMidiInput::close()
+{
+    for (int &fd : wakePipe) {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    if (seq) {
+        snd_seq_close(seq);  // Frees the port and the queue
+        seq = nullptr;
+    }
+    port = -1;
+    queue = -1;
+}
+
+void AlsaMidiInput::run()
+{
+    // A high real-time priority, just below the ALSA audio thread's (a note should reach the
+    // engine before the next buffer is rendered); needs permission (an rtprio limit, or root) -
+    // without it the thread stays at normal priority
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 11;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+    const int count = snd_seq_poll_descriptors_count(seq, POLLIN);
+    std::vector<pollfd> fds(count + 1);
+    snd_seq_poll_descriptors(seq, fds.data(), count, POLLIN);
+    fds[count].fd = wakePipe[0];
+    fds[count].events = POLLIN;
+    fds[count].revents = 0;
+
+    while (running.load(std::memory_order_relaxed)) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[count].revents != 0) {
+            break;  // stop()
+        }
+        // Everything that has arrived (non-blocking: -EAGAIN once the input is empty)
+        for (;;) {
+            snd_seq_event_t *event = nullptr;
+            const int result = snd_seq_event_input(seq, &event);
+            if (result == -ENOSPC) {
+                overruns.fetch_add(1, std::memory_order_relaxed);  // The sequencer dropped events
+                continue;
+            }
+            if (result < 0 || !event) {
+                break;
+            }
+            handle(event);
+        }
+    }
+}
+
+void AlsaMidiInput::handle(const snd_seq_event_t *event)
+{
+    // The sequencer has already decoded the bytes; rebuild the channel message
+    switch (event->type) {
+    case SND_SEQ_EVENT_NOTEON:
+    case SND_SEQ_EVENT_NOTEOFF: {
+        const int type = event->type == SND_SEQ_EVENT_NOTEON ? 0x90 : 0x80;
+        deliver(static_cast<std::uint8_t>(type | (event->data.note.channel & 0x0f)), event->data.note.note & 0x7f,
+                event->data.note.velocity & 0x7f, eventTime(event));
+        break;
+    }
+    case SND_SEQ_EVENT_CONTROLLER: {
+        const int value = std::clamp(static_cast<int>(event->data.control.value), 0, 127);
+        deliver(static_cast<std::uint8_t>(0xb0 | (event->data.control.channel & 0x0f)),
+                static_cast<std::uint8_t>(event->data.control.param & 0x7f), static_cast<std::uint8_t>(value),
+                eventTime(event));
+        break;
+    }
+    default:
+        break;  // Connections coming and going, clock, and what a piano doesn't play
+    }
+}
+
+std::uint64_t AlsaMidiInput::eventTime(const snd_seq_event_t *event)
+{
+    const std::uint64_t now = NoteEvent::now();
+    if (!snd_seq_ev_is_real(event)) {
+        return lastTime = std::max(lastTime, now);  // Not stamped (a source that bypassed the subscription settings)
+    }
+    const std::int64_t stamp = static_cast<std::int64_t>(event->time.time.tv_sec) * 1000000000 +
+                               event->time.time.tv_nsec;
+    const std::int64_t offset = static_cast<std::int64_t>(now) - stamp;
+    if (!clockKnown || offset < clockOffset) {
+        clockOffset = offset;
+        clockKnown = true;
+    }
+    // Never later than now, should the two clocks drift apart, and never earlier than the
+    // event before, so events keep their order and spacing doesn't go negative
+    return lastTime = std::max(lastTime, std::min(now, static_cast<std::uint64_t>(stamp + clockOffset)));
+}
@@ -0,0 +1,61 @@
+#ifndef ALSAMIDIINPUT_H
+#define ALSAMIDIINPUT_H
+
+#include "midiinput.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+typedef struct _snd_seq snd_seq_t;
+typedef struct snd_seq_event snd_seq_event_t;
+
+// Linux MIDI input through the ALSA sequencer: a client "CplusplusPiano" with a writable
+// port "MIDI In" that any source can be connected to (aconnect, a DAW) - a virtual port in
+// RtMidi's terms - and that is connected at start to the given source ("client:port" or a
+// client name) or, with none given, to every hardware MIDI source present.
+//
+// Incoming events are stamped by the sequencer when they arrive (real-time timestamps
+// from a queue of our own), so the times passed on don't include how long the input
+// thread took to wake up. A thread at real-time priority (just below the audio thread's,
+// where permitted) waits in poll() and hands every event to the engine right away.
+class AlsaMidiInput : public MidiInput {
+public:
+    AlsaMidiInput();
+    ~AlsaMidiInput() override;
+
+    const char *name() const override { return "alsa"; }
+    bool start(PianoEngine *engine, const std::string &port, std::string *errorMessage = nullptr) override;
+    void stop() override;
+    std::string description() const override { return sourceNames; }
+
+    // Events the sequencer had to drop because the input thread fell behind (any thread)
+    std::uint64_t overrunCount() const { return overruns.load(std::memory_order_relaxed); }
+
+private:
+    bool connect(int client, int port, std::string *errorMessage);
+    bool connectHardwareSources(std::string *errorMessage);
+    void run();
+    void handle(const snd_seq_event_t *event);
+    std::uint64_t eventTime(const snd_seq_event_t *event);
+    void close();
+
+    snd_seq_t *seq;
+    int port;
+    int queue;
+    int wakePipe[2];  // Written by stop() to wake the thread out of poll()
+    std::string sourceNames;  // For description()
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<std::uint64_t> overruns;
+
+    // Sequencer queue time -> NoteEvent::now() time: the smallest difference seen (the event
+    // that reached the thread with the least delay); both run on the monotonic clock
+    std::int64_t clockOffset;
+    bool clockKnown;
+    // Last timestamp delivered: a smaller clockOffset found later would otherwise map an
+    // event to before the one delivered ahead of it
+    std::uint64_t lastTime;
+};
+
+#endif // ALSAMIDIINPUT_H
@@ -0,0 +1,38 @@
+# Audio output backends - the app's device layer over PianoEngine (see audiobackend.h) -
+# and the latency tuner that picks their buffer size.
+# The null and file backends are always built; the others where the platform has them.
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/audiobackend.cpp \
+    $$PWD/latencytuner.cpp \
+    $$PWD/nullbackend.cpp
+
+HEADERS += \
+    $$PWD/audiobackend.h \
+    $$PWD/latencytuner.h \
+    $$PWD/nullbackend.h
+
+# Core Audio (macOS native)
+macx {
+    SOURCES += $$PWD/coreaudiobackend.cpp
+    HEADERS += $$PWD/coreaudiobackend.h
+    LIBS += -framework CoreAudio -framework AudioToolbox -framework AudioUnit -framework CoreFoundation
+}
+
+# ALSA and JACK (Linux), each only if pkg-config finds its development files
+unix:!macx {
+    CONFIG += link_pkgconfig
+    packagesExist(alsa) {
+        DEFINES += PIANO_HAVE_ALSA
+        PKGCONFIG += alsa
+        SOURCES += $$PWD/alsabackend.cpp
+        HEADERS += $$PWD/alsabackend.h
+    }
+    packagesExist(jack) {
+        DEFINES += PIANO_HAVE_JACK
+        PKGCONFIG += jack
+        SOURCES += $$PWD/jackbackend.cpp
+        HEADERS += $$PWD/jackbackend.h
+    }
+}
@@ -0,0 +1,116 @@
+#include "audiobackend.h"
+#include "nullbackend.h"
+#include "pianoengine.h"
+
+#include <chrono>
+
+#ifdef __APPLE__
+#include "coreaudiobackend.h"
+#endif
+#ifdef PIANO_HAVE_ALSA
+#include "alsabackend.h"
+#endif
+#ifdef PIANO_HAVE_JACK
+#include "jackbackend.h"
+#endif
+
+AudioBackend::AudioBackend()
+    : missesBeforeStart(0), xrunsBeforeStart(0), failedFlag(false)
+{
+}
+
+void AudioBackend::resetCounters()
+{
+    xrunsBeforeStart += xrunCount();
+    missesBeforeStart = renderTelemetry.deadlineMissCount();
+    failure.clear();
+    failedFlag.store(false, std::memory_order_relaxed);
+}
+
+bool AudioBackend::failed(std::string *errorMessage) const
+{
+    if (!failedFlag.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (errorMessage) {
+        *errorMessage = failure;
+    }
+    return true;
+}
+
+void AudioBackend::deviceFailed(const std::string &message)
+{
+    failure = message;
+    failedFlag.store(true, std::memory_order_release);
+}
+
+template <typename Sample>
+void AudioBackend::timedRender(PianoEngine *engine, Sample *out, int frames)
+{
+    const auto start = std::chrono::steady_clock::now();
+    engine->render(out, frames);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    renderTelemetry.record(static_cast<std::uint64_t>(elapsed), frames, current.sampleRate,
+                           engine->activeVoiceCount(), engine->stolenVoiceCount(), xrunsBeforeStart + xrunCount());
+}
+
+void AudioBackend::renderBuffer(PianoEngine *engine, std::int16_t *out, int frames)
+{
+    timedRender(engine, out, frames);
+}
+
+void AudioBackend::renderBuffer(PianoEngine *engine, float *out, int frames)
+{
+    timedRender(engine, out, frames);
+}
+
+std::vector<std::string> AudioBackend::availableBackends()
+{
+    std::vector<std::string> names;
+#ifdef __APPLE__
+    names.push_back("coreaudio");
+#endif
+#ifdef PIANO_HAVE_ALSA
+    names.push_back("alsa");
+#endif
+#ifdef PIANO_HAVE_JACK
+    names.push_back("jack");
+#endif
+    // Last: the default only where no real device backend was built
+    names.push_back("null");
+    names.push_back("file");
+    return names;
+}
+
+std::unique_ptr<AudioBackend> AudioBackend::create(const std::string &name, std::string *errorMessage)
+{
+    const std::string backend = name.empty() ? availableBackends().front() : name;
+#ifdef __APPLE__
+    if (backend == "coreaudio") {
+        return std::unique_ptr<AudioBackend>(new CoreAudioBackend());
+    }
+#endif
+#ifdef PIANO_HAVE_ALSA
+    if (backend == "alsa") {
+        return std::unique_ptr<AudioBackend>(new AlsaBackend());
+    }
+#endif
+#ifdef PIANO_HAVE_JACK
+    if (backend == "jack") {
+        return std::unique_ptr<AudioBackend>(new JackBackend());
+    }
+#endif
+    if (backend == "null" || backend == "file") {
+        return std::unique_ptr<AudioBackend>(new NullBackend(backend == "file"));
+    }
+
+    if (errorMessage) {
+        std::string names;
+        for (const std::string &available : availableBackends()) {
+            names += (names.empty() ? "" : ", ") + available;
+        }
+        *errorMessage = "Audio backend '" + backend + "' is not available (built in: " + names + ")";
+    }
+    return nullptr;
+}
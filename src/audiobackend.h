@@ -0,0 +1,116 @@
+#ifndef AUDIOBACKEND_H
+#define AUDIOBACKEND_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rendertelemetry.h"
+
+class PianoEngine;
+
+// What the app asks of the audio device. A backend may not get exactly this: after
+// open() its settings() hold what the device agreed to, and the engine is set up for that.
+struct AudioSettings {
+    static const int defaultSampleRate = 44100;
+    static const int defaultBufferFrames = 256;
+    static const int defaultPeriods = 2;
+    static const int maxChannels = 8;
+
+    std::string backend;  // coreaudio | alsa | jack | null | file; empty = the platform default
+    std::string device;  // Backend-specific device name (ALSA "hw:1,0", JACK port pattern); empty = default
+    int sampleRate = defaultSampleRate;
+    int channels = 2;  // 1..maxChannels
+    int bufferFrames = defaultBufferFrames;  // Frames per callback (one period)
+    int periods = defaultPeriods;  // Periods in the device buffer, where the backend controls it (ALSA)
+    std::string outputPath;  // file backend: the WAV file the output is written to
+};
+
+// An audio output: a device thread that pulls buffers from the engine.
+//
+// open() negotiates the format with the device without starting it, so the engine can be
+// set up for the actual rate before the first callback; start() then runs the device,
+// calling PianoEngine::render from its own (real-time) thread until stop(). Errors are
+// reported through errorMessage, as everywhere in the engine; a device that fails once it
+// is running, with nobody there to pass an errorMessage, reports through failed().
+//
+// Every backend renders through renderBuffer(), which times each buffer into the backend's
+// telemetry (rendertelemetry.h): cycle times, DSP load, voices, and deadline misses - buffers
+// whose rendering took more than RenderTelemetry::deadlineFraction of their playing time.
+// Together with the device's own xrun count these tell the latency tuner (latencytuner.h)
+// when the buffer is too small.
+//
+// Implementations: CoreAudio (macOS), ALSA and JACK (Linux, where the libraries were
+// found at build time), and the always-available null and file backends, which pull
+// buffers on a timer at real-time pace and discard them or write them to a WAV file -
+// for headless runs and CI.
+class AudioBackend {
+public:
+    AudioBackend();
+    virtual ~AudioBackend() = default;
+
+    AudioBackend(const AudioBackend &) = delete;
+    AudioBackend &operator=(const AudioBackend &) = delete;
+
+    // Name as accepted by create()
+    virtual const char *name() const = 0;
+
+    // Opens the device with (as near as it allows) the requested settings
+    virtual bool open(const AudioSettings &requested, std::string *errorMessage = nullptr) = 0;
+    // Starts pulling buffers from engine, whose output format must match settings()
+    virtual bool start(PianoEngine *engine, std::string *errorMessage = nullptr) = 0;
+    // Stops the device thread and closes the device (safe to call more than once)
+    virtual void stop() = 0;
+
+    // The settings in effect after open()
+    const AudioSettings &settings() const { return current; }
+    // Output latency in frames beyond the engine's own: the device buffer plus whatever the
+    // driver and hardware report
+    virtual int latencyFrames() const { return current.bufferFrames * current.periods; }
+    // Largest buffer a callback may ask for after open(); the engine is preallocated for it
+    virtual int maxCallbackFrames() const { return current.bufferFrames; }
+
+    // Since start() (any thread): buffers the device played out late or not at all, as far as
+    // the backend can tell, and buffers that took too long to render
+    virtual std::uint64_t xrunCount() const { return 0; }
+    std::uint64_t deadlineMissCount() const { return renderTelemetry.deadlineMissCount() - missesBeforeStart; }
+
+    // Render-thread statistics since the backend was created, across restarts (any thread)
+    const RenderTelemetry &telemetry() const { return renderTelemetry; }
+
+    // Whether the device thread has stopped since start() on an error it couldn't recover
+    // from, and the error (any thread; the message is set before the flag). The backend then
+    // plays nothing until stop() and a new open() and start()
+    bool failed(std::string *errorMessage = nullptr) const;
+
+    // A backend by name (empty: the platform default), or null and an error if it isn't
+    // built into this binary
+    static std::unique_ptr<AudioBackend> create(const std::string &name, std::string *errorMessage = nullptr);
+    // Backends built into this binary, the platform default first
+    static std::vector<std::string> availableBackends();
+
+protected:
+    // Device thread: renders frames through the engine and checks the time it took
+    void renderBuffer(PianoEngine *engine, std::int16_t *out, int frames);
+    void renderBuffer(PianoEngine *engine, float *out, int frames);
+    // In start(), before the device thread runs and before the backend clears its xrun count:
+    // moves the counts since the last start into the totals
+    void resetCounters();
+    // Device thread, as it gives up: records the error for failed()
+    void deviceFailed(const std::string &message);
+
+    AudioSettings current;
+
+private:
+    template <typename Sample>
+    void timedRender(PianoEngine *engine, Sample *out, int frames);
+
+    RenderTelemetry renderTelemetry;
+    std::uint64_t missesBeforeStart;
+    std::uint64_t xrunsBeforeStart;
+    std::string failure;  // Written by the device thread before it sets failedFlag
+    std::atomic<bool> failedFlag;
+};
+
+#endif // AUDIOBACKEND_H
@@ -0,0 +1,256 @@
+#include "coreaudiobackend.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static bool fail(std::string *errorMessage, const std::string &message, OSStatus err = noErr)
+{
+    if (errorMessage) {
+        *errorMessage = err == noErr ? message : message + " (OSStatus " + std::to_string(err) + ")";
+    }
+    return false;
+}
+
+// Output device whose name is `name`, or kAudioObjectUnknown
+static AudioDeviceID findOutputDevice(const std::string &name)
+{
+    AudioObjectPropertyAddress address = {
+        kAudioHardwarePropertyDevices, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain
+    };
+    UInt32 size = 0;
+    if (AudioObjectGetPropertyDataSize(kAudioObjectSystemObject, &address, 0, nullptr, &size) != noErr) {
+        return kAudioObjectUnknown;
+    }
+    std::vector<AudioDeviceID> devices(size / sizeof(AudioDeviceID));
+    if (AudioObjectGetPropertyData(kAudioObjectSystemObject, &address, 0, nullptr, &size, devices.data()) != noErr) {
+        return kAudioObjectUnknown;
+    }
+
+    for (const AudioDeviceID device : devices) {
+        CFStringRef deviceName = nullptr;
+        UInt32 nameSize = sizeof(deviceName);
+        AudioObjectPropertyAddress nameAddress = {
+            kAudioObjectPropertyName, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain
+        };
+        if (AudioObjectGetPropertyData(device, &nameAddress, 0, nullptr, &nameSize, &deviceName) != noErr ||
+            !deviceName) {
+            continue;
+        }
+        char buffer[256];
+        const bool match = CFStringGetCString(deviceName, buffer, sizeof(buffer), kCFStringEncodingUTF8) &&
+                           name == buffer;
+        CFRelease(deviceName);
+        if (match) {
+            return device;
+        }
+    }
+    return kAudioObjectUnknown;
+}
+
+static const AudioObjectPropertyAddress overloadAddress = {
+    kAudioDeviceProcessorOverload, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain
+};
+
+// A UInt32 output-scope property of a device, 0 if it has none
+static UInt32 deviceProperty(AudioDeviceID device, AudioObjectPropertySelector selector)
+{
+    AudioObjectPropertyAddress address = {
+        selector, kAudioDevicePropertyScopeOutput, kAudioObjectPropertyElementMain
+    };
+    UInt32 value = 0;
+    UInt32 size = sizeof(value);
+    if (AudioObjectGetPropertyData(device, &address, 0, nullptr, &size, &value) != noErr) {
+        return 0;
+    }
+    return value;
+}
+
+CoreAudioBackend::CoreAudioBackend()
+    : audioUnit(nullptr), engine(nullptr), running(false), deviceLatencyFrames(0), maxSliceFrames(0),
+      outputDevice(kAudioObjectUnknown), overloads(0)
+{
+}
+
+CoreAudioBackend::~CoreAudioBackend()
+{
+    stop();
+}
+
+bool CoreAudioBackend::open(const AudioSettings &requested, std::string *errorMessage)
+{
+    stop();
+    current = requested;
+    current.backend = name();
+    current.periods = 1;  // The HAL double-buffers on its own; its latency is reported separately
+
+    // The default output follows the system setting; a named device needs a HAL output unit
+    AudioDeviceID device = kAudioObjectUnknown;
+    if (!current.device.empty()) {
+        device = findOutputDevice(current.device);
+        if (device == kAudioObjectUnknown) {
+            return fail(errorMessage, "No audio output device named '" + current.device + "'");
+        }
+    }
+    AudioComponentDescription desc;
+    desc.componentType = kAudioUnitType_Output;
+    desc.componentSubType = current.device.empty() ? kAudioUnitSubType_DefaultOutput : kAudioUnitSubType_HALOutput;
+    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
+    desc.componentFlags = 0;
+    desc.componentFlagsMask = 0;
+
+    AudioComponent component = AudioComponentFindNext(nullptr, &desc);
+    if (!component) {
+        return fail(errorMessage, "Failed to find audio component");
+    }
+    OSStatus err = AudioComponentInstanceNew(component, &audioUnit);
+    if (err != noErr) {
+        audioUnit = nullptr;
+        return fail(errorMessage, "Failed to create audio unit", err);
+    }
+    if (device != kAudioObjectUnknown) {
+        err = AudioUnitSetProperty(audioUnit, kAudioOutputUnitProperty_CurrentDevice, kAudioUnitScope_Global, 0,
+                                   &device, sizeof(device));
+        if (err != noErr) {
+            close();
+            return fail(errorMessage, "Failed to select audio device '" + current.device + "'", err);
+        }
+    }
+
+    // Interleaved 16-bit at the requested rate, written straight by the engine
+    AudioStreamBasicDescription audioFormat;
+    audioFormat.mSampleRate = current.sampleRate;
+    audioFormat.mFormatID = kAudioFormatLinearPCM;
+    audioFormat.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+    audioFormat.mBitsPerChannel = 16;
+    audioFormat.mChannelsPerFrame = current.channels;
+    audioFormat.mBytesPerFrame = audioFormat.mChannelsPerFrame * sizeof(SInt16);
+    audioFormat.mFramesPerPacket = 1;
+    audioFormat.mBytesPerPacket = audioFormat.mBytesPerFrame * audioFormat.mFramesPerPacket;
+    audioFormat.mReserved = 0;
+    err = AudioUnitSetProperty(audioUnit, kAudioUnitProperty_StreamFormat, kAudioUnitScope_Input, 0,
+                               &audioFormat, sizeof(audioFormat));
+    if (err != noErr) {
+        close();
+        return fail(errorMessage, "Failed to set audio format", err);
+    }
+
+    // Ask the device for the buffer size; it may round it to what the hardware supports
+    UInt32 bufferFrames = static_cast<UInt32>(current.bufferFrames);
+    AudioUnitSetProperty(audioUnit, kAudioDevicePropertyBufferFrameSize, kAudioUnitScope_Global, 0,
+                         &bufferFrames, sizeof(bufferFrames));
+    UInt32 size = sizeof(bufferFrames);
+    if (AudioUnitGetProperty(audioUnit, kAudioDevicePropertyBufferFrameSize, kAudioUnitScope_Global, 0,
+                             &bufferFrames, &size) == noErr && bufferFrames > 0) {
+        current.bufferFrames = static_cast<int>(bufferFrames);
+    }
+    // The unit may still ask for more in one call (up to its slice size, 1156 frames by default)
+    UInt32 sliceFrames = 0;
+    size = sizeof(sliceFrames);
+    AudioUnitGetProperty(audioUnit, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0,
+                         &sliceFrames, &size);
+    maxSliceFrames = std::max(current.bufferFrames, static_cast<int>(sliceFrames));
+
+    AURenderCallbackStruct callbackStruct;
+    callbackStruct.inputProc = renderCallback;
+    callbackStruct.inputProcRefCon = this;
+    err = AudioUnitSetProperty(audioUnit, kAudioUnitProperty_SetRenderCallback, kAudioUnitScope_Input, 0,
+                               &callbackStruct, sizeof(callbackStruct));
+    if (err != noErr) {
+        close();
+        return fail(errorMessage, "Failed to set render callback", err);
+    }
+
+    err = AudioUnitInitialize(audioUnit);
+    if (err != noErr) {
+        close();
+        return fail(errorMessage, "Failed to initialize audio unit", err);
+    }
+
+    // Latency beyond the buffer: the unit's own, the device's and its safety offset
+    Float64 unitLatency = 0;
+    size = sizeof(unitLatency);
+    AudioUnitGetProperty(audioUnit, kAudioUnitProperty_Latency, kAudioUnitScope_Global, 0, &unitLatency, &size);
+    deviceLatencyFrames = static_cast<int>(unitLatency * current.sampleRate);
+    size = sizeof(device);
+    if (AudioUnitGetProperty(audioUnit, kAudioOutputUnitProperty_CurrentDevice, kAudioUnitScope_Global, 0,
+                             &device, &size) == noErr) {
+        deviceLatencyFrames += static_cast<int>(deviceProperty(device, kAudioDevicePropertyLatency) +
+                                                deviceProperty(device, kAudioDevicePropertySafetyOffset));
+        if (AudioObjectAddPropertyListener(device, &overloadAddress, overloadListener, this) == noErr) {
+            outputDevice = device;
+        }
+    }
+    return true;
+}
+
+bool CoreAudioBackend::start(PianoEngine *engine, std::string *errorMessage)
+{
+    if (!audioUnit) {
+        return fail(errorMessage, "The coreaudio backend is not open");
+    }
+    this->engine = engine;
+    resetCounters();
+    overloads.store(0, std::memory_order_relaxed);
+    const OSStatus err = AudioOutputUnitStart(audioUnit);
+    if (err != noErr) {
+        return fail(errorMessage, "Failed to start audio unit", err);
+    }
+    running = true;
+    return true;
+}
+
+void CoreAudioBackend::stop()
+{
+    if (audioUnit && running) {
+        AudioOutputUnitStop(audioUnit);
+    }
+    running = false;
+    close();
+}
+
+void CoreAudioBackend::close()
+{
+    if (outputDevice != kAudioObjectUnknown) {
+        AudioObjectRemovePropertyListener(outputDevice, &overloadAddress, overloadListener, this);
+        outputDevice = kAudioObjectUnknown;
+    }
+    if (audioUnit) {
+        AudioUnitUninitialize(audioUnit);
+        AudioComponentInstanceDispose(audioUnit);
+        audioUnit = nullptr;
+    }
+}
+
+OSStatus CoreAudioBackend::renderCallback(void *inRefCon,
+                                          AudioUnitRenderActionFlags *ioActionFlags,
+                                          const AudioTimeStamp *inTimeStamp,
+                                          UInt32 inBusNumber,
+                                          UInt32 inNumberFrames,
+                                          AudioBufferList *ioData)
+{
+    (void)ioActionFlags;
+    (void)inTimeStamp;
+    (void)inBusNumber;
+
+    CoreAudioBackend *backend = static_cast<CoreAudioBackend *>(inRefCon);
+
+    // Thin adapter: the engine renders straight into the device buffer
+    // (interleaved 16-bit, matching the stream format set in open)
+    AudioBuffer *buffer = &ioData->mBuffers[0];
+    SInt16 *out = static_cast<SInt16 *>(buffer->mData);
+    backend->renderBuffer(backend->engine, out, static_cast<int>(inNumberFrames));
+
+    return noErr;
+}
+
+OSStatus CoreAudioBackend::overloadListener(AudioObjectID object, UInt32 addressCount,
+                                            const AudioObjectPropertyAddress *addresses, void *clientData)
+{
+    (void)object;
+    (void)addressCount;
+    (void)addresses;
+    static_cast<CoreAudioBackend *>(clientData)->overloads.fetch_add(1, std::memory_order_relaxed);
+    return noErr;
+}
@@ -0,0 +1,50 @@
+#ifndef COREAUDIOBACKEND_H
+#define COREAUDIOBACKEND_H
+
+#include "audiobackend.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include <AudioToolbox/AudioToolbox.h>
+#include <CoreAudio/CoreAudio.h>
+
+// macOS output through an AudioUnit: the default output unit, or a HAL output unit bound to
+// the named device (settings().device, matched against the device names). The stream
+// format is 16-bit interleaved at the requested rate (the unit converts if the device runs
+// at another); the buffer size is asked of the device and read back. Xruns are the device's
+// processor overloads (the HAL missed a cycle).
+class CoreAudioBackend : public AudioBackend {
+public:
+    CoreAudioBackend();
+    ~CoreAudioBackend() override;
+
+    const char *name() const override { return "coreaudio"; }
+    bool open(const AudioSettings &requested, std::string *errorMessage = nullptr) override;
+    bool start(PianoEngine *engine, std::string *errorMessage = nullptr) override;
+    void stop() override;
+    int latencyFrames() const override { return current.bufferFrames + deviceLatencyFrames; }
+    int maxCallbackFrames() const override { return maxSliceFrames; }
+    std::uint64_t xrunCount() const override { return overloads.load(std::memory_order_relaxed); }
+
+private:
+    static OSStatus renderCallback(void *inRefCon,
+                                   AudioUnitRenderActionFlags *ioActionFlags,
+                                   const AudioTimeStamp *inTimeStamp,
+                                   UInt32 inBusNumber,
+                                   UInt32 inNumberFrames,
+                                   AudioBufferList *ioData);
+    static OSStatus overloadListener(AudioObjectID object, UInt32 addressCount,
+                                     const AudioObjectPropertyAddress *addresses, void *clientData);
+    void close();
+
+    AudioComponentInstance audioUnit;
+    PianoEngine *engine;
+    bool running;
+    int deviceLatencyFrames;  // Device and safety-offset latency, plus the unit's own
+    int maxSliceFrames;  // The unit's maximum frames per render call
+    AudioDeviceID outputDevice;  // Whose overloads are listened to, kAudioObjectUnknown if none
+    std::atomic<std::uint64_t> overloads;
+};
+
+#endif // COREAUDIOBACKEND_H
@@ -0,0 +1,182 @@
+#include "diskstreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+StreamFile::~StreamFile()
+{
+    ::close(fd);
+}
+
+std::shared_ptr<StreamFile> StreamFile::open(const std::string &path, std::string *errorMessage)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errorMessage) {
+            *errorMessage = "Failed to open file for streaming: " + path;
+        }
+        return nullptr;
+    }
+    return std::shared_ptr<StreamFile>(new StreamFile(fd));
+}
+
+DiskStreamer::DiskStreamer()
+    : streamCount(0), ringSize(0), ringMask(0), running(false), underruns(0), unavailable(0), totalBytesRead(0)
+{
+}
+
+DiskStreamer::~DiskStreamer()
+{
+    stop();
+}
+
+void DiskStreamer::start(int count, int ringSamples)
+{
+    stop();
+
+    ringSize = 1;
+    while (ringSize < static_cast<std::size_t>(std::max(ringSamples, 1))) {
+        ringSize <<= 1;
+    }
+    ringMask = ringSize - 1;
+    streamCount = std::max(count, 1);
+    streams.reset(new Stream[streamCount]);
+    ringStorage.assign(ringSize * streamCount, 0);
+    for (int i = 0; i < streamCount; ++i) {
+        streams[i].ring = ringStorage.data() + ringSize * i;
+    }
+
+    running = true;
+    readerThread = std::thread(&DiskStreamer::readerLoop, this);
+}
+
+void DiskStreamer::stop()
+{
+    if (readerThread.joinable()) {
+        running = false;
+        readerThread.join();
+    }
+    streams.reset();
+    streamCount = 0;
+    ringStorage.clear();
+}
+
+int DiskStreamer::open(const StreamSource *source, int startSample)
+{
+    for (int i = 0; i < streamCount; ++i) {
+        Stream &stream = streams[i];
+        if (stream.state.load(std::memory_order_acquire) != Free) {
+            continue;
+        }
+        // Free streams belong to the audio thread until they are published as Open
+        stream.source = source;
+        stream.startSample = startSample;
+        stream.writePos.store(0, std::memory_order_relaxed);
+        stream.readPos.store(0, std::memory_order_relaxed);
+        stream.state.store(Open, std::memory_order_release);
+        return i;
+    }
+    unavailable.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+}
+
+void DiskStreamer::close(int id)
+{
+    if (id >= 0 && id < streamCount) {
+        // The reader hands it back (Free) once it is no longer filling it
+        streams[id].state.store(Closing, std::memory_order_release);
+    }
+}
+
+void DiskStreamer::closeAll()
+{
+    for (int i = 0; i < streamCount; ++i) {
+        int expected = Open;
+        streams[i].state.compare_exchange_strong(expected, Closing, std::memory_order_acq_rel);
+    }
+}
+
+int DiskStreamer::peek(int id, int count, const std::int16_t *&first, int &firstCount,
+                       const std::int16_t *&second) const
+{
+    const Stream &stream = streams[id];
+    const std::uint64_t read = stream.readPos.load(std::memory_order_relaxed);
+    const std::uint64_t written = stream.writePos.load(std::memory_order_acquire);
+    const int available = static_cast<int>(std::min<std::uint64_t>(written - read, count));
+
+    const std::size_t start = static_cast<std::size_t>(read) & ringMask;
+    first = stream.ring + start;
+    firstCount = static_cast<int>(std::min<std::size_t>(available, ringSize - start));
+    second = stream.ring;
+    return available;
+}
+
+void DiskStreamer::consume(int id, int count)
+{
+    Stream &stream = streams[id];
+    stream.readPos.store(stream.readPos.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+int DiskStreamer::openStreamCount() const
+{
+    int count = 0;
+    for (int i = 0; i < streamCount; ++i) {
+        count += streams[i].state.load(std::memory_order_relaxed) != Free;
+    }
+    return count;
+}
+
+void DiskStreamer::readerLoop()
+{
+    while (running.load(std::memory_order_relaxed)) {
+        bool busy = false;
+        for (int i = 0; i < streamCount; ++i) {
+            Stream &stream = streams[i];
+            const int state = stream.state.load(std::memory_order_acquire);
+            if (state == Closing) {
+                stream.state.store(Free, std::memory_order_release);
+            } else if (state == Open) {
+                busy |= fill(stream);
+            }
+        }
+        if (!busy) {
+            // Nothing to read: every ring is full or finished
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool DiskStreamer::fill(Stream &stream)
+{
+    // Read in reasonably large pieces, but top up a ring as soon as a piece fits
+    const std::size_t chunk = std::min<std::size_t>(ringSize / 4, 16384);
+    const std::uint64_t written = stream.writePos.load(std::memory_order_relaxed);
+    const std::uint64_t read = stream.readPos.load(std::memory_order_acquire);
+    const std::uint64_t fileSample = stream.startSample + written;
+    const StreamSource &source = *stream.source;
+    if (fileSample >= static_cast<std::uint64_t>(source.length)) {
+        return false;  // Whole sample delivered
+    }
+
+    const std::size_t space = ringSize - static_cast<std::size_t>(written - read);
+    const std::size_t remaining = static_cast<std::size_t>(source.length - fileSample);
+    std::size_t count = std::min(space, remaining);
+    if (count < chunk && count < remaining) {
+        return false;  // Wait until a whole chunk fits
+    }
+
+    // One piece up to the end of the ring; the rest (if any) on the next pass
+    const std::size_t start = static_cast<std::size_t>(written) & ringMask;
+    count = std::min(count, ringSize - start);
+    const ssize_t bytes = pread(source.file->descriptor(), stream.ring + start, count * sizeof(std::int16_t),
+                                static_cast<off_t>(source.dataOffset + fileSample * sizeof(std::int16_t)));
+    if (bytes <= 0) {
+        return false;  // Read error or truncated file: the voice will underrun and stall
+    }
+    totalBytesRead.fetch_add(static_cast<std::uint64_t>(bytes), std::memory_order_relaxed);
+    stream.writePos.store(written + static_cast<std::uint64_t>(bytes) / sizeof(std::int16_t),
+                          std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef DISKSTREAMER_H
+#define DISKSTREAMER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read-only file descriptor shared by every stream source in the same file
+class StreamFile {
+public:
+    ~StreamFile();
+    static std::shared_ptr<StreamFile> open(const std::string &path, std::string *errorMessage = nullptr);
+    int descriptor() const { return fd; }
+
+private:
+    explicit StreamFile(int descriptor) : fd(descriptor) {}
+    int fd;
+};
+
+// The on-disk part of a streamed sample: 16-bit interleaved PCM at a file offset
+struct StreamSource {
+    std::shared_ptr<StreamFile> file;
+    std::uint64_t dataOffset = 0;  // Byte offset of sample 0 in the file
+    int length = 0;  // Total samples, including the part held in memory
+};
+
+// Feeds voices whose samples are only partly resident from disk.
+//
+// A fixed set of streams, each with its own single-producer/single-consumer ring
+// buffer, is allocated by start(). The audio thread opens a stream at note-on,
+// reads from it while mixing and closes it when the voice ends; a reader thread
+// keeps every open ring topped up with pread(). The audio side only touches atomics
+// and preallocated memory - it never blocks on the reader or the disk. If a ring
+// runs dry the voice stalls and the underrun counter goes up.
+class DiskStreamer {
+public:
+    static const int defaultStreams = 64;
+
+    DiskStreamer();
+    ~DiskStreamer();
+
+    DiskStreamer(const DiskStreamer &) = delete;
+    DiskStreamer &operator=(const DiskStreamer &) = delete;
+
+    // Setup (not real-time safe): allocate streams of at least ringSamples each and
+    // start the reader thread. Restarting drops all open streams.
+    void start(int streams, int ringSamples);
+    void stop();
+    bool isRunning() const { return readerThread.joinable(); }
+
+    // Audio thread: open a stream that delivers source from sample startSample onwards.
+    // Returns the stream id, or -1 if every stream is in use.
+    int open(const StreamSource *source, int startSample);
+    void close(int id);
+    void closeAll();
+
+    // Audio thread: up to `count` buffered samples of stream id, as one or two spans
+    // (the ring may wrap). Returns the number available; call consume() after mixing.
+    int peek(int id, int count, const std::int16_t *&first, int &firstCount,
+             const std::int16_t *&second) const;
+    void consume(int id, int count);
+    // Audio thread: record that a stream could not deliver what a voice needed
+    void countUnderrun() { underruns.fetch_add(1, std::memory_order_relaxed); }
+
+    std::uint64_t underrunCount() const { return underruns.load(std::memory_order_relaxed); }
+    // open() calls that found every stream busy
+    std::uint64_t unavailableCount() const { return unavailable.load(std::memory_order_relaxed); }
+    // Streams in use, including closed ones the reader hasn't released yet
+    int openStreamCount() const;
+    std::uint64_t bytesRead() const { return totalBytesRead.load(std::memory_order_relaxed); }
+
+private:
+    enum State { Free, Open, Closing };
+
+    struct Stream {
+        std::atomic<int> state{Free};
+        const StreamSource *source = nullptr;
+        int startSample = 0;
+        std::atomic<std::uint64_t> writePos{0};  // Samples written since startSample (reader)
+        std::atomic<std::uint64_t> readPos{0};  // Samples consumed (audio thread)
+        std::int16_t *ring = nullptr;
+    };
+
+    void readerLoop();
+    bool fill(Stream &stream);
+
+    std::unique_ptr<Stream[]> streams;
+    int streamCount;
+    std::vector<std::int16_t> ringStorage;
+    std::size_t ringSize;  // Power of two, in samples
+    std::size_t ringMask;
+
+    std::thread readerThread;
+    std::atomic<bool> running;
+    std::atomic<std::uint64_t> underruns;
+    std::atomic<std::uint64_t> unavailable;
+    std::atomic<std::uint64_t> totalBytesRead;
+};
+
+#endif // DISKSTREAMER_H
@@ -0,0 +1,49 @@
+# PianoEngine - platform-independent sound engine (no Qt widgets, no Core Audio)
+# Included by the app and by the command-line tools.
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/diskstreamer.cpp \
+    $$PWD/envelope.cpp \
+    $$PWD/limiter.cpp \
+    $$PWD/mappedfile.cpp \
+    $$PWD/mixkernels.cpp \
+    $$PWD/notenames.cpp \
+    $$PWD/pianoengine.cpp \
+    $$PWD/renderpool.cpp \
+    $$PWD/rendertelemetry.cpp \
+    $$PWD/resampler.cpp \
+    $$PWD/resonancebank.cpp \
+    $$PWD/samplebank.cpp \
+    $$PWD/samplecache.cpp \
+    $$PWD/sampleloop.cpp \
+    $$PWD/sampleset.cpp \
+    $$PWD/unacordafilter.cpp \
+    $$PWD/voicepool.cpp \
+    $$PWD/wavfile.cpp
+
+HEADERS += \
+    $$PWD/diskstreamer.h \
+    $$PWD/envelope.h \
+    $$PWD/limiter.h \
+    $$PWD/mappedfile.h \
+    $$PWD/mixkernels.h \
+    $$PWD/notenames.h \
+    $$PWD/noteeventqueue.h \
+    $$PWD/pianoengine.h \
+    $$PWD/renderpool.h \
+    $$PWD/rendertelemetry.h \
+    $$PWD/resampler.h \
+    $$PWD/resonancebank.h \
+    $$PWD/samplebank.h \
+    $$PWD/samplecache.h \
+    $$PWD/sampleloop.h \
+    $$PWD/sampleset.h \
+    $$PWD/unacordafilter.h \
+    $$PWD/voicepool.h \
+    $$PWD/wavfile.h
+
+# Loader and disk streaming threads
+unix:!macx {
+    LIBS += -lpthread
+}
@@ -0,0 +1,118 @@
+#include "envelope.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Level change per frame of a stage that spans `fullScale` of level in ms milliseconds
+// (at least one frame, so a zero time is an instant step rather than a division by zero)
+static float stageRate(double ms, double fullScale, int sampleRate)
+{
+    const double frames = std::max(1.0, ms * sampleRate / 1000.0);
+    return static_cast<float>(fullScale / frames);
+}
+
+Envelope::Envelope()
+{
+    setup(EnvelopeSettings(), 44100);
+}
+
+void Envelope::setup(const EnvelopeSettings &settings, int sampleRate)
+{
+    current = settings;
+    current.attackMs = std::max(0.0, settings.attackMs);
+    current.decayMs = std::max(0.0, settings.decayMs);
+    current.sustainLevel = std::clamp(settings.sustainLevel, 0.0, 1.0);
+    current.releaseMs = std::max(0.0, settings.releaseMs);
+    current.loopFadeMs = std::max(0.0, settings.loopFadeMs);
+
+    sustainLevel = static_cast<float>(current.sustainLevel);
+    attackRate = stageRate(current.attackMs, 1.0, sampleRate);
+    decayRate = stageRate(current.decayMs, 1.0 - current.sustainLevel, sampleRate);
+    releaseRate = stageRate(current.releaseMs, 1.0, sampleRate);
+    loopFadeRate = stageRate(current.loopFadeMs, 1.0, sampleRate);
+}
+
+void Envelope::start(Stage &stage, float &level) const
+{
+    // Without an attack the voice starts at full level; without a decay, at the sustain level.
+    // The defaults (no attack, no decay, full sustain) leave the sample exactly as recorded.
+    if (current.attackMs > 0.0) {
+        stage = Attack;
+        level = 0.0f;
+    } else if (current.decayMs > 0.0 && sustainLevel < 1.0f) {
+        stage = Decay;
+        level = 1.0f;
+    } else {
+        stage = Sustain;
+        level = sustainLevel;
+    }
+}
+
+bool Envelope::slope(Stage stage, float releaseSpeed, float &rate, float &target, Stage &next) const
+{
+    switch (stage) {
+    case Attack:
+        rate = attackRate;
+        // No decay stage: the attack goes straight to the sustain level
+        next = sustainLevel < 1.0f && current.decayMs > 0.0 ? Decay : Sustain;
+        target = next == Decay ? 1.0f : sustainLevel;
+        return true;
+    case Decay:
+        rate = decayRate;
+        target = sustainLevel;
+        next = Sustain;
+        return true;
+    case LoopFade:
+        rate = loopFadeRate;
+        target = 0.0f;
+        next = Done;
+        return true;
+    case Release:
+        rate = releaseRate * releaseSpeed;
+        target = 0.0f;
+        next = Done;
+        return rate > 0.0f;
+    case Sustain:
+    case Done:
+    default:
+        return false;
+    }
+}
+
+int Envelope::rampFrames(Stage stage, float level, float releaseSpeed) const
+{
+    float rate;
+    float target;
+    Stage next;
+    if (!slope(stage, releaseSpeed, rate, target, next)) {
+        return std::numeric_limits<int>::max();
+    }
+    const float stageFrames = std::abs(target - level) / rate;
+    const int blocks = static_cast<int>(std::min(stageFrames / blockFrames, 65536.0f));
+    return std::max(1, blocks) * blockFrames;
+}
+
+float Envelope::advance(Stage &stage, float &level, int frames, float releaseSpeed) const
+{
+    float remaining = static_cast<float>(frames);
+    float rate;
+    float target;
+    Stage next;
+    while (remaining > 0.0f && slope(stage, releaseSpeed, rate, target, next)) {
+        // Frames the current stage still lasts: it either covers the rest, or ends and the next one starts
+        const float distance = target - level;
+        const float stageFrames = std::abs(distance) / rate;
+        if (stageFrames > remaining) {
+            level += distance > 0.0f ? rate * remaining : -rate * remaining;
+            return level;
+        }
+        level = target;
+        stage = next;
+        remaining -= stageFrames;
+    }
+    if (stage == Done) {
+        level = 0.0f;
+    }
+    return level;
+}
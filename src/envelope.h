@@ -0,0 +1,82 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <cstdint>
+
+// Amplitude envelope of a voice: attack, decay, sustain, release, plus the slow
+// fade of a sustain loop (a looped note has no natural decay of its own).
+//
+// The envelope is evaluated on sub-block boundaries rather than per frame: the
+// mixer asks for the level at the end of the next ramp and moves the voice gain
+// linearly towards it inside the mix kernel, so a moving envelope is one
+// multiply-add per sample and a steady one (Sustain) costs nothing beyond the
+// voice's constant gain. Every stage is linear in amplitude, so one ramp covers
+// all the whole sub-blocks a stage has left and the gain only bends on a
+// sub-block boundary; a voice is only retired once its level has reached zero.
+struct EnvelopeSettings {
+    static constexpr double defaultReleaseMs = 150.0;
+    static constexpr double defaultLoopFadeMs = 5000.0;
+
+    double attackMs = 0.0;  // Silence to full level; 0 starts at full level (the sample's own attack)
+    double decayMs = 0.0;  // Full level to the sustain level
+    double sustainLevel = 1.0;  // Linear, 0..1
+    double releaseMs = defaultReleaseMs;  // Full level to silence after key and damper release
+    double loopFadeMs = defaultLoopFadeMs;  // Full level to silence while sustaining through a loop
+};
+
+class Envelope {
+public:
+    enum Stage : std::uint8_t {
+        Attack,
+        Decay,
+        Sustain,
+        LoopFade,  // Sustained through the sample's loop
+        Release,
+        Done  // Silent: the voice can be retired
+    };
+
+    static const int blockFrames = 32;  // Envelope resolution (~0.7 ms at 44.1 kHz)
+
+    Envelope();
+
+    void setup(const EnvelopeSettings &settings, int sampleRate);
+    const EnvelopeSettings &settings() const { return current; }
+
+    // Stage and level of a new voice
+    void start(Stage &stage, float &level) const;
+
+    // Moves a voice into Release (or LoopFade) from wherever it is, keeping its level
+    static void release(Stage &stage) { stage = Release; }
+    static void fade(Stage &stage) { stage = LoopFade; }
+
+    // releaseSpeed below scales the release rate of a voice: the damping of its string relative
+    // to the release time (per note, and less with the damper pedal part way down); 0 holds a
+    // released voice at its level until the damper comes back down.
+
+    // Whether the level stays put in this stage (no ramp needed, any block length)
+    static bool steady(Stage stage, float releaseSpeed = 1.0f)
+    {
+        return stage == Sustain || (stage == Release && releaseSpeed <= 0.0f);
+    }
+
+    // Frames of the next ramp: to the last sub-block boundary before the stage ends (at least
+    // one sub-block, so a stage transition falls inside a ramp of blockFrames)
+    int rampFrames(Stage stage, float level, float releaseSpeed = 1.0f) const;
+
+    // Advances a voice by frames, moving through the stages as each one ends; returns the new level
+    float advance(Stage &stage, float &level, int frames, float releaseSpeed = 1.0f) const;
+
+private:
+    // Rate (magnitude), end level and successor of a moving stage; false for a steady one
+    bool slope(Stage stage, float releaseSpeed, float &rate, float &target, Stage &next) const;
+
+    EnvelopeSettings current;
+    // Level change per frame of each stage (magnitude)
+    float attackRate;
+    float decayRate;
+    float sustainLevel;
+    float releaseRate;
+    float loopFadeRate;
+};
+
+#endif // ENVELOPE_H
@@ -0,0 +1,143 @@
+#include "jackbackend.h"
+#include "pianoengine.h"
+
+#include <jack/jack.h>
+
+#include <algorithm>
+#include <string>
+
+static bool fail(std::string *errorMessage, const std::string &message)
+{
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+    return false;
+}
+
+JackBackend::JackBackend()
+    : client(nullptr), engine(nullptr), running(false), portLatencyFrames(0), xruns(0)
+{
+}
+
+JackBackend::~JackBackend()
+{
+    stop();
+}
+
+bool JackBackend::open(const AudioSettings &requested, std::string *errorMessage)
+{
+    stop();
+    current = requested;
+    current.backend = name();
+    if (current.channels <= 0 || current.channels > AudioSettings::maxChannels) {
+        return fail(errorMessage, "Unsupported channel count for JACK: " + std::to_string(current.channels));
+    }
+    jack_status_t status;
+    client = jack_client_open("CplusplusPiano", JackNoStartServer, &status);
+    if (!client) {
+        return fail(errorMessage, "Failed to connect to the JACK server (status " + std::to_string(status) + ")");
+    }
+
+    // The server decides these; the engine is set up for them instead of the request
+    current.sampleRate = static_cast<int>(jack_get_sample_rate(client));
+    current.bufferFrames = static_cast<int>(jack_get_buffer_size(client));
+    current.periods = 1;  // The server's period count is its own business; its latency is read below
+
+    ports.clear();
+    for (int ch = 0; ch < current.channels; ++ch) {
+        const std::string portName = "out_" + std::to_string(ch + 1);
+        jack_port_t *port = jack_port_register(client, portName.c_str(), JACK_DEFAULT_AUDIO_TYPE,
+                                               JackPortIsOutput, 0);
+        if (!port) {
+            close();
+            return fail(errorMessage, "Failed to register JACK port " + portName);
+        }
+        ports.push_back(port);
+    }
+    if (jack_set_process_callback(client, processCallback, this) != 0 ||
+        jack_set_xrun_callback(client, xrunCallback, this) != 0) {
+        close();
+        return fail(errorMessage, "Failed to set the JACK callbacks");
+    }
+    buffer.assign(static_cast<std::size_t>(current.bufferFrames) * current.channels, 0.0f);
+    return true;
+}
+
+bool JackBackend::start(PianoEngine *engine, std::string *errorMessage)
+{
+    if (!client) {
+        return fail(errorMessage, "The jack backend is not open");
+    }
+    this->engine = engine;
+    resetCounters();
+    xruns.store(0, std::memory_order_relaxed);
+    if (jack_activate(client) != 0) {
+        return fail(errorMessage, "Failed to activate the JACK client");
+    }
+    running = true;
+
+    // Connect to the physical outputs, or the ports the device pattern names, one per channel
+    const char **targets = current.device.empty()
+        ? jack_get_ports(client, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput)
+        : jack_get_ports(client, current.device.c_str(), JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput);
+    if (targets) {
+        for (std::size_t ch = 0; ch < ports.size() && targets[ch]; ++ch) {
+            jack_connect(client, jack_port_name(ports[ch]), targets[ch]);
+        }
+        jack_free(targets);
+    }
+    if (!ports.empty()) {
+        jack_latency_range_t range;
+        jack_port_get_latency_range(ports[0], JackPlaybackLatency, &range);
+        portLatencyFrames = static_cast<int>(range.max);
+    }
+    return true;
+}
+
+void JackBackend::stop()
+{
+    if (client && running) {
+        jack_deactivate(client);
+    }
+    running = false;
+    close();
+}
+
+void JackBackend::close()
+{
+    if (client) {
+        jack_client_close(client);  // Unregisters the ports
+        client = nullptr;
+    }
+    ports.clear();
+}
+
+int JackBackend::processCallback(jack_nframes_t frames, void *arg)
+{
+    JackBackend *backend = static_cast<JackBackend *>(arg);
+    const int channels = static_cast<int>(backend->ports.size());
+    const int chunkFrames = static_cast<int>(backend->buffer.size()) / channels;
+    float *interleaved = backend->buffer.data();
+
+    float *outputs[AudioSettings::maxChannels];
+    for (int ch = 0; ch < channels; ++ch) {
+        outputs[ch] = static_cast<float *>(jack_port_get_buffer(backend->ports[ch], frames));
+    }
+    for (int done = 0; done < static_cast<int>(frames);) {
+        const int count = std::min(chunkFrames, static_cast<int>(frames) - done);
+        backend->renderBuffer(backend->engine, interleaved, count);
+        for (int i = 0; i < count; ++i) {
+            for (int ch = 0; ch < channels; ++ch) {
+                outputs[ch][done + i] = interleaved[i * channels + ch];
+            }
+        }
+        done += count;
+    }
+    return 0;
+}
+
+int JackBackend::xrunCallback(void *arg)
+{
+    static_cast<JackBackend *>(arg)->xruns.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+}
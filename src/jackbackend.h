@@ -0,0 +1,46 @@
+#ifndef JACKBACKEND_H
+#define JACKBACKEND_H
+
+#include "audiobackend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+typedef struct _jack_client jack_client_t;
+typedef struct _jack_port jack_port_t;
+typedef std::uint32_t jack_nframes_t;
+
+// Output as a JACK client ("CplusplusPiano", one port per channel), connected to the
+// physical playback ports or to the ports matching settings().device. The server owns the
+// sample rate and buffer size, so settings() report its values rather than the request.
+// JACK's process thread renders into an interleaved float buffer and splits it into the
+// port buffers; a server buffer larger than the one seen at open() is rendered in pieces.
+// Xruns are the ones the server reports for the whole graph.
+class JackBackend : public AudioBackend {
+public:
+    JackBackend();
+    ~JackBackend() override;
+
+    const char *name() const override { return "jack"; }
+    bool open(const AudioSettings &requested, std::string *errorMessage = nullptr) override;
+    bool start(PianoEngine *engine, std::string *errorMessage = nullptr) override;
+    void stop() override;
+    int latencyFrames() const override { return current.bufferFrames + portLatencyFrames; }
+    std::uint64_t xrunCount() const override { return xruns.load(std::memory_order_relaxed); }
+
+private:
+    static int processCallback(jack_nframes_t frames, void *arg);
+    static int xrunCallback(void *arg);
+    void close();
+
+    jack_client_t *client;
+    std::vector<jack_port_t *> ports;
+    std::vector<float> buffer;  // Interleaved, one server buffer as of open()
+    PianoEngine *engine;
+    bool running;
+    int portLatencyFrames;  // Playback latency of the connected ports
+    std::atomic<std::uint64_t> xruns;
+};
+
+#endif // JACKBACKEND_H
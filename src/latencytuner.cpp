@@ -0,0 +1,56 @@
+#include "latencytuner.h"
+
+#include <algorithm>
+
+LatencyTuner::LatencyTuner()
+{
+    reset();
+}
+
+void LatencyTuner::reset(int startFrames)
+{
+    frames = minBufferFrames;
+    while (frames < std::min(startFrames, static_cast<int>(maxBufferFrames))) {
+        frames *= 2;
+    }
+    grantedFrames = 0;
+    atLimit = false;
+    isSettled = false;
+    steps = 0;
+    baseline = 0;
+}
+
+void LatencyTuner::deviceStarted(int granted)
+{
+    // A step-up the device rounded back down to (or below) the previous size gains nothing
+    if (grantedFrames > 0 && granted <= grantedFrames) {
+        atLimit = true;
+    }
+    grantedFrames = granted;
+    frames = granted;  // The device's rounding, up or down, is what is being tuned
+    atLimit = atLimit || frames >= maxBufferFrames;
+    baseline = 0;
+}
+
+bool LatencyTuner::update(std::uint64_t xruns, std::uint64_t deadlineMisses, int elapsedMs)
+{
+    const std::uint64_t problems = xruns + deadlineMisses;
+    if (elapsedMs < graceMs) {
+        baseline = problems;
+        return false;
+    }
+    if (problems > baseline) {
+        baseline = problems;
+        isSettled = false;
+        if (atLimit) {
+            return false;  // Nothing larger to try; keep going as is
+        }
+        frames = std::min(frames * 2, static_cast<int>(maxBufferFrames));
+        ++steps;
+        return true;
+    }
+    if (elapsedMs >= settleMs) {
+        isSettled = true;
+    }
+    return false;
+}
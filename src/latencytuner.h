@@ -0,0 +1,47 @@
+#ifndef LATENCYTUNER_H
+#define LATENCYTUNER_H
+
+#include <cstdint>
+
+// Finds the smallest device buffer this machine plays without glitches.
+//
+// Starts at the smallest buffer size (or one that settled on an earlier run) and only ever
+// steps up: when the backend reports an xrun or a deadline miss, the buffer doubles and the
+// device is reopened with it. A size that then runs clean for settleMs is settled, i.e. worth
+// remembering for the next launch. The first graceMs after each device start don't count:
+// starting a device, and the sample loading that goes on at launch, can glitch once on any
+// machine. If the device doesn't grant a larger buffer than before, the tuner stops there.
+//
+// No threads of its own: the app polls it from a timer with the backend's counters.
+class LatencyTuner {
+public:
+    static const int minBufferFrames = 32;
+    static const int maxBufferFrames = 2048;
+    static const int graceMs = 2000;
+    static const int settleMs = 30000;
+
+    LatencyTuner();
+
+    // Starts over at startFrames (rounded up to a power of two in range)
+    void reset(int startFrames = minBufferFrames);
+    // Buffer size to open the device with
+    int bufferFrames() const { return frames; }
+    bool settled() const { return isSettled; }
+    int stepCount() const { return steps; }
+
+    // After the device (re)started, with the buffer size it actually granted
+    void deviceStarted(int grantedFrames);
+    // Polled with the backend's counters since its start and the time since deviceStarted();
+    // true when the buffer should grow - reopen the device with bufferFrames()
+    bool update(std::uint64_t xruns, std::uint64_t deadlineMisses, int elapsedMs);
+
+private:
+    int frames;
+    int grantedFrames;  // What the device gave for the current size, 0 before the first start
+    bool atLimit;  // The device won't go larger, or maxBufferFrames is reached
+    bool isSettled;
+    int steps;
+    std::uint64_t baseline;  // Xruns plus misses at the end of the grace period
+};
+
+#endif // LATENCYTUNER_H
@@ -0,0 +1,172 @@
+#include "limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+Limiter::Limiter()
+    : lookaheadMs(defaultLookaheadMs), releaseMs(defaultReleaseMs), ceilingDb(defaultCeilingDb), channels(1),
+      lookahead(1), ceiling(32768.0f), releaseCoefficient(1.0f), delayPos(0), holdHead(0), holdTail(0),
+      holdCount(0), envelope(1.0f), averageSum(0.0), averagePos(0), frameCounter(0), lowest(1.0f)
+{
+}
+
+void Limiter::setup(int sampleRate, int channelCount, double lookaheadMilliseconds, double releaseMilliseconds,
+                    double ceilingDecibels)
+{
+    lookaheadMs = lookaheadMilliseconds;
+    releaseMs = releaseMilliseconds;
+    ceilingDb = ceilingDecibels;
+    channels = std::max(1, channelCount);
+    lookahead = std::max(1, static_cast<int>(std::lround(lookaheadMs * sampleRate / 1000.0)));
+    ceiling = static_cast<float>(32768.0 * std::pow(10.0, ceilingDb / 20.0));
+    const double releaseFrames = releaseMs * sampleRate / 1000.0;
+    releaseCoefficient = releaseFrames > 1.0 ? static_cast<float>(1.0 - std::exp(-1.0 / releaseFrames)) : 1.0f;
+
+    delayLine.assign(static_cast<size_t>(lookahead) * channels, 0.0f);
+    spareDelayLine.assign(delayLine.size(), 0.0f);
+    holdGain.assign(lookahead + 1, 1.0f);
+    holdFrame.assign(lookahead + 1, 0);
+    averageRing.assign(lookahead, 1.0f);
+    reset();
+}
+
+void Limiter::reset()
+{
+    std::fill(delayLine.begin(), delayLine.end(), 0.0f);
+    std::fill(averageRing.begin(), averageRing.end(), 1.0f);
+    delayPos = 0;
+    holdHead = 0;
+    holdTail = 0;
+    holdCount = 0;
+    envelope = 1.0f;
+    averageSum = lookahead;
+    averagePos = 0;
+    frameCounter = 0;
+    lowest = 1.0f;
+}
+
+void Limiter::process(float *mix, int frames, float gain)
+{
+    // Block peak, with independent running maxima so the loop vectorizes
+    const int samples = frames * channels;
+    float peaks[8] = {};
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            const float value = std::abs(mix[i + k]);
+            peaks[k] = peaks[k] < value ? value : peaks[k];
+        }
+    }
+    float peak = *std::max_element(peaks, peaks + 8);
+    for (; i < samples; ++i) {
+        peak = std::max(peak, std::abs(mix[i]));
+    }
+
+    // Idle (every held and averaged gain is exactly 1) and nothing in this block to
+    // limit: the output is just the scaled input, delayed
+    const bool idle = envelope == 1.0f && (holdCount == 0 || holdGain[holdHead] == 1.0f) &&
+                      averageSum == lookahead;
+    if (idle && peak * gain <= ceiling && frames >= lookahead) {
+        delayBlock(mix, frames, gain);
+    } else {
+        limitBlock(mix, frames, gain);
+    }
+}
+
+void Limiter::delayBlock(float *mix, int frames, float gain)
+{
+    const int samples = frames * channels;
+    const int delayed = lookahead * channels;
+
+    if (gain != 1.0f) {
+        for (int i = 0; i < samples; ++i) {
+            mix[i] *= gain;
+        }
+    }
+    // The last lookahead frames become the next delay line; the current one
+    // (oldest frame at delayPos) goes out first
+    std::memcpy(spareDelayLine.data(), mix + samples - delayed, delayed * sizeof(float));
+    std::memmove(mix + delayed, mix, (samples - delayed) * sizeof(float));
+    const int oldest = delayPos * channels;
+    std::memcpy(mix, delayLine.data() + oldest, (delayed - oldest) * sizeof(float));
+    std::memcpy(mix + delayed - oldest, delayLine.data(), oldest * sizeof(float));
+    delayLine.swap(spareDelayLine);
+    delayPos = 0;
+
+    // Every frame needed gain 1: the queue collapses to the newest one
+    holdHead = 0;
+    holdTail = 1;
+    holdCount = 1;
+    holdGain[0] = 1.0f;
+    holdFrame[0] = frameCounter + frames - 1;
+    frameCounter += frames;
+}
+
+void Limiter::limitBlock(float *mix, int frames, float gain)
+{
+    const int window = lookahead + 1;  // The required gain of frame n covers output frames n-lookahead..n
+
+    for (int frame = 0; frame < frames; ++frame) {
+        float *samples = mix + frame * channels;
+
+        // Gain this frame needs to stay under the ceiling
+        float peak = 0.0f;
+        for (int ch = 0; ch < channels; ++ch) {
+            peak = std::max(peak, std::abs(samples[ch]));
+        }
+        peak *= gain;
+        const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Sliding minimum: expire the frame that left the window, drop queued values
+        // the new one undercuts, then queue it. The front is the window's minimum.
+        if (holdCount > 0 && frameCounter - holdFrame[holdHead] >= static_cast<std::uint32_t>(window)) {
+            holdHead = holdHead + 1 == window ? 0 : holdHead + 1;
+            --holdCount;
+        }
+        while (holdCount > 0) {
+            const int back = holdTail == 0 ? window - 1 : holdTail - 1;
+            if (holdGain[back] < required) {
+                break;
+            }
+            holdTail = back;
+            --holdCount;
+        }
+        holdGain[holdTail] = required;
+        holdFrame[holdTail] = frameCounter;
+        holdTail = holdTail + 1 == window ? 0 : holdTail + 1;
+        ++holdCount;
+        const float held = holdGain[holdHead];
+
+        // Instant attack (the averaging below smooths it), exponential release
+        if (held < envelope) {
+            envelope = held;
+        } else {
+            // Settle exactly once the step no longer registers in float (close to 1 it
+            // stalls around 1e-4 short), so an idle limiter is bit-transparent
+            const float next = envelope + (held - envelope) * releaseCoefficient;
+            envelope = (next == envelope || held - next < 1e-6f) ? held : next;
+        }
+
+        // Moving average over the lookahead turns the held steps into ramps
+        averageSum += envelope - averageRing[averagePos];
+        averageRing[averagePos] = envelope;
+        averagePos = averagePos + 1 == lookahead ? 0 : averagePos + 1;
+        const float applied = std::min(1.0f, static_cast<float>(averageSum / lookahead));
+        lowest = std::min(lowest, applied);
+
+        // Emit the frame from lookahead frames ago and queue this one in its place
+        float *delayed = delayLine.data() + static_cast<size_t>(delayPos) * channels;
+        for (int ch = 0; ch < channels; ++ch) {
+            const float input = samples[ch] * gain;
+            samples[ch] = std::clamp(delayed[ch] * applied, -ceiling, ceiling);
+            delayed[ch] = input;
+        }
+        delayPos = delayPos + 1 == lookahead ? 0 : delayPos + 1;
+        ++frameCounter;
+    }
+
+    // Re-sum once per block so rounding in the running sum can't accumulate
+    averageSum = std::accumulate(averageRing.begin(), averageRing.end(), 0.0);
+}
@@ -0,0 +1,81 @@
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <cstdint>
+#include <vector>
+
+// Master gain and lookahead brickwall limiter at the end of the float mix bus.
+//
+// The output is delayed by the lookahead. For every frame the gain needed to keep
+// its peak under the ceiling is held for the whole lookahead window (sliding
+// minimum), released exponentially, and then averaged over the lookahead, so the
+// gain ramps down linearly *before* a peak arrives and is at or below the required
+// value when it does - no frame leaves above the ceiling, and there is no clipping
+// distortion. A final clamp catches rounding. With nothing to limit the gain is
+// exactly 1 and the output is the delayed input, bit for bit.
+//
+// Master gain and limiting run in one pass over the block, in place. The gain
+// envelope is a per-frame recurrence, so that pass is scalar - but while the
+// limiter is idle and a block has no peak over the ceiling (the usual case), the
+// block is only scaled and delayed, which vectorizes.
+class Limiter {
+public:
+    static constexpr double defaultLookaheadMs = 1.5;
+    static constexpr double defaultReleaseMs = 80.0;
+    static constexpr double defaultCeilingDb = -0.3;  // dBFS
+
+    Limiter();
+
+    // Setup (not real-time safe): allocates the delay line and clears the state
+    void setup(int sampleRate, int channels, double lookaheadMs = defaultLookaheadMs,
+               double releaseMs = defaultReleaseMs, double ceilingDb = defaultCeilingDb);
+    // Same, keeping the current lookahead, release and ceiling
+    void setFormat(int sampleRate, int channels) { setup(sampleRate, channels, lookaheadMs, releaseMs, ceilingDb); }
+    // Silence the delay line and release all gain reduction
+    void reset();
+
+    // Delay added to the output, in frames
+    int latency() const { return lookahead; }
+
+    // Applies gain to frames of interleaved mix (16-bit sample units) and limits
+    // them in place; the result never exceeds the ceiling
+    void process(float *mix, int frames, float gain);
+
+    // Lowest gain applied since the last reset (1 = never limited)
+    float lowestGain() const { return lowest; }
+
+private:
+    void delayBlock(float *mix, int frames, float gain);
+    void limitBlock(float *mix, int frames, float gain);
+
+    double lookaheadMs;
+    double releaseMs;
+    double ceilingDb;
+
+    int channels;
+    int lookahead;  // Frames
+    float ceiling;  // In 16-bit sample units
+    float releaseCoefficient;
+
+    std::vector<float> delayLine;  // lookahead frames, interleaved
+    std::vector<float> spareDelayLine;  // Swapped with delayLine by delayBlock()
+    int delayPos;
+
+    // Sliding minimum of the required gain over lookahead + 1 frames (monotonic queue,
+    // front at holdHead, back just before holdTail)
+    std::vector<float> holdGain;
+    std::vector<std::uint32_t> holdFrame;
+    int holdHead;
+    int holdTail;
+    int holdCount;
+
+    float envelope;  // Held gain after release smoothing
+    std::vector<float> averageRing;  // Last lookahead envelope values
+    double averageSum;
+    int averagePos;
+
+    std::uint32_t frameCounter;
+    float lowest;
+};
+
+#endif // LIMITER_H
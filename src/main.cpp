@@ -1,13 +1,91 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QStringList>
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
-    
-    MainWindow window;
+
+    // Audio output options - anything not given comes from the last run (the platform's
+    // default device on the first), and the buffer size is tuned unless --buffer fixes it
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QStringList backends = [] {
+        QStringList names;
+        for (const std::string &name : AudioBackend::availableBackends()) {
+            names << QString::fromStdString(name);
+        }
+        return names;
+    }();
+    QCommandLineOption backendOption("audio", "Audio backend: " + backends.join(", ") + " (default: " +
+                                     backends.first() + ").", "backend");
+    QCommandLineOption deviceOption("device", "Output device (backend-specific; default: the system default).",
+                                    "name");
+    QCommandLineOption rateOption("rate", "Output sample rate in Hz: 44100, 48000, 96000, ... "
+                                  "(default: as last time, else 44100).", "hz");
+    QCommandLineOption bufferOption("buffer", "Frames per audio callback; turns off latency tuning.", "frames");
+    QCommandLineOption retuneOption("retune", "Forget the tuned buffer size and tune again from the smallest.");
+    QCommandLineOption periodsOption("periods", "Periods in the device buffer, ALSA only (default: 2).", "n");
+    QCommandLineOption outputOption("output", "With --audio file: the WAV file to write.", "file.wav");
+    QCommandLineOption telemetryOption("telemetry-log", "Append audio thread telemetry to this file (JSON lines).",
+                                       "file");
+    QCommandLineOption intervalOption("telemetry-interval", "Telemetry log interval in ms (default: 1000).", "ms",
+                                      "1000");
+    // MIDI input: the first device input built in (the virtual one only takes input from code)
+    QString defaultMidi = "none";
+    for (const std::string &name : MidiInput::availableInputs()) {
+        if (name != "virtual") {
+            defaultMidi = QString::fromStdString(name);
+            break;
+        }
+    }
+    QCommandLineOption midiOption("midi", "MIDI input: alsa (where built) or none (default: " + defaultMidi + ").",
+                                  "input", defaultMidi);
+    QCommandLineOption midiPortOption("midi-port", "MIDI source to connect, ALSA: client:port or client name "
+                                      "(default: every hardware source).", "port");
+    parser.addOptions({backendOption, deviceOption, rateOption, bufferOption, retuneOption, periodsOption,
+                       outputOption, telemetryOption, intervalOption, midiOption, midiPortOption});
+    parser.process(app);
+
+    AudioSettings audioSettings = MainWindow::savedAudioSettings();
+    if (parser.isSet(backendOption)) {
+        // Another backend: its saved device and buffer size don't apply
+        const std::string backend = parser.value(backendOption).toStdString();
+        if (backend != audioSettings.backend) {
+            audioSettings.device.clear();
+            audioSettings.bufferFrames = LatencyTuner::minBufferFrames;
+        }
+        audioSettings.backend = backend;
+    }
+    if (parser.isSet(deviceOption)) {
+        audioSettings.device = parser.value(deviceOption).toStdString();
+    }
+    if (parser.isSet(retuneOption)) {
+        audioSettings.bufferFrames = LatencyTuner::minBufferFrames;
+    }
+    audioSettings.outputPath = parser.value(outputOption).toStdString();
+    if (parser.isSet(rateOption)) {
+        audioSettings.sampleRate = parser.value(rateOption).toInt();
+    }
+    if (parser.isSet(bufferOption)) {
+        audioSettings.bufferFrames = parser.value(bufferOption).toInt();
+    }
+    if (parser.isSet(periodsOption)) {
+        audioSettings.periods = parser.value(periodsOption).toInt();
+    }
+    if (audioSettings.sampleRate <= 0 || audioSettings.bufferFrames <= 0 || audioSettings.periods <= 0) {
+        parser.showHelp(2);
+    }
+
+    MainWindow window(audioSettings, !parser.isSet(bufferOption));
+    if (parser.isSet(telemetryOption)) {
+        window.startTelemetryLog(parser.value(telemetryOption), parser.value(intervalOption).toInt());
+    }
+    if (parser.value(midiOption) != "none") {
+        window.startMidi(parser.value(midiOption), parser.value(midiPortOption));
+    }
     window.show();
-    
+
     return app.exec();
 }
-
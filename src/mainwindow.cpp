@@ -1,4 +1,6 @@
 #include "mainwindow.h"
+#include "notenames.h"
+#include "sampleset.h"
 #include <QLabel>
 #include <QWidget>
 #include <Qt>
@@ -12,22 +14,22 @@
 #include <QStandardPaths>
 #include <QFileInfo>
 #include <QCoreApplication>
-#include <QSet>
-#include <QMutex>
 #include <QVector>
 #include <QKeyEvent>
 #include <QTimer>
-#include <AudioToolbox/AudioToolbox.h>
-#include <CoreAudio/CoreAudio.h>
+#include <QSettings>
+#include <algorithm>
 #include <cmath>
 #include <QDebug>
 
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), audioUnit(nullptr), outputSampleRate(44100), outputChannels(2),
-      unaCordaActive(false), damperPedalActive(false)
+MainWindow::MainWindow(const AudioSettings &audioSettings, bool tuneLatency, QWidget *parent)
+    : QMainWindow(parent), samplesPending(0), firstSampleLogged(false), requestedAudio(audioSettings),
+      tuneLatency(tuneLatency), latencyTimer(nullptr), telemetryTimer(nullptr)
 {
+    startupTimer.start();
     setupUI();  // Must be called first to create pianoKeys
-    setupAudio();  // Preload audio files after keys are created
+    setupAudio();  // Start the device right away - notes become playable as samples load
+    loadSamples();  // Background loading, uses the keys to find the notes
     connectKeySignals();
     setWindowTitle("Virtual Piano");
     
@@ -35,20 +37,25 @@ MainWindow::MainWindow(QWidget *parent)
     setFocusPolicy(Qt::StrongFocus);
     setFocus();  // Ensure window has focus to receive keyboard events
     
-    // Initialize low-pass filter state (one per channel)
-    lowPassFilterState.resize(outputChannels);
-    for (int i = 0; i < outputChannels; ++i) {
-        lowPassFilterState[i] = 0.0;
-    }
+    // Runs once the event loop starts, i.e. right after the window is shown
+    QTimer::singleShot(0, this, [this]() {
+        qDebug() << "Window shown" << startupTimer.elapsed() << "ms after startup";
+    });
 }
 
 MainWindow::~MainWindow()
 {
-    // Stop and cleanup Core Audio
-    if (audioUnit) {
-        AudioOutputUnitStop(audioUnit);
-        AudioUnitUninitialize(audioUnit);
-        AudioComponentInstanceDispose(audioUnit);
+    // Loader callbacks post to this window - make sure none are still running
+    engine.stopLoading();
+    
+    // Stop the MIDI and device threads before the engine they feed and pull from goes away (and
+    // the telemetry log before the backend whose telemetry it reads)
+    if (midi) {
+        midi->stop();
+    }
+    telemetryLog.stop();
+    if (audio) {
+        audio->stop();
     }
 }
 
@@ -218,6 +225,27 @@ void MainWindow::setupUI()
     );
     pedalLayout->addWidget(quitLabel);
     
+    // Output latency, filled in once the device is running
+    latencyLabel = new QLabel("Audio: not started", centralWidget);
+    latencyLabel->setStyleSheet(
+        "QLabel {"
+        "  font-size: 14px;"
+        "  padding: 5px;"
+        "  color: #666666;"
+        "}"
+    );
+    pedalLayout->addWidget(latencyLabel);
+    
+    telemetryLabel = new QLabel(centralWidget);
+    telemetryLabel->setStyleSheet(
+        "QLabel {"
+        "  font-size: 14px;"
+        "  padding: 5px;"
+        "  color: #666666;"
+        "}"
+    );
+    pedalLayout->addWidget(telemetryLabel);
+    
     mainLayout->addLayout(pedalLayout);
     
     // Resize window to fit the piano keys with symmetric margins
@@ -310,600 +338,328 @@ void MainWindow::setupUI()
     setCentralWidget(centralWidget);
 }
 
-QByteArray MainWindow::loadWavPcmData(const QString &filePath, int &sampleRate, int &channels)
+void MainWindow::setupAudio()
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open WAV file:" << filePath;
-        return QByteArray();
+    std::string error;
+    audio = AudioBackend::create(requestedAudio.backend, &error);
+    if (!audio) {
+        qWarning() << QString::fromStdString(error);
+        return;
     }
-    
-    QDataStream stream(&file);
-    stream.setByteOrder(QDataStream::LittleEndian);
-    
-    // Read RIFF header
-    char riff[4], wave[4];
-    quint32 fileSize;
-    stream.readRawData(riff, 4);
-    stream >> fileSize;
-    stream.readRawData(wave, 4);
-    
-    if (QByteArray(riff, 4) != "RIFF" || QByteArray(wave, 4) != "WAVE") {
-        qWarning() << "Invalid WAV file format:" << filePath;
-        file.close();
-        return QByteArray();
+    if (tuneLatency) {
+        latencyTuner.reset(requestedAudio.bufferFrames);
+        requestedAudio.bufferFrames = latencyTuner.bufferFrames();
     }
+    if (!startAudio()) {
+        audio.reset();
+        return;
+    }
+    saveAudioSettings();
     
-    // Read fmt chunk to get audio format
-    char chunkId[4];
-    quint32 chunkSize;
-    quint16 audioFormat, numChannels;
-    quint32 fileSampleRate, byteRate;
-    quint16 blockAlign, bitsPerSample;
+    // Reads the backend's telemetry; never touches the audio thread
+    telemetryTimer = new QTimer(this);
+    connect(telemetryTimer, &QTimer::timeout, this, &MainWindow::updateTelemetryLabel);
+    telemetryTimer->start(500);
     
-    bool foundFmt = false;
-    while (!stream.atEnd()) {
-        stream.readRawData(chunkId, 4);
-        stream >> chunkSize;
-        
-        if (QByteArray(chunkId, 4) == "fmt ") {
-            stream >> audioFormat;  // Should be 1 for PCM
-            stream >> numChannels;
-            stream >> fileSampleRate;
-            stream >> byteRate;
-            stream >> blockAlign;
-            stream >> bitsPerSample;
-            
-            sampleRate = fileSampleRate;
-            channels = numChannels;
-            
-            if (bitsPerSample != 16) {
-                qWarning() << "Only 16-bit PCM is supported:" << filePath;
-                file.close();
-                return QByteArray();
-            }
-            
-            foundFmt = true;
-            break;
-        } else {
-            // Skip this chunk
-            file.seek(file.pos() + chunkSize);
-        }
+    if (tuneLatency) {
+        latencyTimer = new QTimer(this);
+        connect(latencyTimer, &QTimer::timeout, this, &MainWindow::checkLatency);
+        latencyTimer->start(500);
     }
-    
-    if (!foundFmt) {
-        qWarning() << "Could not find fmt chunk in WAV file:" << filePath;
-        file.close();
-        return QByteArray();
+}
+
+bool MainWindow::startAudio()
+{
+    // Open the device first: it may not agree to the requested rate or buffer size, and the
+    // engine is set up for what it actually runs at
+    std::string error;
+    if (!audio->open(requestedAudio, &error)) {
+        qWarning() << "Failed to open" << audio->name() << "audio output:" << QString::fromStdString(error);
+        return false;
+    }
+    const AudioSettings &device = audio->settings();
+    if (device.sampleRate != engine.sampleRate() || device.channels != engine.channels() || !audioClock.isValid()) {
+        // Every engine buffer is preallocated for the largest callback the device may ask for -
+        // and, while tuning, for the largest buffer the tuner may step up to, so reopening the
+        // device never touches the engine
+        const int maxFrames = std::max(audio->maxCallbackFrames(),
+                                       tuneLatency ? static_cast<int>(LatencyTuner::maxBufferFrames) : 0);
+        engine.setOutputFormat(device.sampleRate, device.channels, maxFrames);
+    }
+    if (!audio->start(&engine, &error)) {
+        qWarning() << "Failed to start" << audio->name() << "audio output:" << QString::fromStdString(error);
+        return false;
+    }
+    audioClock.start();
+    if (tuneLatency) {
+        latencyTuner.deviceStarted(device.bufferFrames);
+    }
+    
+    qDebug() << "Audio output started:" << audio->name();
+    qDebug() << "  Sample rate:" << device.sampleRate << "Hz";
+    qDebug() << "  Channels:" << device.channels;
+    qDebug() << "  Buffer:" << device.bufferFrames << "frames x" << device.periods;
+    qDebug() << "  Output latency:" << (audio->latencyFrames() + engine.outputLatency()) * 1000.0 / device.sampleRate
+             << "ms";
+    updateLatencyLabel();
+    return true;
+}
+
+void MainWindow::checkLatency()
+{
+    if (!audio) {
+        return;
     }
-    
-    // Find "data" chunk
-    file.seek(12);  // Reset to after WAVE header
-    quint32 dataSize = 0;
-    qint64 dataOffset = -1;
-    
-    while (!stream.atEnd()) {
-        stream.readRawData(chunkId, 4);
-        stream >> chunkSize;
-        
-        if (QByteArray(chunkId, 4) == "data") {
-            dataOffset = file.pos();
-            dataSize = chunkSize;
-            break;
-        } else {
-            // Skip this chunk
-            file.seek(file.pos() + chunkSize);
+    // Loading decodes on every core: glitches while it runs say nothing about the buffer size,
+    // so the tuner's clock only runs once it is done
+    const int elapsedMs = samplesPending > 0 ? 0 : static_cast<int>(audioClock.elapsed());
+    const bool wasSettled = latencyTuner.settled();
+    if (latencyTuner.update(audio->xrunCount(), audio->deadlineMissCount(), elapsedMs)) {
+        qDebug() << "Audio glitch at" << audio->settings().bufferFrames << "frames ("
+                 << audio->xrunCount() << "xruns," << audio->deadlineMissCount()
+                 << "deadline misses), trying" << latencyTuner.bufferFrames();
+        audio->stop();
+        requestedAudio.bufferFrames = latencyTuner.bufferFrames();
+        if (!startAudio()) {
+            telemetryLog.stop();
+            audio.reset();
+            latencyLabel->setText("Audio: stopped");
+            return;
         }
+        saveAudioSettings();
+    } else if (latencyTuner.settled() && !wasSettled) {
+        qDebug() << "Audio buffer settled at" << audio->settings().bufferFrames << "frames";
+        saveAudioSettings();
+        updateLatencyLabel();
     }
-    
-    file.close();
-    
-    if (dataOffset == -1) {
-        qWarning() << "Could not find data chunk in WAV file:" << filePath;
-        return QByteArray();
-    }
-    
-    // Read the actual PCM data
-    if (!file.open(QIODevice::ReadOnly)) {
-        return QByteArray();
+}
+
+void MainWindow::updateLatencyLabel()
+{
+    const AudioSettings &device = audio->settings();
+    const double latencyMs = (audio->latencyFrames() + engine.outputLatency()) * 1000.0 / device.sampleRate;
+    QString text = QString("Latency: %1 ms (%2 frames @ %3 kHz, %4)")
+        .arg(latencyMs, 0, 'f', 1)
+        .arg(device.bufferFrames)
+        .arg(device.sampleRate / 1000.0)
+        .arg(audio->name());
+    if (tuneLatency && !latencyTuner.settled()) {
+        text += " - tuning";
+    }
+    latencyLabel->setText(text);
+}
+
+void MainWindow::updateTelemetryLabel()
+{
+    std::string error;
+    if (audio && audio->failed(&error)) {
+        // The device thread gave up on its own: report it the way a failed start() is
+        qWarning() << audio->name() << "audio output failed:" << QString::fromStdString(error);
+        telemetryLog.stop();
+        audio->stop();
+        audio.reset();
+        latencyLabel->setText("Audio: stopped - " + QString::fromStdString(error));
+    }
+    if (!audio) {
+        telemetryLabel->clear();
+        return;
     }
-    file.seek(dataOffset);
-    QByteArray pcmData = file.read(dataSize);
-    file.close();
-    
-    return pcmData;
+    const RenderTelemetry::Snapshot current = audio->telemetry().snapshot();
+    telemetryLabel->setText(QString("DSP %1% (peak %2%), %3 voices, %4 xruns, %5 late buffers")
+        .arg(qRound(100.0 * RenderTelemetry::Snapshot::load(lastTelemetry, current)))
+        .arg(qRound(100.0 * current.peakLoad))
+        .arg(current.activeVoices)
+        .arg(current.xruns)
+        .arg(current.deadlineMisses));
+    lastTelemetry = current;
 }
 
-void MainWindow::setupAudio()
+bool MainWindow::startTelemetryLog(const QString &path, int intervalMs)
 {
-    // Load all audio files and determine common format
-    QSet<QString> uniqueNotes;
-    for (auto it = pianoKeys.begin(); it != pianoKeys.end(); ++it) {
-        QString keyId = it.key();
-        QString note = keyId.split('_').first();
-        uniqueNotes.insert(note);
+    if (!audio) {
+        qWarning() << "No audio output - nothing to log to" << path;
+        return false;
     }
-    
-    // Preload all audio files into memory as PCM data
-    int commonChannels = 2;
-    bool firstFile = true;
-    
-    for (const QString &note : uniqueNotes) {
-        QString wavPath = getAudioFilePath(note);
-        QFileInfo fileInfo(wavPath);
-        
-        if (!fileInfo.exists()) {
-            qWarning() << "Audio file not found:" << wavPath;
-            continue;
-        }
-        
-        // Load WAV file and extract PCM data
-        int sampleRate, channels;
-        QByteArray pcmData = loadWavPcmData(wavPath, sampleRate, channels);
-        if (!pcmData.isEmpty()) {
-            audioBuffers[note] = pcmData;
-            audioSampleRates[note] = sampleRate;
-            audioChannels[note] = channels;
-            
-            // Use the first file's channel count
-            if (firstFile) {
-                commonChannels = channels;
-                firstFile = false;
-            }
-        }
+    std::string error;
+    if (!telemetryLog.start(path.toStdString(), intervalMs, audio->telemetry(), &error)) {
+        qWarning() << QString::fromStdString(error);
+        return false;
     }
-    
-    // We'll try to use a higher sample rate for lower latency
-    // The actual sample rate will be determined when setting up the audio unit
-    outputChannels = commonChannels;
-    
-    // Pre-allocate mix buffer for maximum callback size (typically 512 frames max)
-    // This avoids allocations in the audio callback which can cause lag
-    mixBuffer.resize(512 * outputChannels);
-    
-    qDebug() << "Preloaded" << audioBuffers.size() << "audio files into memory";
-    qDebug() << "Audio format: SampleRate:" << outputSampleRate << "Channels:" << outputChannels;
-    qDebug() << "All samples are pre-loaded and ready for direct playback";
-    
-    // Setup Core Audio with minimum latency
-    AudioComponentDescription desc;
-    desc.componentType = kAudioUnitType_Output;
-    desc.componentSubType = kAudioUnitSubType_DefaultOutput;
-    desc.componentManufacturer = kAudioUnitManufacturer_Apple;
-    desc.componentFlags = 0;
-    desc.componentFlagsMask = 0;
-    
-    AudioComponent component = AudioComponentFindNext(nullptr, &desc);
-    if (!component) {
-        qWarning() << "Failed to find audio component";
+    qDebug() << "Logging audio telemetry to" << path << "every" << intervalMs << "ms";
+    return true;
+}
+
+bool MainWindow::startMidi(const QString &input, const QString &port)
+{
+    std::string error;
+    std::unique_ptr<MidiInput> created = MidiInput::create(input.toStdString(), &error);
+    if (!created || !created->start(&engine, port.toStdString(), &error)) {
+        qWarning() << "No MIDI input:" << QString::fromStdString(error);
+        return false;
+    }
+    midi = std::move(created);
+    qDebug() << "MIDI input:" << QString::fromStdString(midi->description());
+    return true;
+}
+
+AudioSettings MainWindow::savedAudioSettings()
+{
+    QSettings settings("CplusplusPiano", "CplusplusPiano");
+    AudioSettings audioSettings;
+    audioSettings.backend = settings.value("audio/backend").toString().toStdString();
+    audioSettings.device = settings.value("audio/device").toString().toStdString();
+    audioSettings.sampleRate = settings.value("audio/sampleRate", audioSettings.sampleRate).toInt();
+    audioSettings.bufferFrames = settings.value("audio/bufferFrames", LatencyTuner::minBufferFrames).toInt();
+    audioSettings.periods = settings.value("audio/periods", audioSettings.periods).toInt();
+    
+    // Saved by a build with another set of backends: start over on the default one
+    const std::vector<std::string> backends = AudioBackend::availableBackends();
+    if (std::find(backends.begin(), backends.end(), audioSettings.backend) == backends.end()) {
+        audioSettings = AudioSettings();
+        audioSettings.bufferFrames = LatencyTuner::minBufferFrames;
+    }
+    return audioSettings;
+}
+
+void MainWindow::saveAudioSettings() const
+{
+    // The requested settings rather than what the device made of them, so the same device
+    // is asked the same way next time; the buffer size is the tuner's current choice. Headless
+    // runs (null and file backends) leave the saved settings alone.
+    const std::string backend = audio->name();
+    if (backend == "null" || backend == "file") {
         return;
     }
-    
-    OSStatus err = AudioComponentInstanceNew(component, &audioUnit);
-    if (err != noErr) {
-        qWarning() << "Failed to create audio unit:" << err;
+    QSettings settings("CplusplusPiano", "CplusplusPiano");
+    settings.setValue("audio/backend", QString::fromStdString(backend));
+    settings.setValue("audio/device", QString::fromStdString(requestedAudio.device));
+    settings.setValue("audio/sampleRate", requestedAudio.sampleRate);
+    settings.setValue("audio/bufferFrames", requestedAudio.bufferFrames);
+    settings.setValue("audio/periods", requestedAudio.periods);
+}
+
+void MainWindow::loadSamples()
+{
+    // Samples are converted to the output format as they load, so every voice takes the
+    // direct-mix path. Converted samples are cached on disk (keyed by file contents and
+    // format), so later launches skip the conversion.
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/samples";
+    if (!QDir().mkpath(cacheDir)) {
+        qWarning() << "Sample cache unavailable:" << cacheDir;
+        cacheDir.clear();
+    }
+    engine.setSampleNormalization(true, cacheDir.toStdString());
+    
+    // Prefer the packed sample bank (one open, one mmap - build it with tools/pianobank)
+    sampleDirectory = findSampleDirectory();
+    QString bankPath = sampleDirectory + "/Piano.pnb";
+    std::string bankError;
+    if (QFileInfo::exists(bankPath) && engine.loadSampleBank(bankPath.toStdString(), &bankError)) {
+        qDebug() << "Loaded sample bank" << bankPath << "with" << engine.sampleCount() << "samples,"
+                 << startupTimer.elapsed() << "ms after startup";
         return;
     }
-    
-    // Set up audio format - use 44.1kHz
-    outputSampleRate = 44100;
-    AudioStreamBasicDescription audioFormat;
-    audioFormat.mSampleRate = outputSampleRate;
-    audioFormat.mFormatID = kAudioFormatLinearPCM;
-    audioFormat.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
-    audioFormat.mBitsPerChannel = 16;
-    audioFormat.mChannelsPerFrame = outputChannels;
-    audioFormat.mBytesPerFrame = audioFormat.mChannelsPerFrame * sizeof(SInt16);
-    audioFormat.mFramesPerPacket = 1;
-    audioFormat.mBytesPerPacket = audioFormat.mBytesPerFrame * audioFormat.mFramesPerPacket;
-    audioFormat.mReserved = 0;
-    
-    // Set format on output scope
-    err = AudioUnitSetProperty(audioUnit,
-                               kAudioUnitProperty_StreamFormat,
-                               kAudioUnitScope_Input,
-                               0,
-                               &audioFormat,
-                               sizeof(audioFormat));
-    if (err != noErr) {
-        qWarning() << "Failed to set audio format:" << err;
-        AudioComponentInstanceDispose(audioUnit);
-        audioUnit = nullptr;
-        return;
+    if (!bankError.empty()) {
+        qWarning() << QString::fromStdString(bankError);
     }
     
-    // Set render callback
-    AURenderCallbackStruct callbackStruct;
-    callbackStruct.inputProc = audioRenderCallback;
-    callbackStruct.inputProcRefCon = this;
-    
-    err = AudioUnitSetProperty(audioUnit,
-                               kAudioUnitProperty_SetRenderCallback,
-                               kAudioUnitScope_Input,
-                               0,
-                               &callbackStruct,
-                               sizeof(callbackStruct));
-    if (err != noErr) {
-        qWarning() << "Failed to set render callback:" << err;
-        AudioComponentInstanceDispose(audioUnit);
-        audioUnit = nullptr;
+    // Fall back to the WAV files: every velocity layer and round-robin alternate in the
+    // directory (found from the file names alone), decoded on a thread pool while the window
+    // and audio are already running. Each sample is playable as soon as it arrives; keys
+    // pressed before any layer of their note is in are ignored.
+    SampleSet sampleSet;
+    std::string scanError;
+    if (!sampleSet.scanDirectory(sampleDirectory.toStdString(), "Piano", &scanError)) {
+        qWarning() << QString::fromStdString(scanError);
         return;
     }
-    
-    // Initialize audio unit
-    err = AudioUnitInitialize(audioUnit);
-    if (err != noErr) {
-        qWarning() << "Failed to initialize audio unit:" << err;
-        AudioComponentInstanceDispose(audioUnit);
-        audioUnit = nullptr;
+    if (sampleSet.empty()) {
+        qWarning() << "No samples found in" << sampleDirectory;
         return;
     }
-    
-    // Start audio unit
-    err = AudioOutputUnitStart(audioUnit);
-    if (err != noErr) {
-        qWarning() << "Failed to start audio unit:" << err;
-        AudioUnitUninitialize(audioUnit);
-        AudioComponentInstanceDispose(audioUnit);
-        audioUnit = nullptr;
-        return;
+    engine.setSampleSet(sampleSet);
+    samplesPending = engine.loadSampleSetAsync([this](int note, bool ok, const std::string &error) {
+        // Called on a loader thread - report on the GUI thread
+        QString message = QString::fromStdString(error);
+        QMetaObject::invokeMethod(this, [this, note, ok, message]() {
+            sampleLoaded(note, ok, message);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::sampleLoaded(int note, bool ok, const QString &error)
+{
+    if (!ok) {
+        qWarning() << error;
+    } else if (!firstSampleLogged) {
+        firstSampleLogged = true;
+        qDebug() << "First note playable" << startupTimer.elapsed() << "ms after startup (note"
+                 << QString::fromStdString(noteNameFromNumber(note)) << ")";
     }
     
-    // Get actual latency information
-    Float64 latencySeconds = 0;
-    UInt32 latencySize = sizeof(latencySeconds);
-    AudioUnitGetProperty(audioUnit,
-                        kAudioUnitProperty_Latency,
-                        kAudioUnitScope_Global,
-                        0,
-                        &latencySeconds,
-                        &latencySize);
-    
-    qDebug() << "Core Audio started with minimum latency";
-    qDebug() << "  Sample rate:" << outputSampleRate << "Hz";
-    qDebug() << "  Channels:" << outputChannels;
-    if (latencySeconds > 0) {
-        qDebug() << "  AudioUnit latency:" << (latencySeconds * 1000.0) << "ms";
+    if (--samplesPending == 0) {
+        audioClock.restart();  // The latency tuner starts counting glitches now
+        const SampleCache &cache = engine.normalizationCache();
+        qDebug() << "Full bank loaded" << startupTimer.elapsed() << "ms after startup:"
+                 << engine.sampleCount() << "samples," << cache.misses() << "converted,"
+                 << cache.hits() << "from cache";
     }
-    qDebug() << "  Direct sample playback - no effects or processing";
-    qDebug() << "  All samples pre-loaded in memory for instant playback";
 }
 
-QString MainWindow::getAudioFilePath(const QString &note)
+QString MainWindow::findSampleDirectory() const
 {
-    // Convert note name to match audio file naming convention
-    // Files use: Piano.ff.C4.wav, Piano.ff.Db4.wav, etc.
-    // Our notes use: C4, C#4, D4, D#4, etc.
-    
-    QString noteName = note.left(note.length() - 1);  // Get note without octave
-    QString octave = note.right(1);  // Get octave number
-    
-    // Map sharp notes to flat equivalents (file naming uses flats)
-    QMap<QString, QString> noteMap;
-    noteMap["C"] = "C";
-    noteMap["C#"] = "Db";  // C# = Db
-    noteMap["D"] = "D";
-    noteMap["D#"] = "Eb";  // D# = Eb
-    noteMap["E"] = "E";
-    noteMap["F"] = "F";
-    noteMap["F#"] = "Gb";  // F# = Gb
-    noteMap["G"] = "G";
-    noteMap["G#"] = "Ab";  // G# = Ab
-    noteMap["A"] = "A";
-    noteMap["A#"] = "Bb";  // A# = Bb
-    noteMap["B"] = "B";
-    
-    QString mappedNote = noteMap.value(noteName, noteName);
-    QString fileName = QString("Piano.ff.%1%2.wav").arg(mappedNote).arg(octave);
-    
-    // Try multiple paths to find the audio file
-    QStringList possiblePaths;
+    // Try multiple locations for the NotesFF directory
+    QStringList possibleDirs;
     
     // 1. Relative to executable (for deployed app)
     QString appDir = QCoreApplication::applicationDirPath();
-    possiblePaths << appDir + "/../src/NotesFF/" + fileName;
-    possiblePaths << appDir + "/NotesFF/" + fileName;
+    possibleDirs << appDir + "/../src/NotesFF";
+    possibleDirs << appDir + "/NotesFF";
     
     // 2. Relative to current working directory (for development)
-    possiblePaths << "src/NotesFF/" + fileName;
-    possiblePaths << QDir::currentPath() + "/src/NotesFF/" + fileName;
+    possibleDirs << QDir::currentPath() + "/src/NotesFF";
     
     // 3. Absolute path from project root
-    possiblePaths << QDir::currentPath() + "/../src/NotesFF/" + fileName;
+    possibleDirs << QDir::currentPath() + "/../src/NotesFF";
     
-    // Find the first existing file
-    for (const QString &path : possiblePaths) {
-        QFileInfo fileInfo(path);
-        if (fileInfo.exists()) {
-            return QDir::cleanPath(fileInfo.absoluteFilePath());
+    // Use the first existing directory
+    for (const QString &dir : possibleDirs) {
+        QFileInfo dirInfo(dir);
+        if (dirInfo.isDir()) {
+            return QDir::cleanPath(dirInfo.absoluteFilePath());
         }
     }
     
-    // Return the most likely path (for error reporting)
-    return possiblePaths.first();
-}
-
-OSStatus MainWindow::audioRenderCallback(void *inRefCon,
-                                         AudioUnitRenderActionFlags *ioActionFlags,
-                                         const AudioTimeStamp *inTimeStamp,
-                                         UInt32 inBusNumber,
-                                         UInt32 inNumberFrames,
-                                         AudioBufferList *ioData)
-{
-    Q_UNUSED(ioActionFlags);
-    Q_UNUSED(inTimeStamp);
-    Q_UNUSED(inBusNumber);
-    
-    MainWindow *mainWindow = static_cast<MainWindow*>(inRefCon);
-    
-    // Get output buffer
-    AudioBuffer *buffer = &ioData->mBuffers[0];
-    SInt16 *out = static_cast<SInt16*>(buffer->mData);
-    UInt32 framesPerBuffer = inNumberFrames;
-    int samplesPerFrame = mainWindow->outputChannels;
-    UInt32 totalSamples = framesPerBuffer * samplesPerFrame;
-    
-    // Ensure mix buffer is large enough (pre-allocated to avoid allocations)
-    if (mainWindow->mixBuffer.size() < static_cast<int>(totalSamples)) {
-        mainWindow->mixBuffer.resize(totalSamples);
-    }
-    
-    // Clear mix buffer (use 32-bit for accumulation to avoid clipping)
-    qint32 *mix = mainWindow->mixBuffer.data();
-    for (UInt32 i = 0; i < totalSamples; ++i) {
-        mix[i] = 0;
-    }
-    
-    // First, quickly add any pending notes to active notes (very fast operation)
-    {
-        QMutexLocker pendingLock(&mainWindow->pendingNotesMutex);
-        if (!mainWindow->pendingNotes.isEmpty()) {
-            QMutexLocker activeLock(&mainWindow->activeNotesMutex);
-            mainWindow->activeNotes.append(mainWindow->pendingNotes);
-            mainWindow->pendingNotes.clear();
-        }
-    }
-    
-    // Lock and mix all active notes (minimize lock time by working directly)
-    // We need to lock because we're modifying positions
-    QMutexLocker locker(&mainWindow->activeNotesMutex);
-    
-    // Check damper pedal state
-    bool damperActive = false;
-    {
-        QMutexLocker damperLock(&mainWindow->damperPedalMutex);
-        damperActive = mainWindow->damperPedalActive;
-    }
-    
-    // Mix all active notes
-    for (int i = mainWindow->activeNotes.size() - 1; i >= 0; --i) {
-        ActiveNote &activeNote = mainWindow->activeNotes[i];
-        
-        // Check if note has reached the end of its sample data
-        if (activeNote.position >= activeNote.length) {
-            // If damper pedal is active, sustain it immediately
-            if (damperActive && !activeNote.isSustained) {
-                activeNote.isSustained = true;
-                activeNote.sustainVolume = 1.0;  // Start at full volume
-            }
-            
-            // If note is sustained, apply fade-out
-            if (activeNote.isSustained) {
-                // Calculate fade rate based on damper state
-                double fadeRate;
-                if (damperActive) {
-                    // While damper is held, very slow fade (over ~5 seconds)
-                    fadeRate = 1.0 / (mainWindow->outputSampleRate * 5.0);
-                } else {
-                    // Damper released - faster fade (over ~0.5 seconds for quick release)
-                    fadeRate = 1.0 / (mainWindow->outputSampleRate * 0.5);
-                }
-                
-                // For sustained notes, use the last sample of the audio
-                // Apply 1.1x volume multiplier to make sustain more noticeable
-                double sustainVolumeMultiplier = 1.1;
-                // Use the last sample of the audio for sustain
-                int lastSampleIndex = activeNote.length - activeNote.channels;
-                if (lastSampleIndex < 0) lastSampleIndex = 0;
-                
-                // Render sustained note with per-frame volume decay
-                for (UInt32 frame = 0; frame < framesPerBuffer; ++frame) {
-                    // Calculate current volume for this frame (linear decay)
-                    double currentVolume = activeNote.sustainVolume;
-                    double frameVolume = currentVolume * sustainVolumeMultiplier;
-                    
-                    for (int ch = 0; ch < activeNote.channels && ch < samplesPerFrame; ++ch) {
-                        if (lastSampleIndex + ch < activeNote.length) {
-                            qint16 lastSample = activeNote.data[lastSampleIndex + ch];
-                            UInt32 outIndex = frame * samplesPerFrame + ch;
-                            if (outIndex < totalSamples) {
-                                mix[outIndex] += static_cast<qint32>(lastSample * frameVolume);
-                            }
-                        }
-                    }
-                    
-                    // Update volume for next frame (decay per frame)
-                    activeNote.sustainVolume = qMax(0.0, activeNote.sustainVolume - fadeRate);
-                }
-                
-                // Remove note when volume reaches zero
-                if (activeNote.sustainVolume <= 0.0) {
-                    mainWindow->activeNotes.removeAt(i);
-                    continue;
-                }
-                continue;
-            } else {
-                // Note finished and not sustained - remove it
-                mainWindow->activeNotes.removeAt(i);
-                continue;
-            }
-        }
-        
-        // If damper pedal is active, mark note to be sustained (but continue playing normally)
-        // The note will sustain when it reaches the end of its sample data
-        if (damperActive && !activeNote.isSustained) {
-            // Mark as "will be sustained" - note continues playing normally
-            // When it reaches the end, it will start sustaining
-            activeNote.isSustained = true;
-            activeNote.sustainVolume = 1.0;
-        }
-        
-        // Note: If isSustained is true but position < length, the note is still playing
-        // and will continue to play normally. It will only start sustaining when
-        // position >= length (handled in the check above)
-        
-        // Check if note has reached 1 second cutoff (only if damper is NOT active and not sustained)
-        if (activeNote.framesPlayed >= mainWindow->outputSampleRate && !damperActive && !activeNote.isSustained) {
-            // Note has played for 1 second and damper is not active - cut it off
-            mainWindow->activeNotes.removeAt(i);
-            continue;
-        }
-        
-        // Calculate how many frames we can still play before hitting 1 second limit
-        int framesRemaining = mainWindow->outputSampleRate - activeNote.framesPlayed;
-        UInt32 framesToPlay = framesPerBuffer;
-        if (!damperActive && framesRemaining > 0 && framesRemaining < static_cast<int>(framesPerBuffer)) {
-            // Limit to remaining frames before 1 second cutoff
-            framesToPlay = static_cast<UInt32>(framesRemaining);
-        }
-        
-        // Calculate how many samples we need from this note
-        int noteSamplesPerFrame = activeNote.channels;
-        UInt32 noteSamplesNeeded = framesToPlay * noteSamplesPerFrame;
-        int noteSamplesAvailable = activeNote.length - activeNote.position;
-        UInt32 samplesToMix = qMin(static_cast<UInt32>(noteSamplesAvailable), noteSamplesNeeded);
-        
-        // Fast path: same sample rate and channels - direct mixing (no processing, no effects)
-        if (activeNote.sampleRate == mainWindow->outputSampleRate && 
-            activeNote.channels == mainWindow->outputChannels) {
-            // Direct sample playback - just mix samples directly, no processing
-            const qint16 *noteData = activeNote.data + activeNote.position;
-            // Unroll loop for better performance (process 4 samples at a time when possible)
-            UInt32 j = 0;
-            for (; j + 3 < samplesToMix && j + 3 < totalSamples; j += 4) {
-                mix[j] += static_cast<qint32>(noteData[j]);
-                mix[j+1] += static_cast<qint32>(noteData[j+1]);
-                mix[j+2] += static_cast<qint32>(noteData[j+2]);
-                mix[j+3] += static_cast<qint32>(noteData[j+3]);
-            }
-            // Handle remaining samples
-            for (; j < samplesToMix && j < totalSamples; ++j) {
-                mix[j] += static_cast<qint32>(noteData[j]);
-            }
-            activeNote.position += static_cast<int>(samplesToMix);
-        } else {
-            // Sample rate conversion needed (simplified)
-            double ratio = static_cast<double>(activeNote.sampleRate) / mainWindow->outputSampleRate;
-            for (UInt32 frame = 0; frame < framesToPlay; ++frame) {
-                double noteFrame = activeNote.position / static_cast<double>(noteSamplesPerFrame) + frame * ratio;
-                int noteSampleIndex = static_cast<int>(noteFrame * noteSamplesPerFrame);
-                
-                if (noteSampleIndex < activeNote.length) {
-                    for (int ch = 0; ch < samplesPerFrame && ch < noteSamplesPerFrame; ++ch) {
-                        UInt32 outIndex = frame * samplesPerFrame + ch;
-                        int noteIndex = noteSampleIndex + ch;
-                        if (outIndex < totalSamples && noteIndex < activeNote.length) {
-                            mix[outIndex] += static_cast<qint32>(activeNote.data[noteIndex]);
-                        }
-                    }
-                }
-            }
-            activeNote.position += static_cast<int>(framesToPlay * ratio * noteSamplesPerFrame);
-        }
-        
-        // Update frames played counter
-        activeNote.framesPlayed += framesToPlay;
-        
-        // Check again if we've hit 1 second after updating (only if damper is NOT active)
-        if (activeNote.framesPlayed >= mainWindow->outputSampleRate && !damperActive && !activeNote.isSustained) {
-            // Cut it off (damper is not active, so no sustain)
-            mainWindow->activeNotes.removeAt(i);
-            continue;
-        }
-    }
-    
-    // Check if una corda (soft pedal) is active
-    bool unaCorda = false;
-    {
-        QMutexLocker lock(&mainWindow->unaCordaMutex);
-        unaCorda = mainWindow->unaCordaActive;
-    }
-    
-    // Apply una corda effect: volume reduction (15%) and low-pass filter for muffled tone
-    if (unaCorda) {
-        // Low-pass filter parameters (cutoff ~2500 Hz for muffled sound)
-        // alpha = dt / (dt + RC), where RC = 1 / (2 * pi * cutoff)
-        // For 44.1kHz sample rate and 2500 Hz cutoff:
-        double cutoffFreq = 2500.0;
-        double dt = 1.0 / mainWindow->outputSampleRate;
-        double rc = 1.0 / (2.0 * M_PI * cutoffFreq);
-        double alpha = dt / (dt + rc);
-        
-        // Apply low-pass filter and volume reduction (0.79 = 21% reduction)
-        double volumeMultiplier = 0.79;
-        
-        for (UInt32 i = 0; i < totalSamples; ++i) {
-            int channel = i % samplesPerFrame;
-            double filtered = alpha * mix[i] + (1.0 - alpha) * mainWindow->lowPassFilterState[channel];
-            mainWindow->lowPassFilterState[channel] = filtered;
-            qint32 finalValue = static_cast<qint32>(filtered * volumeMultiplier);
-            out[i] = static_cast<SInt16>(qBound(-32768, finalValue, 32767));
-        }
-    } else {
-        // Reset filter state when una corda is not active
-        for (int ch = 0; ch < samplesPerFrame; ++ch) {
-            mainWindow->lowPassFilterState[ch] = 0.0;
-        }
-        
-        // Convert mix buffer to output with clipping protection (normal volume)
-        for (UInt32 i = 0; i < totalSamples; ++i) {
-            out[i] = static_cast<SInt16>(qBound(-32768, mix[i], 32767));
-        }
-    }
-    
-    return noErr;
+    // Return the most likely directory (for error reporting)
+    return possibleDirs.first();
 }
 
 void MainWindow::playNote(const QString &note)
 {
-    // Fast path - check if note exists (no lock needed for read)
-    auto it = audioBuffers.find(note);
-    if (it == audioBuffers.end() || it->isEmpty()) {
+    // Fast path - check if note has a sample loaded
+    int noteId = noteNumber(note);
+    if (!engine.hasSample(noteId)) {
         return;  // Silently fail for speed
     }
     
-    // Use const reference to avoid copy
-    const QByteArray &audioData = *it;
-    
-    // Get audio format for this note (cached lookups, fast)
-    int sampleRate = audioSampleRates.value(note, outputSampleRate);
-    int channels = audioChannels.value(note, outputChannels);
-    
-    // Convert QByteArray to const qint16* pointer (no copy, just pointer)
-    const qint16 *pcmData = reinterpret_cast<const qint16*>(audioData.constData());
-    int sampleCount = audioData.size() / sizeof(qint16);
-    
-    // Create active note on stack (fast, no allocation)
-    ActiveNote activeNote;
-    activeNote.data = pcmData;
-    activeNote.position = 0;
-    activeNote.length = sampleCount;
-    activeNote.sampleRate = sampleRate;
-    activeNote.channels = channels;
-    activeNote.isSustained = false;
-    activeNote.sustainVolume = 1.0;
-    activeNote.framesPlayed = 0;  // Initialize frames played counter
-    
-    // Add to pending notes queue (very fast, rarely blocks)
-    // The audio callback will move these to active notes
-    // This prevents blocking when many keys are pressed quickly
-    QMutexLocker locker(&pendingNotesMutex);
-    pendingNotes.append(activeNote);
+    // Hand the note to the audio thread through the engine's lock-free queue (never blocks)
+    // Stamped now; the next audio callback starts the note on the frame that time falls on,
+    // one buffer period later, so notes keep the spacing they were played with
+    if (!engine.noteOn(noteId)) {
+        qWarning() << "Note event queue full, dropping note:" << note;
+        return;
+    }
     
     // Highlight the key visually
     highlightKey(note);
 }
 
+int MainWindow::noteNumber(const QString &note)
+{
+    // Convert note name ("C4", "C#4") to MIDI note number (middle C = C4 = 60)
+    return noteNumberFromName(note.toStdString());
+}
+
 void MainWindow::connectKeySignals()
 {
     // Connect all piano keys to playNote slot
@@ -1056,15 +812,13 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
     int key = event->key();
     if (key == Qt::Key_N) {
         // Una corda (soft pedal)
-        QMutexLocker lock(&unaCordaMutex);
-        unaCordaActive = true;
+        engine.setUnaCorda(1.0f);
         unaCordaIndicator->setChecked(true);
         event->accept();
         return;
     } else if (key == Qt::Key_M) {
         // Damper pedal (sustain)
-        QMutexLocker lock(&damperPedalMutex);
-        damperPedalActive = true;
+        engine.setDamperPedal(1.0f);
         damperPedalIndicator->setChecked(true);
         event->accept();
         return;
@@ -1140,15 +894,13 @@ void MainWindow::keyReleaseEvent(QKeyEvent *event)
     int key = event->key();
     if (key == Qt::Key_N) {
         // Una corda (soft pedal) released
-        QMutexLocker lock(&unaCordaMutex);
-        unaCordaActive = false;
+        engine.setUnaCorda(0.0f);
         unaCordaIndicator->setChecked(false);
         event->accept();
         return;
     } else if (key == Qt::Key_M) {
         // Damper pedal (sustain) released
-        QMutexLocker lock(&damperPedalMutex);
-        damperPedalActive = false;
+        engine.setDamperPedal(0.0f);
         damperPedalIndicator->setChecked(false);
         event->accept();
         return;
@@ -9,19 +9,38 @@
 #include <QHBoxLayout>
 #include <QByteArray>
 #include <QFile>
-#include <QMutex>
 #include <QVector>
 #include <QKeyEvent>
 #include <QCheckBox>
+#include <QElapsedTimer>
 #include <QHBoxLayout>
-#include <AudioToolbox/AudioToolbox.h>
-#include <CoreAudio/CoreAudio.h>
+#include <QLabel>
+#include <QTimer>
+#include <memory>
+#include "audiobackend.h"
+#include "latencytuner.h"
+#include "midiinput.h"
+#include "pianoengine.h"
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    // Opens the audio backend the settings name (the platform default if none). With
+    // tuneLatency the buffer size starts at audioSettings.bufferFrames and is stepped up by the
+    // latency tuner whenever the device glitches; the size it settles on is saved.
+    explicit MainWindow(const AudioSettings &audioSettings = AudioSettings(), bool tuneLatency = false,
+                        QWidget *parent = nullptr);
+
+    // Appends the audio thread's telemetry to a file every intervalMs (see rendertelemetry.h)
+    bool startTelemetryLog(const QString &path, int intervalMs);
+
+    // Plays what comes in on a MIDI input (see midiinput.h; port as the input takes it). Its
+    // events go from the input's thread straight to the engine, not through this window.
+    bool startMidi(const QString &input, const QString &port);
+
+    // Audio settings remembered from the last run (buffer size: the last one the tuner chose)
+    static AudioSettings savedAudioSettings();
     ~MainWindow();
 
 protected:
@@ -34,16 +53,17 @@ private slots:
 private:
     void setupUI();
     void setupAudio();
+    bool startAudio();
+    void checkLatency();
+    void saveAudioSettings() const;
+    void updateLatencyLabel();
+    void updateTelemetryLabel();
+    void loadSamples();
+    void sampleLoaded(int note, bool ok, const QString &error);
     void connectKeySignals();
     void highlightKey(const QString &note);
-    QString getAudioFilePath(const QString &note);
-    QByteArray loadWavPcmData(const QString &filePath, int &sampleRate, int &channels);
-    static OSStatus audioRenderCallback(void *inRefCon,
-                                       AudioUnitRenderActionFlags *ioActionFlags,
-                                       const AudioTimeStamp *inTimeStamp,
-                                       UInt32 inBusNumber,
-                                       UInt32 inNumberFrames,
-                                       AudioBufferList *ioData);
+    QString findSampleDirectory() const;
+    static int noteNumber(const QString &note);
     
     QWidget *centralWidget;
     QWidget *pianoKeysContainer;  // Container for overlapping white and black keys
@@ -53,52 +73,33 @@ private:
     // Pedal indicators
     QCheckBox *unaCordaIndicator;
     QCheckBox *damperPedalIndicator;
+    QLabel *latencyLabel;
+    QLabel *telemetryLabel;  // DSP load, voices and xruns, refreshed twice a second
     
     QMap<QString, QPushButton*> pianoKeys;
     QMap<QString, QString> keyOriginalStyles;  // Store original styles for fade-back
     QMap<QString, QTimer*> keyFadeTimers;  // Timers for fade-back animation
     QMap<QString, int> keyFadeSteps;  // Track fade animation steps
-    QMap<QString, QByteArray> audioBuffers;  // Pre-loaded PCM audio data
-    QMap<QString, int> audioSampleRates;  // Sample rate for each note
-    QMap<QString, int> audioChannels;  // Channel count for each note
-    
-    // Core Audio
-    AudioComponentInstance audioUnit;
-    int outputSampleRate;
-    int outputChannels;
-    
-    // Active notes (for mixing)
-    struct ActiveNote {
-        const qint16 *data;
-        int position;
-        int length;
-        int sampleRate;
-        int channels;
-        bool isSustained;  // True if note is being sustained by damper pedal
-        double sustainVolume;  // Current volume multiplier for sustained notes (for fade-out)
-        int framesPlayed;  // Number of frames played so far (for 1-second cutoff)
-    };
-    QVector<ActiveNote> activeNotes;
-    QMutex activeNotesMutex;
     
-    // Pending notes queue (for rapid key presses)
-    // New notes are added here first, then moved to activeNotes in the audio callback
-    QVector<ActiveNote> pendingNotes;
-    QMutex pendingNotesMutex;
+    // Sound engine (samples, voices, pedals) - the audio backend's device thread just pulls from it
+    PianoEngine engine;
+    QString sampleDirectory;  // Resolved once at startup
+    QElapsedTimer startupTimer;  // Started in the constructor, for load-time logging
+    int samplesPending;  // Sample files still being loaded in the background
+    bool firstSampleLogged;
     
-    // Pre-allocated buffer for mixing to avoid allocations in callback
-    QVector<qint32> mixBuffer;
-    
-    // Una corda (soft pedal) state
-    bool unaCordaActive;
-    QMutex unaCordaMutex;
-    
-    // Damper pedal (sustain) state
-    bool damperPedalActive;
-    QMutex damperPedalMutex;
-    
-    // Low-pass filter state for muffled tone (per channel)
-    QVector<double> lowPassFilterState;
+    // Audio output: requested settings, and the backend (settings() has what the device agreed to)
+    AudioSettings requestedAudio;
+    std::unique_ptr<AudioBackend> audio;
+    bool tuneLatency;
+    LatencyTuner latencyTuner;
+    QTimer *latencyTimer;  // Polls the tuner
+    QElapsedTimer audioClock;  // Since the device started, or since loading finished
+    QTimer *telemetryTimer;
+    RenderTelemetry::Snapshot lastTelemetry;  // As of the last label refresh
+    TelemetryLog telemetryLog;
+
+    std::unique_ptr<MidiInput> midi;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
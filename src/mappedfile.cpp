@@ -0,0 +1,103 @@
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+    : mapping(nullptr), mappedSize(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &path, std::string *errorMessage)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errorMessage) {
+            *errorMessage = "Failed to open file: " + path;
+        }
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        if (errorMessage) {
+            *errorMessage = "Empty or unreadable file: " + path;
+        }
+        return false;
+    }
+
+    void *address = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps its own reference to the file
+    if (address == MAP_FAILED) {
+        if (errorMessage) {
+            *errorMessage = "Failed to map file: " + path;
+        }
+        return false;
+    }
+
+    mapping = address;
+    mappedSize = static_cast<std::size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapping) {
+        munmap(mapping, mappedSize);
+        mapping = nullptr;
+        mappedSize = 0;
+    }
+}
+
+void MappedFile::willNeed(std::size_t offset, std::size_t length) const
+{
+    if (!mapping || offset >= mappedSize) {
+        return;
+    }
+    // madvise needs a page-aligned start
+    const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t start = offset / pageSize * pageSize;
+    const std::size_t end = std::min(mappedSize, offset + length);
+    madvise(static_cast<char *>(mapping) + start, end - start, MADV_WILLNEED);
+}
+
+void MappedFile::prefault(std::size_t offset, std::size_t length) const
+{
+    if (!mapping || offset >= mappedSize) {
+        return;
+    }
+    const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t end = std::min(mappedSize, offset + length);
+    const volatile unsigned char *bytes = data();
+    unsigned char sink = 0;
+    for (std::size_t i = offset / pageSize * pageSize; i < end; i += pageSize) {
+        sink ^= bytes[i];
+    }
+    (void)sink;
+}
+
+void MappedFile::dontNeed(std::size_t offset, std::size_t length) const
+{
+    if (!mapping || offset >= mappedSize) {
+        return;
+    }
+    // Only pages entirely inside the range: a neighbour sharing a page keeps it
+    const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t start = (offset + pageSize - 1) / pageSize * pageSize;
+    const std::size_t end = std::min(mappedSize, offset + length) / pageSize * pageSize;
+    if (start < end) {
+        madvise(static_cast<char *>(mapping) + start, end - start, MADV_DONTNEED);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (POSIX mmap).
+//
+// Pages are faulted in lazily on first access; willNeed() asks the kernel to start
+// reading a range ahead of time and prefault() touches it from the calling thread so
+// later accesses (e.g. from the audio thread) don't block on disk.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path, std::string *errorMessage = nullptr);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const unsigned char *data() const { return static_cast<const unsigned char *>(mapping); }
+    std::size_t size() const { return mappedSize; }
+
+    // Hint that [offset, offset + length) will be read soon (madvise WILLNEED)
+    void willNeed(std::size_t offset, std::size_t length) const;
+    // Read one byte per page of [offset, offset + length) so the range is resident
+    void prefault(std::size_t offset, std::size_t length) const;
+    // Let the kernel drop the whole pages inside the range (madvise DONTNEED); they are read
+    // from the file again on the next access
+    void dontNeed(std::size_t offset, std::size_t length) const;
+
+private:
+    void *mapping;
+    std::size_t mappedSize;
+};
+
+#endif // MAPPEDFILE_H
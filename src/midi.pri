@@ -0,0 +1,22 @@
+# MIDI input - note and pedal events from MIDI devices straight into PianoEngine
+# (see midiinput.h). The virtual input is always built; ALSA where the platform has it.
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/midiinput.cpp \
+    $$PWD/virtualmidiinput.cpp
+
+HEADERS += \
+    $$PWD/midiinput.h \
+    $$PWD/virtualmidiinput.h
+
+# ALSA sequencer (Linux), only if pkg-config finds its development files
+unix:!macx {
+    CONFIG += link_pkgconfig
+    packagesExist(alsa) {
+        DEFINES *= PIANO_HAVE_ALSA
+        PKGCONFIG *= alsa
+        SOURCES += $$PWD/alsamidiinput.cpp
+        HEADERS += $$PWD/alsamidiinput.h
+    }
+}
@@ -0,0 +1,136 @@
+#include "midiinput.h"
+#include "pianoengine.h"
+#include "virtualmidiinput.h"
+
+#ifdef PIANO_HAVE_ALSA
+#include "alsamidiinput.h"
+#endif
+
+// Controller numbers
+static const int sustainPedal = 64;
+static const int softPedal = 67;
+static const int allSoundOff = 120;
+static const int allNotesOff = 123;
+
+MidiInput::MidiInput()
+    : engine(nullptr), runningStatus(0), dataCount(0), inSysex(false), events(0), dropped(0)
+{
+    data[0] = data[1] = 0;
+}
+
+void MidiInput::resetParser()
+{
+    runningStatus = 0;
+    dataCount = 0;
+    inSysex = false;
+}
+
+void MidiInput::receive(const std::uint8_t *bytes, int count, std::uint64_t timestamp)
+{
+    for (int i = 0; i < count; ++i) {
+        const std::uint8_t byte = bytes[i];
+        if (byte >= 0xf8) {
+            continue;  // Real-time (clock, active sensing ...): may come anywhere, changes nothing
+        }
+        if (byte & 0x80) {
+            // A status byte: a channel message starts running status, system messages cancel it
+            inSysex = byte == 0xf0;
+            runningStatus = byte < 0xf0 ? byte : 0;
+            dataCount = 0;
+            continue;
+        }
+        if (inSysex || runningStatus == 0) {
+            continue;  // System exclusive or common data, or data without a status
+        }
+        data[dataCount++] = byte;
+        // Program change and channel pressure carry one data byte, the rest two
+        const int type = runningStatus & 0xf0;
+        const int needed = (type == 0xc0 || type == 0xd0) ? 1 : 2;
+        if (dataCount == needed) {
+            deliver(runningStatus, data[0], needed == 2 ? data[1] : 0, timestamp);
+            dataCount = 0;
+        }
+    }
+}
+
+void MidiInput::deliver(std::uint8_t status, std::uint8_t data1, std::uint8_t data2, std::uint64_t timestamp)
+{
+    const PianoEngine::EventSource source = PianoEngine::EventSource::Midi;
+    const int type = status & 0xf0;
+    const int note = data1 & 0x7f;
+    bool queued = true;
+    if (type == 0x90 && data2 > 0) {
+        queued = engine->noteOn(note, data2 / 127.0f, timestamp, source);
+        held.set(note);
+    } else if (type == 0x80 || type == 0x90) {
+        queued = engine->noteOff(note, timestamp, source);
+        held.reset(note);
+    } else if (type == 0xb0) {
+        switch (data1) {
+        case sustainPedal:
+            queued = engine->setDamperPedal(data2 / 127.0f, timestamp, source);
+            break;
+        case softPedal:
+            queued = engine->setUnaCorda(data2 / 127.0f, timestamp, source);
+            break;
+        case allSoundOff:
+            // Silence now, whatever the pedal holds: the engine cuts every voice
+            queued = engine->allSoundOff(timestamp, source);
+            held.reset();
+            break;
+        case allNotesOff:
+            releaseHeldNotes(timestamp);
+            break;
+        default:
+            return;  // Not something a piano has
+        }
+    } else {
+        return;
+    }
+    events.fetch_add(1, std::memory_order_relaxed);
+    if (!queued) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MidiInput::releaseHeldNotes(std::uint64_t timestamp)
+{
+    for (int note = 0; note < 128; ++note) {
+        if (held.test(note) && !engine->noteOff(note, timestamp, PianoEngine::EventSource::Midi)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    held.reset();
+}
+
+std::vector<std::string> MidiInput::availableInputs()
+{
+    std::vector<std::string> names;
+#ifdef PIANO_HAVE_ALSA
+    names.push_back("alsa");
+#endif
+    names.push_back("virtual");
+    return names;
+}
+
+std::unique_ptr<MidiInput> MidiInput::create(const std::string &name, std::string *errorMessage)
+{
+    const std::string input = name.empty() ? availableInputs().front() : name;
+#ifdef PIANO_HAVE_ALSA
+    if (input == "alsa") {
+        return std::unique_ptr<MidiInput>(new AlsaMidiInput());
+    }
+#endif
+    if (input == "virtual") {
+        return std::unique_ptr<MidiInput>(new VirtualMidiInput());
+    }
+
+    if (errorMessage) {
+        std::string names;
+        for (const std::string &available : availableInputs()) {
+            names += (names.empty() ? "" : ", ") + available;
+        }
+        *errorMessage = "MIDI input '" + input + "' is not available (built in: " + names + ")";
+    }
+    return nullptr;
+}
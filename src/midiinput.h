@@ -0,0 +1,82 @@
+#ifndef MIDIINPUT_H
+#define MIDIINPUT_H
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PianoEngine;
+
+// A MIDI input: a thread of its own that turns incoming MIDI into engine events.
+//
+// Events go straight into the engine's MIDI event queue (PianoEngine::EventSource::Midi)
+// from the input thread, without passing through the GUI's event loop, each stamped with
+// the time the driver received it (on the NoteEvent::now() clock) rather than the time
+// it was read. Handled: note on/off with velocity (a note-on with velocity 0 is a
+// note-off), the sustain pedal (CC64) and the soft pedal (CC67) as continuous positions
+// (so half pedalling works with a continuous pedal), all notes off (CC123: the held notes
+// get note-offs) and all sound off (CC120: every voice is cut). Every channel is listened to. Errors are reported through
+// errorMessage, as everywhere in the engine.
+//
+// Implementations: ALSA sequencer (Linux, where the library was found at build time),
+// and the always-available virtual input, which takes raw MIDI bytes from the program
+// itself - for tests and benchmarks.
+class MidiInput {
+public:
+    MidiInput();
+    virtual ~MidiInput() = default;
+
+    MidiInput(const MidiInput &) = delete;
+    MidiInput &operator=(const MidiInput &) = delete;
+
+    // Name as accepted by create()
+    virtual const char *name() const = 0;
+
+    // Starts delivering events to engine. port is backend-specific (ALSA: "client:port" or a
+    // client name; empty = every hardware MIDI source present)
+    virtual bool start(PianoEngine *engine, const std::string &port, std::string *errorMessage = nullptr) = 0;
+    // Stops the input thread (safe to call more than once)
+    virtual void stop() = 0;
+    // What the input listens to, for the log
+    virtual std::string description() const = 0;
+
+    // Since the input was created (any thread): MIDI messages handled, and events lost
+    // because the engine's MIDI queue was full
+    std::uint64_t eventCount() const { return events.load(std::memory_order_relaxed); }
+    std::uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // An input by name (empty: the first available), or null and an error if it isn't built
+    // into this binary
+    static std::unique_ptr<MidiInput> create(const std::string &name, std::string *errorMessage = nullptr);
+    // Inputs built into this binary, the default first
+    static std::vector<std::string> availableInputs();
+
+protected:
+    // Input thread: raw MIDI bytes, in any pieces. Running status is followed, real-time
+    // bytes may come between a message's bytes, and system exclusive is skipped.
+    void receive(const std::uint8_t *bytes, int count, std::uint64_t timestamp);
+    // Input thread: one complete channel message
+    void deliver(std::uint8_t status, std::uint8_t data1, std::uint8_t data2, std::uint64_t timestamp);
+    // Input thread: forget any partial message (a new connection)
+    void resetParser();
+
+    PianoEngine *engine;
+
+private:
+    void releaseHeldNotes(std::uint64_t timestamp);
+
+    // Parser state (receive)
+    std::uint8_t runningStatus;  // 0: none
+    std::uint8_t data[2];
+    int dataCount;
+    bool inSysex;
+
+    std::bitset<128> held;  // Notes with a note-on and no note-off yet, for all notes off
+    std::atomic<std::uint64_t> events;
+    std::atomic<std::uint64_t> dropped;
+};
+
+#endif // MIDIINPUT_H
@@ -0,0 +1,333 @@
+#include "mixkernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define MIXKERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+// GCC and Clang can compile individual functions for a newer instruction set,
+// so the AVX2 kernels live in the same file without raising the baseline
+#if defined(MIXKERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MIXKERNELS_AVX2 1
+#define MIXKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+
+static void scalarAccumulate(float *mix, const std::int16_t *src, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        mix[i] += src[i];
+    }
+}
+
+static void scalarAccumulateGain(float *mix, const std::int16_t *src, int count, float gain)
+{
+    for (int i = 0; i < count; ++i) {
+        mix[i] += src[i] * gain;
+    }
+}
+
+static void scalarAccumulateRamp(float *mix, const std::int16_t *src, int count, int channels, float gain,
+                                 float gainStep)
+{
+    for (int i = 0; i < count; ++i) {
+        mix[i] += src[i] * (gain + gainStep * static_cast<float>(i / channels));
+    }
+}
+
+static void scalarStore(float *mix, const std::int16_t *src, int count, int total)
+{
+    int i = 0;
+    for (; i < count; ++i) {
+        mix[i] = src[i];
+    }
+    for (; i < total; ++i) {
+        mix[i] = 0;
+    }
+}
+
+static void scalarSaturate(std::int16_t *out, const float *mix, int count)
+{
+    // lrint rounds to nearest even, like the SIMD conversions
+    for (int i = 0; i < count; ++i) {
+        out[i] = static_cast<std::int16_t>(std::lrint(std::clamp(mix[i], -32768.0f, 32767.0f)));
+    }
+}
+
+const MixKernels &scalarMixKernels()
+{
+    static const MixKernels kernels = {
+        "scalar", scalarAccumulate, scalarAccumulateGain, scalarAccumulateRamp, scalarStore, scalarSaturate
+    };
+    return kernels;
+}
+
+// ---------------------------------------------------------------------------
+// SSE2 (8 samples per iteration)
+// ---------------------------------------------------------------------------
+
+#ifdef MIXKERNELS_X86
+
+// Convert 8 x int16 into two vectors of 4 x float (SSE2 has no pmovsx)
+static inline void sse2Widen(__m128i samples, __m128 &low, __m128 &high)
+{
+    low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+    high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+}
+
+static void sse2Accumulate(float *mix, const std::int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 low, high;
+        sse2Widen(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), low, high);
+        _mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), low));
+        _mm_storeu_ps(mix + i + 4, _mm_add_ps(_mm_loadu_ps(mix + i + 4), high));
+    }
+    scalarAccumulate(mix + i, src + i, count - i);
+}
+
+static void sse2AccumulateGain(float *mix, const std::int16_t *src, int count, float gain)
+{
+    const __m128 gains = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 low, high;
+        sse2Widen(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), low, high);
+        _mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(low, gains)));
+        _mm_storeu_ps(mix + i + 4, _mm_add_ps(_mm_loadu_ps(mix + i + 4), _mm_mul_ps(high, gains)));
+    }
+    scalarAccumulateGain(mix + i, src + i, count - i, gain);
+}
+
+static void sse2AccumulateRamp(float *mix, const std::int16_t *src, int count, int channels, float gain,
+                               float gainStep)
+{
+    if (channels != 1 && channels != 2) {
+        scalarAccumulateRamp(mix, src, count, channels, gain, gainStep);
+        return;
+    }
+    // Frame index of each lane relative to the first frame of the iteration (base counts the
+    // frames before it); frame numbers are exact in float, so gain + step * frame rounds
+    // exactly as in the scalar loop
+    const bool stereo = channels == 2;
+    const __m128 lowFrames = stereo ? _mm_setr_ps(0, 0, 1, 1) : _mm_setr_ps(0, 1, 2, 3);
+    const __m128 highFrames = stereo ? _mm_setr_ps(2, 2, 3, 3) : _mm_setr_ps(4, 5, 6, 7);
+    const __m128 gains = _mm_set1_ps(gain);
+    const __m128 steps = _mm_set1_ps(gainStep);
+    const __m128 framesPerIteration = _mm_set1_ps(static_cast<float>(8 / channels));
+    __m128 base = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 lowGain = _mm_add_ps(gains, _mm_mul_ps(steps, _mm_add_ps(base, lowFrames)));
+        const __m128 highGain = _mm_add_ps(gains, _mm_mul_ps(steps, _mm_add_ps(base, highFrames)));
+        __m128 low, high;
+        sse2Widen(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), low, high);
+        _mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(low, lowGain)));
+        _mm_storeu_ps(mix + i + 4, _mm_add_ps(_mm_loadu_ps(mix + i + 4), _mm_mul_ps(high, highGain)));
+        base = _mm_add_ps(base, framesPerIteration);
+    }
+    for (; i < count; ++i) {
+        mix[i] += src[i] * (gain + gainStep * static_cast<float>(i / channels));
+    }
+}
+
+static void sse2Store(float *mix, const std::int16_t *src, int count, int total)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 low, high;
+        sse2Widen(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), low, high);
+        _mm_storeu_ps(mix + i, low);
+        _mm_storeu_ps(mix + i + 4, high);
+    }
+    for (; i < count; ++i) {
+        mix[i] = src[i];
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= total; i += 4) {
+        _mm_storeu_ps(mix + i, zero);
+    }
+    for (; i < total; ++i) {
+        mix[i] = 0.0f;
+    }
+}
+
+static void sse2Saturate(std::int16_t *out, const float *mix, int count)
+{
+    // Clamp in float first: cvtps returns INT_MIN for anything out of int32 range
+    const __m128 lowest = _mm_set1_ps(-32768.0f);
+    const __m128 highest = _mm_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i), lowest), highest);
+        const __m128 high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i + 4), lowest), highest);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high)));
+    }
+    scalarSaturate(out + i, mix + i, count - i);
+}
+
+const MixKernels *sse2MixKernels()
+{
+    // SSE2 is part of the x86-64 baseline
+    static const MixKernels kernels = {
+        "sse2", sse2Accumulate, sse2AccumulateGain, sse2AccumulateRamp, sse2Store, sse2Saturate
+    };
+    return &kernels;
+}
+
+#else
+
+const MixKernels *sse2MixKernels()
+{
+    return nullptr;
+}
+
+#endif // MIXKERNELS_X86
+
+// ---------------------------------------------------------------------------
+// AVX2 (16 samples per iteration)
+// ---------------------------------------------------------------------------
+
+#ifdef MIXKERNELS_AVX2
+
+// Convert 8 x int16 to 8 x float
+MIXKERNELS_TARGET_AVX2
+static inline __m256 avx2Widen(const std::int16_t *src)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src))));
+}
+
+MIXKERNELS_TARGET_AVX2
+static void avx2Accumulate(float *mix, const std::int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_ps(mix + i, _mm256_add_ps(_mm256_loadu_ps(mix + i), avx2Widen(src + i)));
+        _mm256_storeu_ps(mix + i + 8, _mm256_add_ps(_mm256_loadu_ps(mix + i + 8), avx2Widen(src + i + 8)));
+    }
+    scalarAccumulate(mix + i, src + i, count - i);
+}
+
+MIXKERNELS_TARGET_AVX2
+static void avx2AccumulateGain(float *mix, const std::int16_t *src, int count, float gain)
+{
+    // Separate multiply and add (no FMA), so results match the other kernel sets bit for bit
+    const __m256 gains = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 low = _mm256_mul_ps(avx2Widen(src + i), gains);
+        const __m256 high = _mm256_mul_ps(avx2Widen(src + i + 8), gains);
+        _mm256_storeu_ps(mix + i, _mm256_add_ps(_mm256_loadu_ps(mix + i), low));
+        _mm256_storeu_ps(mix + i + 8, _mm256_add_ps(_mm256_loadu_ps(mix + i + 8), high));
+    }
+    scalarAccumulateGain(mix + i, src + i, count - i, gain);
+}
+
+MIXKERNELS_TARGET_AVX2
+static void avx2AccumulateRamp(float *mix, const std::int16_t *src, int count, int channels, float gain,
+                               float gainStep)
+{
+    if (channels != 1 && channels != 2) {
+        scalarAccumulateRamp(mix, src, count, channels, gain, gainStep);
+        return;
+    }
+    const bool stereo = channels == 2;
+    const __m256 lowFrames = stereo ? _mm256_setr_ps(0, 0, 1, 1, 2, 2, 3, 3) : _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 highFrames = stereo ? _mm256_setr_ps(4, 4, 5, 5, 6, 6, 7, 7)
+                                     : _mm256_setr_ps(8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256 gains = _mm256_set1_ps(gain);
+    const __m256 steps = _mm256_set1_ps(gainStep);
+    const __m256 framesPerIteration = _mm256_set1_ps(static_cast<float>(16 / channels));
+    __m256 base = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 lowGain = _mm256_add_ps(gains, _mm256_mul_ps(steps, _mm256_add_ps(base, lowFrames)));
+        const __m256 highGain = _mm256_add_ps(gains, _mm256_mul_ps(steps, _mm256_add_ps(base, highFrames)));
+        const __m256 low = _mm256_mul_ps(avx2Widen(src + i), lowGain);
+        const __m256 high = _mm256_mul_ps(avx2Widen(src + i + 8), highGain);
+        _mm256_storeu_ps(mix + i, _mm256_add_ps(_mm256_loadu_ps(mix + i), low));
+        _mm256_storeu_ps(mix + i + 8, _mm256_add_ps(_mm256_loadu_ps(mix + i + 8), high));
+        base = _mm256_add_ps(base, framesPerIteration);
+    }
+    for (; i < count; ++i) {
+        mix[i] += src[i] * (gain + gainStep * static_cast<float>(i / channels));
+    }
+}
+
+MIXKERNELS_TARGET_AVX2
+static void avx2Store(float *mix, const std::int16_t *src, int count, int total)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_ps(mix + i, avx2Widen(src + i));
+        _mm256_storeu_ps(mix + i + 8, avx2Widen(src + i + 8));
+    }
+    for (; i < count; ++i) {
+        mix[i] = src[i];
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= total; i += 8) {
+        _mm256_storeu_ps(mix + i, zero);
+    }
+    for (; i < total; ++i) {
+        mix[i] = 0.0f;
+    }
+}
+
+MIXKERNELS_TARGET_AVX2
+static void avx2Saturate(std::int16_t *out, const float *mix, int count)
+{
+    const __m256 lowest = _mm256_set1_ps(-32768.0f);
+    const __m256 highest = _mm256_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i low = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(mix + i), lowest), highest));
+        const __m256i high = _mm256_cvtps_epi32(
+            _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(mix + i + 8), lowest), highest));
+        // packs works within 128-bit lanes; restore sample order afterwards
+        const __m256i packed = _mm256_packs_epi32(low, high);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                            _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    scalarSaturate(out + i, mix + i, count - i);
+}
+
+const MixKernels *avx2MixKernels()
+{
+    static const MixKernels kernels = {
+        "avx2", avx2Accumulate, avx2AccumulateGain, avx2AccumulateRamp, avx2Store, avx2Saturate
+    };
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported ? &kernels : nullptr;
+}
+
+#else
+
+const MixKernels *avx2MixKernels()
+{
+    return nullptr;
+}
+
+#endif // MIXKERNELS_AVX2
+
+const MixKernels &mixKernels()
+{
+    static const MixKernels &best = []() -> const MixKernels & {
+        if (const MixKernels *kernels = avx2MixKernels()) {
+            return *kernels;
+        }
+        if (const MixKernels *kernels = sse2MixKernels()) {
+            return *kernels;
+        }
+        return scalarMixKernels();
+    }();
+    return best;
+}
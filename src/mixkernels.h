@@ -0,0 +1,45 @@
+#ifndef MIXKERNELS_H
+#define MIXKERNELS_H
+
+#include <cstdint>
+
+// Inner loops of the mixer, in scalar and SIMD flavours. All variants produce
+// bit-identical results; the fastest one the CPU supports is picked once at
+// startup (SSE2 / AVX2 on x86, scalar elsewhere).
+//
+// The mix bus is 32-bit float in 16-bit sample units (full scale = 32768), so it
+// has headroom for any chord and unity-gain voices sum exactly. Gains are linear.
+struct MixKernels {
+    const char *name;
+
+    // mix[i] += src[i]
+    void (*accumulate)(float *mix, const std::int16_t *src, int count);
+
+    // mix[i] += src[i] * gain
+    void (*accumulateGain)(float *mix, const std::int16_t *src, int count, float gain);
+
+    // mix[i] += src[i] * (gain + gainStep * frame), frame = i / channels: a gain ramp across
+    // interleaved frames (envelope sub-blocks). SIMD for mono and stereo, scalar otherwise.
+    void (*accumulateRamp)(float *mix, const std::int16_t *src, int count, int channels, float gain, float gainStep);
+
+    // Clear and accumulate in one pass (first voice of a block):
+    // mix[i] = src[i] for i < count, mix[i] = 0 for count <= i < total
+    void (*store)(float *mix, const std::int16_t *src, int count, int total);
+
+    // out[i] = clamp(mix[i], -32768, 32767), rounded to nearest (even)
+    void (*saturate)(std::int16_t *out, const float *mix, int count);
+};
+
+// Gain that means "unity" - callers use accumulate() instead of accumulateGain()
+static const float mixUnityGain = 1.0f;
+
+// Best kernels for this CPU (selected on first call)
+const MixKernels &mixKernels();
+
+// Individual implementations, for verification and benchmarks.
+// The SIMD getters return nullptr if the CPU (or build) doesn't support them.
+const MixKernels &scalarMixKernels();
+const MixKernels *sse2MixKernels();
+const MixKernels *avx2MixKernels();
+
+#endif // MIXKERNELS_H
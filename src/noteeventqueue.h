@@ -0,0 +1,105 @@
+#ifndef NOTEEVENTQUEUE_H
+#define NOTEEVENTQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// A single input event travelling from the UI thread to the audio render thread.
+// Events are plain data (no Qt types, no ownership) so they can be copied into the
+// ring buffer and out again without touching the heap.
+struct NoteEvent {
+    enum Type : std::uint8_t {
+        NoteOn,
+        NoteOff,
+        DamperPedal,  // value: pedal position, 0 (up) .. 1 (down), anything in between
+        UnaCorda,     // value: pedal position, 0 (up) .. 1 (down), anything in between
+        AllSoundOff   // Every voice cut on the spot, and the strings' resonance with them
+    };
+
+    Type type;
+    int note;  // MIDI note number (NoteOn / NoteOff only)
+    float value;  // Velocity for NoteOn, pedal position for pedal events
+    std::uint64_t timestamp;  // Monotonic time in nanoseconds (now()) when the event happened
+
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+// Fixed-capacity, wait-free single-producer / single-consumer ring buffer.
+// Exactly one thread may call push() and exactly one (other) thread may call pop().
+// Neither side ever blocks, locks or allocates, which makes pop() safe to call
+// from the real-time audio thread.
+template <typename T, std::size_t Capacity>
+class SpscRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    SpscRingBuffer() : head(0), tail(0) {}
+
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    // Producer side. Returns false (and drops the item) if the buffer is full.
+    bool push(const T &item)
+    {
+        const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) >= Capacity) {
+            return false;
+        }
+        slots[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: the next item without removing it, or null if there is nothing to read
+    const T *front() const
+    {
+        const std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[currentHead & (Capacity - 1)];
+    }
+
+    // Consumer side. Returns false if there is nothing to read.
+    bool pop(T &item)
+    {
+        const std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items (exact when called from either endpoint thread
+    // while the other is idle)
+    std::size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const { return size() == 0; }
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+    // Keep the producer and consumer indices on separate cache lines so the two
+    // threads don't invalidate each other's line on every push/pop
+    alignas(64) std::atomic<std::size_t> head;  // Next slot to read (owned by consumer)
+    alignas(64) std::atomic<std::size_t> tail;  // Next slot to write (owned by producer)
+    alignas(64) T slots[Capacity];
+};
+
+// 1024 events is far more than a human (or a MIDI keyboard) can produce within
+// one audio buffer
+using NoteEventQueue = SpscRingBuffer<NoteEvent, 1024>;
+
+#endif // NOTEEVENTQUEUE_H
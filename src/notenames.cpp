@@ -0,0 +1,48 @@
+#include "notenames.h"
+
+#include <cctype>
+#include <cstdlib>
+
+static const char *const sharpNames[12] = {
+    "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
+};
+
+int noteNumberFromName(const std::string &name)
+{
+    static const int letterSemitones[7] = {9, 11, 0, 2, 4, 5, 7};  // A B C D E F G
+
+    if (name.size() < 2) {
+        return -1;
+    }
+    const char letter = static_cast<char>(std::toupper(static_cast<unsigned char>(name[0])));
+    if (letter < 'A' || letter > 'G') {
+        return -1;
+    }
+    int semitone = letterSemitones[letter - 'A'];
+
+    size_t pos = 1;
+    if (name[pos] == '#') {
+        ++semitone;
+        ++pos;
+    } else if (name[pos] == 'b') {
+        --semitone;
+        ++pos;
+    }
+
+    if (pos >= name.size()) {
+        return -1;
+    }
+    char *end = nullptr;
+    const long octave = std::strtol(name.c_str() + pos, &end, 10);
+    if (*end != '\0' || end == name.c_str() + pos) {
+        return -1;
+    }
+
+    const int note = static_cast<int>((octave + 1) * 12 + semitone);
+    return (note >= 0 && note < 128) ? note : -1;
+}
+
+std::string noteNameFromNumber(int note)
+{
+    return std::string(sharpNames[note % 12]) + std::to_string(note / 12 - 1);
+}
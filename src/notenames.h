@@ -0,0 +1,13 @@
+#ifndef NOTENAMES_H
+#define NOTENAMES_H
+
+#include <string>
+
+// Convert a note name ("C4", "C#4", "Db4") to a MIDI note number (middle C = C4 = 60).
+// Returns -1 if the name can't be parsed.
+int noteNumberFromName(const std::string &name);
+
+// Convert a MIDI note number to a name using sharps ("C#4")
+std::string noteNameFromNumber(int note);
+
+#endif // NOTENAMES_H
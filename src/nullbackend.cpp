@@ -0,0 +1,92 @@
+#include "nullbackend.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <chrono>
+
+static bool fail(std::string *errorMessage, const std::string &message)
+{
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+    return false;
+}
+
+NullBackend::NullBackend(bool writeFile)
+    : writeFile(writeFile), running(false), buffers(0), xruns(0)
+{
+}
+
+NullBackend::~NullBackend()
+{
+    stop();
+}
+
+bool NullBackend::open(const AudioSettings &requested, std::string *errorMessage)
+{
+    stop();
+    if (requested.sampleRate <= 0 || requested.channels <= 0 || requested.bufferFrames <= 0) {
+        return fail(errorMessage, "Invalid audio settings for the " + std::string(name()) + " backend");
+    }
+    current = requested;
+    current.backend = name();
+    current.periods = 1;  // Nothing is queued ahead: each buffer is "played" as soon as it is pulled
+    if (writeFile) {
+        if (current.outputPath.empty()) {
+            return fail(errorMessage, "The file backend needs an output path");
+        }
+        if (!wav.open(current.outputPath, current.sampleRate, current.channels, errorMessage)) {
+            return false;
+        }
+    }
+    buffer.assign(static_cast<std::size_t>(current.bufferFrames) * current.channels, 0.0f);
+    return true;
+}
+
+bool NullBackend::start(PianoEngine *engine, std::string *errorMessage)
+{
+    if (buffer.empty()) {
+        return fail(errorMessage, "The " + std::string(name()) + " backend is not open");
+    }
+    if (running.load()) {
+        return true;
+    }
+    running.store(true);
+    resetCounters();
+    buffers.store(0, std::memory_order_relaxed);
+    xruns.store(0, std::memory_order_relaxed);
+    thread = std::thread(&NullBackend::run, this, engine);
+    return true;
+}
+
+void NullBackend::stop()
+{
+    running.store(false);
+    if (thread.joinable()) {
+        thread.join();
+    }
+    wav.close();
+}
+
+void NullBackend::run(PianoEngine *engine)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+    const std::chrono::nanoseconds period(static_cast<std::int64_t>(1e9 * current.bufferFrames / current.sampleRate));
+    std::uint64_t framesPulled = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        renderBuffer(engine, buffer.data(), current.bufferFrames);
+        if (writeFile) {
+            wav.write(buffer.data(), current.bufferFrames);
+        }
+        framesPulled += current.bufferFrames;
+        buffers.fetch_add(1, std::memory_order_relaxed);
+        // The next buffer is due when this one would have finished playing
+        const Clock::time_point due = startTime + std::chrono::nanoseconds(
+            static_cast<std::int64_t>(framesPulled * 1000000000ull / current.sampleRate));
+        std::this_thread::sleep_until(due);
+        if (Clock::now() - due > period) {
+            xruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef NULLBACKEND_H
+#define NULLBACKEND_H
+
+#include "audiobackend.h"
+#include "wavfile.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// A device that isn't there: a thread pulls buffers from the engine at real-time pace
+// (one buffer per buffer period, on an absolute schedule so it doesn't drift) and either
+// discards them ("null") or appends them to a WAV file ("file", settings().outputPath).
+// Any rate, channel count and buffer size is accepted as requested. Runs anywhere, so the
+// whole app can be driven headless. A wakeup more than a buffer late (the timer thread fell
+// behind, as a device would have run dry) counts as an xrun.
+class NullBackend : public AudioBackend {
+public:
+    explicit NullBackend(bool writeFile);
+    ~NullBackend() override;
+
+    const char *name() const override { return writeFile ? "file" : "null"; }
+    bool open(const AudioSettings &requested, std::string *errorMessage = nullptr) override;
+    bool start(PianoEngine *engine, std::string *errorMessage = nullptr) override;
+    void stop() override;
+    int latencyFrames() const override { return current.bufferFrames; }
+    std::uint64_t xrunCount() const override { return xruns.load(std::memory_order_relaxed); }
+
+    // Buffers pulled since start() (any thread)
+    std::uint64_t bufferCount() const { return buffers.load(std::memory_order_relaxed); }
+
+private:
+    void run(PianoEngine *engine);
+
+    const bool writeFile;
+    WavFileWriter wav;
+    std::vector<float> buffer;  // One period, interleaved
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<std::uint64_t> buffers;
+    std::atomic<std::uint64_t> xruns;
+};
+
+#endif // NULLBACKEND_H
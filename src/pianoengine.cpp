@@ -0,0 +1,1606 @@
+#include "pianoengine.h"
+#include "wavfile.h"
+#include "mixkernels.h"
+#include "samplebank.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <sys/stat.h>
+#include <thread>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const std::uint64_t unityStep = std::uint64_t(1) << 32;  // 32.32: one source frame per output frame
+
+// Output frames until a read position (frame + fraction, advancing by step) reaches target;
+// at least 1, at most limit
+static int framesUntil(int frame, std::uint32_t fraction, int target, std::uint64_t step, int limit)
+{
+    if (frame >= target || step == 0) {
+        return limit;
+    }
+    const std::uint64_t distance = (static_cast<std::uint64_t>(target - frame) << 32) - fraction;
+    return static_cast<int>(std::min<std::uint64_t>(static_cast<std::uint64_t>(limit),
+                                                    (distance + step - 1) / step));
+}
+
+PianoEngine::PianoEngine(int sampleRate, int channels, int maxFramesPerRender)
+    : outputSampleRate(sampleRate), outputChannels(channels), maxFrames(maxFramesPerRender),
+      noteCutoffMs(defaultNoteCutoffMs), cutoffFrames(0), currentLayout(nullptr), activeLayout(nullptr),
+      streamSamples(false),
+      preloadMs(defaultPreloadMs), maxStreams(DiskStreamer::defaultStreams), kernels(mixKernels()), resamplerQuality(ResampleQuality::Cubic),
+      normalizeSamples(false), mapSamples(true), prefetchMs(defaultPrefetchMs), shiftRange(0), loadCancelled(false),
+      memoryBudget(0), residentBytes(0), fallbacks(0), pagerRunning(false), noteOnSerial(0),
+      voices(defaultMaxPolyphony), bufferTime(0), bufferEnd(0), bufferFrame(0), unaCordaWritten(false), mixJob(), parallelDeadlineNs(defaultParallelDeadlineUs * 1000ull), parallelBackoffFrames(0),
+      parallelBackoff(0), parallelMisses(0), parallelSerialBlocks(0), limitOutput(true), masterBusGain(1.0f),
+      resonanceLevel(ResonanceBank::defaultLevel), damperPosition(0.0f),
+      unaCordaPosition(0.0f), unaCordaLevel(0.0f), publishedDamper(0.0f), publishedUnaCorda(0.0f),
+      perVoiceUnaCorda(false)
+{
+    // One slot per note, playing at every velocity, until a sample set is installed
+    std::vector<SampleZone> zones(maxNotes);
+    for (int note = 0; note < maxNotes; ++note) {
+        zones[note].note = note;
+        zones[note].velocity = 127;
+        zones[note].alternate = 0;
+    }
+    activeLayout = &publishLayout(zones);
+    setOutputFormat(sampleRate, channels);
+}
+
+PianoEngine::~PianoEngine()
+{
+    stopLoading();
+    stopPager();
+}
+
+void PianoEngine::setOutputFormat(int sampleRate, int channels, int maxFramesPerRender)
+{
+    outputSampleRate = sampleRate;
+    outputChannels = channels;
+    if (maxFramesPerRender > 0) {
+        maxFrames = maxFramesPerRender;
+    }
+
+    allocateMixBuffers();
+    limiter.setFormat(outputSampleRate, outputChannels);
+    unaCordaFilter.setup(outputSampleRate, outputChannels);
+    unaCordaVoiceFilter.setup(outputSampleRate, outputChannels);
+
+    setNoteCutoff(noteCutoffMs);
+    envelope.setup(envelope.settings(), outputSampleRate);
+    setupDamping();
+    if (streamSamples) {
+        startStreamer();  // Ring sizes depend on the output format
+    }
+
+    // Resampling steps and filter tables depend on the output rate
+    sincTables.clear();
+    SampleLayout &current = layout();
+    for (int slot = 0; slot < current.slotCount; ++slot) {
+        prepareResampling(current.slots[slot].sample, current.shiftRange);
+    }
+}
+
+void PianoEngine::setNoteCutoff(int milliseconds)
+{
+    noteCutoffMs = std::max(0, milliseconds);
+    cutoffFrames = noteCutoffMs > 0
+        ? static_cast<int>(static_cast<std::int64_t>(outputSampleRate) * noteCutoffMs / 1000)
+        : std::numeric_limits<int>::max();
+}
+
+void PianoEngine::setEnvelope(const EnvelopeSettings &settings)
+{
+    envelope.setup(settings, outputSampleRate);
+    setupDamping();
+}
+
+double PianoEngine::noteDampingMs(int note) const
+{
+    return note >= 0 && note < maxNotes ? dampingMs[note] : 0.0;
+}
+
+void PianoEngine::setupDamping()
+{
+    // Heavier strings take longer to stop: the damping time doubles every two octaves down from
+    // middle C (and halves every two up), within 0.5x .. 3x the release time. The top strings,
+    // short enough to die away by themselves, have no dampers.
+    for (int note = 0; note < maxNotes; ++note) {
+        const double speed = std::clamp(std::pow(2.0, (note - 60) / 24.0), 1.0 / 3.0, 2.0);
+        dampingSpeed[note] = note < undampedNote ? static_cast<float>(speed) : 0.0f;
+        dampingMs[note] = note < undampedNote ? static_cast<float>(envelope.settings().releaseMs / speed) : 0.0f;
+    }
+    resonanceBank.setup(outputSampleRate, outputChannels, maxFrames, dampingMs.data());
+}
+
+void PianoEngine::setResonance(float level)
+{
+    resonanceLevel.store(std::max(0.0f, level), std::memory_order_relaxed);
+}
+
+void PianoEngine::setUnaCordaPerVoice(bool enabled)
+{
+    perVoiceUnaCorda.store(enabled, std::memory_order_relaxed);
+}
+
+void PianoEngine::setLimiter(bool enabled, double lookaheadMs, double releaseMs, double ceilingDb)
+{
+    limitOutput = enabled;
+    limiter.setup(outputSampleRate, outputChannels, lookaheadMs, releaseMs, ceilingDb);
+}
+
+void PianoEngine::setMasterGain(float gain)
+{
+    masterBusGain.store(std::max(0.0f, gain), std::memory_order_relaxed);
+}
+
+double PianoEngine::limiterReduction() const
+{
+    return 20.0 * std::log10(limiter.lowestGain());
+}
+
+void PianoEngine::setStreaming(bool enabled, int preloadMilliseconds, int streams)
+{
+    streamSamples = enabled;
+    preloadMs = std::max(0, preloadMilliseconds);
+    maxStreams = std::max(1, streams);
+    if (enabled) {
+        startStreamer();
+    } else {
+        streamer.stop();
+    }
+}
+
+void PianoEngine::startStreamer()
+{
+    // Each ring holds half a second at the output rate: the reader has that long to
+    // catch up before a voice underruns
+    streamer.start(maxStreams, outputSampleRate * outputChannels / 2);
+}
+
+bool PianoEngine::shouldStream(int sampleRate, int channels, std::size_t length) const
+{
+    // Only direct-mix samples stream; resampled voices read around their position
+    const std::size_t preloadSamples = static_cast<std::size_t>(sampleRate) * channels * preloadMs / 1000;
+    return streamSamples && sampleRate == outputSampleRate && channels == outputChannels &&
+           length > preloadSamples;
+}
+
+void PianoEngine::makeStreamed(Sample &sample, const std::int16_t *pcm, std::shared_ptr<StreamFile> file,
+                               std::uint64_t dataOffset) const
+{
+    // Copy the head into memory (whole frames); the reader thread supplies the rest
+    const int preloadFrames = static_cast<int>(static_cast<std::int64_t>(sample.sampleRate) * preloadMs / 1000);
+    sample.pcm.assign(pcm, pcm + preloadFrames * sample.channels);
+    prepareLoop(sample, pcm);  // The loop may lie beyond the head
+    sample.stream.reset(new StreamSource);
+    sample.stream->file = std::move(file);
+    sample.stream->dataOffset = dataOffset;
+    sample.stream->length = sample.length;
+}
+
+void PianoEngine::prepareLoop(Sample &sample, const std::int16_t *pcm) const
+{
+    if (sample.loop || sample.loopStart < 0 || sample.channels <= 0) {
+        return;
+    }
+    const int crossfadeFrames = static_cast<int>(sample.sampleRate * SampleLoop::defaultCrossfadeMs / 1000.0);
+    sample.loop = buildSampleLoop(pcm, sample.length / sample.channels, sample.channels, sample.loopStart,
+                                  sample.loopEnd, crossfadeFrames);
+}
+
+void PianoEngine::setResampleQuality(ResampleQuality quality)
+{
+    resamplerQuality = quality;
+    SampleLayout &current = layout();
+    for (int slot = 0; slot < current.slotCount; ++slot) {
+        prepareResampling(current.slots[slot].sample, current.shiftRange);
+    }
+}
+
+void PianoEngine::prepareResampling(Sample &sample, int range)
+{
+    sample.resampleSteps.fill(0);
+    sample.resampleTables.fill(nullptr);
+    if (!sample.data || sample.sampleRate <= 0) {
+        return;
+    }
+    // Playing a sample s semitones higher reads it 2^(s/12) times faster - the same as
+    // converting from a source rate that much higher, band limit included
+    for (int shift = -range; shift <= range; ++shift) {
+        const int index = maxPitchShift + shift;
+        const double ratio = std::pow(2.0, shift / 12.0);
+        sample.resampleSteps[index] = shift == 0 ? resampleStep(sample.sampleRate, outputSampleRate)
+            : static_cast<std::uint64_t>(std::llround(ratio * sample.sampleRate / outputSampleRate * 4294967296.0));
+        if (sample.resampleSteps[index] != unityStep && resamplerQuality == ResampleQuality::Sinc) {
+            sample.resampleTables[index] = sincTableFor(static_cast<int>(std::lround(sample.sampleRate * ratio)));
+        }
+    }
+}
+
+const SincTable *PianoEngine::sincTableFor(int sourceRate)
+{
+    // Share one coefficient table between all samples with the same (effective) rate
+    std::lock_guard<std::mutex> lock(sincTableMutex);
+    for (const std::unique_ptr<SincTable> &table : sincTables) {
+        if (table->sourceRate() == sourceRate && table->outputRate() == outputSampleRate) {
+            return table.get();
+        }
+    }
+    sincTables.emplace_back(new SincTable(sourceRate, outputSampleRate));
+    return sincTables.back().get();
+}
+
+void PianoEngine::setMaxPolyphony(int maxVoices)
+{
+    // Preallocates every per-voice array; the audio thread never grows them
+    renderPool.wait();
+    voices.setCapacity(maxVoices);
+    allocateMixBuffers();
+}
+
+void PianoEngine::setParallelRendering(int threads, int deadlineUs)
+{
+    renderPool.start(threads);
+    parallelDeadlineNs = static_cast<std::uint64_t>(std::max(0, deadlineUs)) * 1000;
+    parallelBackoff = 0;
+    allocateMixBuffers();
+}
+
+void PianoEngine::allocateMixBuffers()
+{
+    // Pre-allocate mix buffers for the maximum block size
+    // This avoids allocations in render() which can cause lag
+    const std::size_t blockSamples = static_cast<std::size_t>(maxFrames) * outputChannels;
+    renderPool.wait();  // No worker may be writing to the buffers being replaced
+    mixBuffer.assign(blockSamples, 0.0f);
+    unaCordaBuffer.assign(blockSamples, 0.0f);
+    unaCordaWritten = false;
+    voiceEnded.assign(voices.capacity(), 0);
+
+    // One buffer per group of voices, only when rendering in parallel
+    const int tasks = renderPool.threadCount() > 0 ? (voices.capacity() + voicesPerTask - 1) / voicesPerTask : 0;
+    taskBuffers.assign(tasks * blockSamples, 0.0f);
+    taskWritten.assign(tasks, 0);
+    taskDone.assign(tasks, 0);
+    taskUnaCordaBuffers.assign(tasks * blockSamples, 0.0f);
+    taskUnaCordaWritten.assign(tasks, 0);
+    // In frames rather than blocks: blocks are as short as the device buffer, not maxFrames
+    parallelBackoffFrames = static_cast<int>(static_cast<std::int64_t>(outputSampleRate) * parallelBackoffMs / 1000);
+}
+
+void PianoEngine::setVoiceStealPolicy(VoicePool::StealPolicy policy)
+{
+    voices.setStealPolicy(policy);
+}
+
+void PianoEngine::setSampleNormalization(bool enabled, const std::string &cacheDirectory)
+{
+    normalizeSamples = enabled;
+    sampleCache.setDirectory(cacheDirectory);
+}
+
+void PianoEngine::setMemoryMapping(bool enabled, int prefetchMilliseconds)
+{
+    mapSamples = enabled;
+    prefetchMs = std::max(0, prefetchMilliseconds);
+}
+
+bool PianoEngine::readSample(const std::string &filePath, Sample &sample, std::string *errorMessage)
+{
+    WavData wav;
+    if (!mapSamples && !streamSamples) {
+        const bool ok = normalizeSamples
+            ? sampleCache.load(filePath, outputSampleRate, outputChannels, wav, errorMessage)
+            : readWavFile(filePath, wav, errorMessage);
+        if (!ok) {
+            return false;
+        }
+    } else {
+        auto mapping = std::make_shared<MappedFile>();
+        WavLayout layout;
+        if (!mapping->open(filePath, errorMessage) ||
+            !locateWavData(mapping->data(), mapping->size(), layout, filePath, errorMessage)) {
+            return false;
+        }
+        readLoopSidecar(filePath, static_cast<int>(layout.sampleCount / std::max(1, layout.channels)),
+                        layout.loopStart, layout.loopEnd);
+        sample.loopStart = layout.loopStart;
+        sample.loopEnd = layout.loopEnd;
+
+        const bool needsConversion = normalizeSamples &&
+            (layout.sampleRate != outputSampleRate || layout.channels != outputChannels);
+        if (needsConversion || layout.dataOffset % sizeof(std::int16_t) != 0) {
+            // Converted (or misaligned) PCM has to live on the heap; the mapping is dropped
+            const bool ok = needsConversion
+                ? sampleCache.load(mapping->data(), mapping->size(), filePath,
+                                   outputSampleRate, outputChannels, wav, errorMessage)
+                : parseWavData(mapping->data(), mapping->size(), wav, filePath, errorMessage);
+            if (!ok) {
+                return false;
+            }
+            if (!needsConversion) {
+                wav.loopStart = layout.loopStart;  // With the sidecar applied
+                wav.loopEnd = layout.loopEnd;
+            }
+        } else if (shouldStream(layout.sampleRate, layout.channels, layout.sampleCount)) {
+            // Keep the head resident and stream the rest; the mapping is only used to copy the head
+            std::shared_ptr<StreamFile> file = StreamFile::open(filePath, errorMessage);
+            if (!file) {
+                return false;
+            }
+            sample.sampleRate = layout.sampleRate;
+            sample.channels = layout.channels;
+            sample.length = static_cast<int>(layout.sampleCount);
+            makeStreamed(sample, reinterpret_cast<const std::int16_t *>(mapping->data() + layout.dataOffset),
+                         std::move(file), layout.dataOffset);
+        } else if (mapSamples) {
+            // Play straight from the mapping: no copy, pages arrive on first touch
+            // except for the attack, which is read in now
+            prefetchAttack(*mapping, layout.dataOffset, layout.sampleRate, layout.channels);
+            sample.data = reinterpret_cast<const std::int16_t *>(mapping->data() + layout.dataOffset);
+            sample.length = static_cast<int>(layout.sampleCount);
+            sample.sampleRate = layout.sampleRate;
+            sample.channels = layout.channels;
+            sample.mapping = std::move(mapping);
+        } else if (!parseWavData(mapping->data(), mapping->size(), wav, filePath, errorMessage)) {
+            return false;
+        } else {
+            wav.loopStart = layout.loopStart;
+            wav.loopEnd = layout.loopEnd;
+        }
+    }
+
+    if (!sample.mapping && !sample.stream) {
+        sample.pcm = std::move(wav.samples);
+        sample.data = sample.pcm.data();
+        sample.length = static_cast<int>(sample.pcm.size());
+        sample.sampleRate = wav.sampleRate;
+        sample.channels = wav.channels;
+        sample.loopStart = wav.loopStart;
+        sample.loopEnd = wav.loopEnd;
+    }
+    if (sample.length == 0) {
+        if (errorMessage) {
+            *errorMessage = "WAV file contains no audio: " + filePath;
+        }
+        return false;
+    }
+    return true;
+}
+
+std::size_t PianoEngine::attackBytes(int sampleRate, int channels) const
+{
+    const std::size_t bytesPerMs = static_cast<std::size_t>(sampleRate) * channels * sizeof(std::int16_t) / 1000;
+    return bytesPerMs * prefetchMs;
+}
+
+void PianoEngine::prefetchAttack(const MappedFile &mapping, std::size_t offset, int sampleRate, int channels) const
+{
+    mapping.willNeed(offset, attackBytes(sampleRate, channels));
+    mapping.prefault(offset, attackBytes(sampleRate, channels));
+}
+
+std::size_t PianoEngine::sampleMemory(const Sample &sample) const
+{
+    // A mapped sample holds only its prefetched attack; the rest is the page cache's to drop
+    if (sample.mapping) {
+        return std::min(static_cast<std::size_t>(sample.length) * sizeof(std::int16_t),
+                        attackBytes(sample.sampleRate, sample.channels)) + loopMemory(sample);
+    }
+    return sample.pcm.size() * sizeof(std::int16_t) + loopMemory(sample);
+}
+
+void PianoEngine::setSampleSet(const SampleSet &set)
+{
+    waitForLoading();
+    stopPager();
+    publishLayout(set.zones());
+}
+
+void PianoEngine::setPitchShiftRange(int semitones)
+{
+    shiftRange = std::clamp(semitones, 0, static_cast<int>(maxPitchShift));
+}
+
+void PianoEngine::setSampleMemoryBudget(std::size_t bytes)
+{
+    memoryBudget = bytes;
+}
+
+PianoEngine::SampleLayout &PianoEngine::publishLayout(const std::vector<SampleZone> &zones)
+{
+    std::unique_ptr<SampleLayout> built(new SampleLayout);
+    SampleLayout &next = *built;
+    next.slots.reset(new Slot[zones.size()]);
+    next.slotCount = static_cast<int>(zones.size());
+
+    // Zones arrive sorted by note, velocity and alternate: consecutive zones with the same
+    // note and velocity are one layer's alternates
+    for (int i = 0; i < next.slotCount; ++i) {
+        const SampleZone &zone = zones[i];
+        Slot &slot = next.slots[i];
+        slot.path = zone.path;
+        slot.note = zone.note;
+        slot.velocity = zone.velocity;
+        if (i == 0 || zones[i - 1].note != zone.note || zones[i - 1].velocity != zone.velocity) {
+            if (next.layerCount[zone.note] == 0) {
+                next.firstLayer[zone.note] = static_cast<int>(next.layers.size());
+            }
+            next.layers.push_back({i, 0, 127.0f / zone.velocity});
+            ++next.layerCount[zone.note];
+        }
+        slot.alternate = next.layers.back().count++;
+    }
+
+    // Notes without zones borrow every layer of the nearest sampled note in range (the lower
+    // one on a tie) and play it shifted up or down by the distance
+    next.shiftRange = shiftRange;
+    std::array<bool, maxNotes> sampled{};
+    for (int note = 0; note < maxNotes; ++note) {
+        sampled[note] = next.layerCount[note] > 0;
+    }
+    for (int note = 0; note < maxNotes; ++note) {
+        for (int distance = 1; distance <= shiftRange && !sampled[note]; ++distance) {
+            for (const int source : {note - distance, note + distance}) {
+                if (source >= 0 && source < maxNotes && sampled[source]) {
+                    next.firstLayer[note] = next.firstLayer[source];
+                    next.layerCount[note] = next.layerCount[source];
+                    next.pitchShift[note] = note - source;
+                    break;
+                }
+            }
+            if (next.layerCount[note] > 0) {
+                break;
+            }
+        }
+    }
+
+    // Velocity lookup: a layer plays from just above the next softer layer up to its top, and
+    // the loudest one everything above - so its level at full velocity is the recorded one
+    next.velocityLayers.assign(maxNotes * 128, SampleLayout::noLayer);
+    for (int note = 0; note < maxNotes; ++note) {
+        int low = 0;
+        for (int i = 0; i < next.layerCount[note]; ++i) {
+            const int layer = next.firstLayer[note] + i;
+            const bool loudest = i + 1 == next.layerCount[note];
+            const int top = loudest ? 127 : next.slots[next.layers[layer].first].velocity;
+            if (loudest) {
+                next.layers[layer].gainScale = 1.0f;
+            }
+            for (int velocity = low; velocity <= top; ++velocity) {
+                next.velocityLayers[note * 128 + velocity] = static_cast<std::uint16_t>(layer);
+            }
+            low = top + 1;
+        }
+    }
+    next.nextAlternate.assign(next.layers.size(), 0);
+
+    // The budget covers the current set only
+    residentBytes.store(0, std::memory_order_relaxed);
+    layouts.push_back(std::move(built));
+    currentLayout.store(&next, std::memory_order_release);
+    return next;
+}
+
+int PianoEngine::primarySlot(int note) const
+{
+    if (note < 0 || note >= maxNotes) {
+        return -1;
+    }
+    const SampleLayout &current = layout();
+    if (current.layerCount[note] == 0 || current.pitchShift[note] != 0) {
+        return -1;  // Nothing to fill, or the slots belong to the note it borrows from
+    }
+    return current.layers[current.firstLayer[note] + current.layerCount[note] - 1].first;
+}
+
+std::vector<int> PianoEngine::loadOrder(const SampleLayout &layout) const
+{
+    // First alternates before the rest, and louder layers first: full velocity is what the
+    // keyboard and scripts play by default, and the first alternate of any layer is what a
+    // single note-on needs
+    std::vector<int> order(layout.slotCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&layout](int a, int b) {
+        const Slot &first = layout.slots[a];
+        const Slot &second = layout.slots[b];
+        if (first.alternate != second.alternate) {
+            return first.alternate < second.alternate;
+        }
+        return first.velocity > second.velocity;
+    });
+    return order;
+}
+
+bool PianoEngine::loadSample(int note, const std::string &filePath, std::string *errorMessage)
+{
+    Sample sample;
+    if (!readSample(filePath, sample, errorMessage)) {
+        return false;
+    }
+    const int slot = primarySlot(note);
+    if (slot >= 0) {
+        installSample(layout(), slot, std::move(sample));
+    }
+    return true;
+}
+
+int PianoEngine::loadSamples(const std::vector<std::pair<int, std::string>> &files,
+                             std::vector<std::string> *errorMessages)
+{
+    std::mutex resultMutex;
+    int count = 0;
+    loadSamplesAsync(files, [&](int, bool ok, const std::string &errorMessage) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        if (ok) {
+            ++count;
+        } else if (errorMessages) {
+            errorMessages->push_back(errorMessage);
+        }
+    });
+    waitForLoading();
+    return count;
+}
+
+void PianoEngine::loadSamplesAsync(const std::vector<std::pair<int, std::string>> &files, LoadCallback onLoaded)
+{
+    waitForLoading();  // One job at a time
+    std::vector<LoadItem> items;
+    for (const std::pair<int, std::string> &file : files) {
+        items.push_back({primarySlot(file.first), file.first, file.second});
+    }
+    startLoading(std::move(items), std::move(onLoaded));
+}
+
+int PianoEngine::loadSampleSetAsync(LoadCallback onLoaded)
+{
+    waitForLoading();
+    SampleLayout &current = layout();
+    std::vector<LoadItem> items;
+    std::size_t estimated = residentBytes.load(std::memory_order_relaxed);
+    for (int slot : loadOrder(current)) {
+        Slot &target = current.slots[slot];
+        if (target.path.empty() || target.ready.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        if (memoryBudget > 0) {
+            // Estimated from the file size without opening it (mapped samples hold just the attack)
+            struct stat info;
+            std::size_t bytes = stat(target.path.c_str(), &info) == 0 ? static_cast<std::size_t>(info.st_size) : 0;
+            if (mapSamples) {
+                bytes = std::min(bytes, attackBytes(outputSampleRate, outputChannels));
+            }
+            if (estimated + bytes > memoryBudget) {
+                target.cold.store(true, std::memory_order_relaxed);  // Left for the pager
+                continue;
+            }
+            estimated += bytes;
+        }
+        items.push_back({slot, target.note, target.path});
+    }
+
+    const int queued = static_cast<int>(items.size());
+    if (memoryBudget > 0) {
+        startPager();
+    }
+    startLoading(std::move(items), std::move(onLoaded));
+    return queued;
+}
+
+void PianoEngine::startLoading(std::vector<LoadItem> items, LoadCallback onLoaded)
+{
+    loadCancelled = false;
+    loadJob.reset(new LoadJob);
+    loadJob->items = std::move(items);
+    loadJob->onLoaded = std::move(onLoaded);
+
+    // Decode (and convert) on a pool of loader threads, one per core
+    const std::size_t threadCount = std::min<std::size_t>(
+        loadJob->items.size(), std::max(1u, std::thread::hardware_concurrency()));
+    for (std::size_t t = 0; t < threadCount; ++t) {
+        loaderThreads.emplace_back(&PianoEngine::loadWorker, this, std::cref(loadJob->items),
+                                   std::ref(loadJob->nextItem), std::cref(loadJob->onLoaded));
+    }
+}
+
+void PianoEngine::waitForLoading()
+{
+    for (std::thread &thread : loaderThreads) {
+        thread.join();
+    }
+    loaderThreads.clear();
+    loadJob.reset();
+}
+
+void PianoEngine::stopLoading()
+{
+    loadCancelled = true;
+    waitForLoading();
+}
+
+void PianoEngine::loadWorker(const std::vector<LoadItem> &items, std::atomic<std::size_t> &nextItem,
+                             const LoadCallback &onLoaded)
+{
+    for (std::size_t i = nextItem++; i < items.size() && !loadCancelled; i = nextItem++) {
+        const LoadItem &item = items[i];
+        Sample sample;
+        std::string errorMessage;
+        bool ok = false;
+        if (item.slot < 0) {
+            errorMessage = "No sample slot for note " + std::to_string(item.note) + ": " + item.path;
+        } else if ((ok = readSample(item.path, sample, &errorMessage))) {
+            installSample(layout(), item.slot, std::move(sample));  // Playable from here on
+        }
+        if (onLoaded) {
+            onLoaded(item.note, ok, errorMessage);
+        }
+    }
+}
+
+bool PianoEngine::loadSampleBank(const std::string &bankPath, std::string *errorMessage)
+{
+    SampleBank bank;
+    if (!bank.open(bankPath, errorMessage)) {
+        return false;
+    }
+    std::shared_ptr<StreamFile> streamFile;  // Opened on the first streamed entry
+
+    // The bank's index is its sample set: slot i plays entries[order[i]]
+    const std::vector<SampleBankEntry> &entries = bank.entries();
+    std::vector<int> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&entries](int a, int b) {
+        const SampleBankEntry &first = entries[a];
+        const SampleBankEntry &second = entries[b];
+        if (first.note != second.note) {
+            return first.note < second.note;
+        }
+        if (bankVelocity(first) != bankVelocity(second)) {
+            return bankVelocity(first) < bankVelocity(second);
+        }
+        return first.alternate < second.alternate;
+    });
+    std::vector<SampleZone> zones(entries.size());
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        zones[i].note = entries[order[i]].note;
+        zones[i].velocity = bankVelocity(entries[order[i]]);
+        zones[i].alternate = entries[order[i]].alternate;
+    }
+    waitForLoading();
+    stopPager();
+    SampleLayout &current = publishLayout(zones);
+
+    for (int slot : loadOrder(current)) {
+        const SampleBankEntry &entry = entries[order[slot]];
+        Sample sample;
+        bool resident = true;
+        sample.sampleRate = static_cast<int>(entry.sampleRate);
+        sample.channels = static_cast<int>(entry.channels);
+        sample.loopStart = entry.loopStart;
+        sample.loopEnd = entry.loopEnd;
+        if (normalizeSamples && (sample.sampleRate != outputSampleRate || sample.channels != outputChannels)) {
+            WavData wav;
+            wav.samples.assign(bank.pcm(entry), bank.pcm(entry) + entry.length);
+            wav.sampleRate = sample.sampleRate;
+            wav.channels = sample.channels;
+            wav.loopStart = sample.loopStart;
+            wav.loopEnd = sample.loopEnd;
+            convertSampleFormat(wav, outputSampleRate, outputChannels);
+            sample.pcm = std::move(wav.samples);
+            sample.sampleRate = wav.sampleRate;
+            sample.channels = wav.channels;
+            sample.loopStart = wav.loopStart;
+            sample.loopEnd = wav.loopEnd;
+        } else if (shouldStream(sample.sampleRate, sample.channels, entry.length)) {
+            if (!streamFile && !(streamFile = StreamFile::open(bankPath, errorMessage))) {
+                return false;
+            }
+            sample.length = static_cast<int>(entry.length);
+            makeStreamed(sample, bank.pcm(entry), streamFile, entry.offset);
+        } else {
+            sample.mapping = bank.mapping();
+            sample.data = bank.pcm(entry);
+            sample.length = static_cast<int>(entry.length);
+            // Beyond the budget the entry stays mapped but cold: the pager prefetches it on demand
+            resident = memoryBudget == 0 ||
+                residentBytes.load(std::memory_order_relaxed) + sampleMemory(sample) <= memoryBudget;
+            if (resident) {
+                prefetchAttack(*bank.mapping(), entry.offset, sample.sampleRate, sample.channels);
+            }
+        }
+        installSample(current, slot, std::move(sample), resident);
+        current.slots[slot].cold.store(!resident, std::memory_order_relaxed);
+    }
+    if (memoryBudget > 0) {
+        startPager();
+    }
+    return true;
+}
+
+void PianoEngine::setSample(int note, std::vector<std::int16_t> pcm, int sampleRate, int channels,
+                            int loopStart, int loopEnd)
+{
+    Sample sample;
+    sample.pcm = std::move(pcm);
+    sample.sampleRate = sampleRate;
+    sample.channels = channels;
+    sample.loopStart = loopStart;
+    sample.loopEnd = loopEnd;
+    const int slot = primarySlot(note);
+    if (slot >= 0) {
+        installSample(layout(), slot, std::move(sample));
+    }
+}
+
+void PianoEngine::installSample(SampleLayout &layout, int slot, Sample &&sample, bool playable)
+{
+    // Replacing a published sample is setup-only (no rendering), so clearing the
+    // flag first is just for hasSample() callers
+    Slot &target = layout.slots[slot];
+    if (target.ready.exchange(false, std::memory_order_relaxed)) {
+        residentBytes.fetch_sub(sampleMemory(target.sample), std::memory_order_relaxed);
+    }
+    Sample &installed = target.sample;
+    installed = std::move(sample);
+    if (!installed.mapping) {
+        // Owned PCM: the whole sample, or the resident head of a streamed one
+        installed.data = installed.pcm.empty() ? nullptr : installed.pcm.data();
+        installed.resident = static_cast<int>(installed.pcm.size());
+        if (!installed.stream) {
+            installed.length = installed.resident;
+        }
+    } else {
+        installed.resident = installed.length;
+    }
+    prepareResampling(installed, layout.shiftRange);
+    if (!installed.stream) {
+        prepareLoop(installed, installed.data);
+    }
+    if (!playable || !installed.data) {
+        return;
+    }
+    residentBytes.fetch_add(sampleMemory(installed), std::memory_order_relaxed);
+    // Publish: everything written above is visible to whoever sees the flag set
+    target.ready.store(true, std::memory_order_release);
+}
+
+int PianoEngine::firstReadySlot(int note) const
+{
+    if (note < 0 || note >= maxNotes) {
+        return -1;
+    }
+    // A note's slots are contiguous, from its softest layer to its loudest
+    const SampleLayout &current = layout();
+    if (current.layerCount[note] == 0) {
+        return -1;
+    }
+    const SampleLayout::Layer &loudest = current.layers[current.firstLayer[note] + current.layerCount[note] - 1];
+    for (int slot = current.layers[current.firstLayer[note]].first; slot < loudest.first + loudest.count; ++slot) {
+        if (current.slots[slot].ready.load(std::memory_order_acquire)) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+bool PianoEngine::hasSample(int note) const
+{
+    return firstReadySlot(note) >= 0;
+}
+
+int PianoEngine::sampleChannels(int note) const
+{
+    const int slot = firstReadySlot(note);
+    return slot >= 0 ? layout().slots[slot].sample.channels : 0;
+}
+
+int PianoEngine::sampleCount() const
+{
+    const SampleLayout &current = layout();
+    int count = 0;
+    for (int slot = 0; slot < current.slotCount; ++slot) {
+        count += current.slots[slot].ready.load() ? 1 : 0;
+    }
+    return count;
+}
+
+int PianoEngine::pickSample(SampleLayout &layout, int note, float velocity, float &gainScale)
+{
+    // Audio thread: one table lookup for the layer, then the next alternate in turn
+    if (note < 0 || note >= maxNotes) {
+        return -1;
+    }
+    const int velocityIndex = std::clamp(static_cast<int>(velocity * 127.0f + 0.5f), 0, 127);
+    const std::uint16_t layer = layout.velocityLayers[note * 128 + velocityIndex];
+    if (layer == SampleLayout::noLayer) {
+        return -1;
+    }
+    const SampleLayout::Layer &chosen = layout.layers[layer];
+    std::uint32_t &alternate = layout.nextAlternate[layer];
+    const int slot = chosen.first + static_cast<int>(alternate);
+    alternate = alternate + 1 == static_cast<std::uint32_t>(chosen.count) ? 0 : alternate + 1;
+    Slot &target = layout.slots[slot];
+    if (target.ready.load(std::memory_order_acquire)) {
+        gainScale = chosen.gainScale;
+        return slot;
+    }
+
+    // Not in memory: ask the pager for it, and meanwhile play the nearest loaded layer
+    // of the note (louder first - scaling down sounds better than clamping up)
+    if (target.cold.load(std::memory_order_relaxed) && pagerRunning.load(std::memory_order_relaxed) &&
+        !target.requested.exchange(true, std::memory_order_relaxed) && !pageRequests.push(slot)) {
+        target.requested.store(false, std::memory_order_relaxed);  // Queue full: ask again next time
+    }
+    const int firstLayer = layout.firstLayer[note];
+    const int lastLayer = firstLayer + layout.layerCount[note] - 1;
+    for (int distance = 0; distance < layout.layerCount[note]; ++distance) {
+        for (int side = 0; side < (distance == 0 ? 1 : 2); ++side) {
+            const int candidate = side == 0 ? layer + distance : layer - distance;
+            if (candidate < firstLayer || candidate > lastLayer) {
+                continue;
+            }
+            const SampleLayout::Layer &fallback = layout.layers[candidate];
+            for (int other = fallback.first; other < fallback.first + fallback.count; ++other) {
+                if (layout.slots[other].ready.load(std::memory_order_acquire)) {
+                    fallbacks.fetch_add(1, std::memory_order_relaxed);
+                    gainScale = fallback.gainScale;
+                    return other;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+void PianoEngine::startPager()
+{
+    if (pagerThread.joinable()) {
+        return;
+    }
+    int stale;
+    while (pageRequests.pop(stale)) {
+        // Requests for a previous set (nobody consumes while the pager is stopped)
+    }
+    pagerRunning.store(true, std::memory_order_release);
+    pagerThread = std::thread(&PianoEngine::pagerLoop, this);
+}
+
+void PianoEngine::stopPager()
+{
+    pagerRunning.store(false, std::memory_order_release);
+    if (pagerThread.joinable()) {
+        pagerThread.join();
+    }
+}
+
+void PianoEngine::pagerLoop()
+{
+    while (pagerRunning.load(std::memory_order_acquire)) {
+        int slot;
+        if (!pageRequests.pop(slot)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        SampleLayout &current = layout();
+        if (slot < current.slotCount) {
+            pageIn(current, slot);
+        }
+    }
+}
+
+void PianoEngine::pageIn(SampleLayout &layout, int slot)
+{
+    Slot &target = layout.slots[slot];
+    if (target.cold.load(std::memory_order_acquire) && !target.ready.load(std::memory_order_relaxed)) {
+        Sample &sample = target.sample;
+        if (sample.mapping) {
+            // Dropped earlier (or a bank entry beyond the budget): the mapping is still there,
+            // only the attack has to be read back in
+            const std::size_t offset = reinterpret_cast<const unsigned char *>(sample.data) - sample.mapping->data();
+            prefetchAttack(*sample.mapping, offset, sample.sampleRate, sample.channels);
+            residentBytes.fetch_add(sampleMemory(sample) - loopMemory(sample), std::memory_order_relaxed);
+            target.cold.store(false, std::memory_order_relaxed);
+            target.ready.store(true, std::memory_order_release);
+        } else {
+            // Never loaded; a file that fails stays silent instead of being retried on every note-on
+            Sample loaded;
+            target.cold.store(false, std::memory_order_relaxed);
+            if (!target.path.empty() && readSample(target.path, loaded, nullptr)) {
+                installSample(layout, slot, std::move(loaded));
+            }
+        }
+    }
+    target.requested.store(false, std::memory_order_relaxed);
+    trimToBudget(layout, slot);
+}
+
+void PianoEngine::trimToBudget(SampleLayout &layout, int keep)
+{
+    while (residentBytes.load(std::memory_order_relaxed) > memoryBudget) {
+        // Least recently started mapped sample that no voice is playing. Owned PCM is never
+        // freed here - a voice could be reading it - and neither is a note's first alternate
+        // of its loudest layer, the stand-in while any other layer is paged in.
+        int victim = -1;
+        for (int slot = 0; slot < layout.slotCount; ++slot) {
+            const Slot &candidate = layout.slots[slot];
+            if (slot == keep || slot == primarySlot(candidate.note) || !candidate.sample.mapping ||
+                candidate.sample.stream || !candidate.ready.load(std::memory_order_relaxed) ||
+                candidate.playing.load(std::memory_order_relaxed) > 0) {
+                continue;
+            }
+            if (victim < 0 || candidate.lastUsed.load(std::memory_order_relaxed) <
+                                  layout.slots[victim].lastUsed.load(std::memory_order_relaxed)) {
+                victim = slot;
+            }
+        }
+        if (victim < 0) {
+            return;
+        }
+
+        // New note-ons stop picking it first. The pages go, the mapping (and the loop copy) stays:
+        // a voice that started in between still reads valid data, at worst faulting a page back in.
+        Slot &evicted = layout.slots[victim];
+        evicted.cold.store(true, std::memory_order_relaxed);
+        evicted.ready.store(false, std::memory_order_release);
+        const Sample &sample = evicted.sample;
+        sample.mapping->dontNeed(reinterpret_cast<const unsigned char *>(sample.data) - sample.mapping->data(),
+                                 static_cast<std::size_t>(sample.length) * sizeof(std::int16_t));
+        residentBytes.fetch_sub(sampleMemory(sample) - loopMemory(sample), std::memory_order_relaxed);
+    }
+}
+
+bool PianoEngine::pushEvent(NoteEvent::Type type, int note, float value, std::uint64_t timestamp,
+                            EventSource source)
+{
+    NoteEvent event;
+    event.type = type;
+    event.note = note;
+    event.value = value;
+    event.timestamp = timestamp != 0 ? timestamp : NoteEvent::now();
+    return noteEvents[static_cast<int>(source)].push(event);
+}
+
+NoteEventQueue *PianoEngine::earliestQueue()
+{
+    // The queue whose next event is the earliest of all (each queue is in time order)
+    NoteEventQueue *earliest = nullptr;
+    std::uint64_t earliestTime = 0;
+    for (NoteEventQueue &queue : noteEvents) {
+        const NoteEvent *next = queue.front();
+        if (next && (!earliest || next->timestamp < earliestTime)) {
+            earliest = &queue;
+            earliestTime = next->timestamp;
+        }
+    }
+    return earliest;
+}
+
+bool PianoEngine::popEvent(NoteEvent &event)
+{
+    NoteEventQueue *earliest = earliestQueue();
+    return earliest && earliest->pop(event);
+}
+
+bool PianoEngine::noteOn(int note, float velocity, std::uint64_t timestamp, EventSource source)
+{
+    return pushEvent(NoteEvent::NoteOn, note, velocity, timestamp, source);
+}
+
+bool PianoEngine::noteOff(int note, std::uint64_t timestamp, EventSource source)
+{
+    return pushEvent(NoteEvent::NoteOff, note, 0.0f, timestamp, source);
+}
+
+bool PianoEngine::setDamperPedal(float position, std::uint64_t timestamp, EventSource source)
+{
+    return pushEvent(NoteEvent::DamperPedal, -1, std::clamp(position, 0.0f, 1.0f), timestamp, source);
+}
+
+bool PianoEngine::setUnaCorda(float position, std::uint64_t timestamp, EventSource source)
+{
+    return pushEvent(NoteEvent::UnaCorda, -1, std::clamp(position, 0.0f, 1.0f), timestamp, source);
+}
+
+bool PianoEngine::allSoundOff(std::uint64_t timestamp, EventSource source)
+{
+    return pushEvent(NoteEvent::AllSoundOff, -1, 0.0f, timestamp, source);
+}
+
+void PianoEngine::reset()
+{
+    renderPool.wait();  // Any group still being mixed by a worker
+    NoteEvent event;
+    while (popEvent(event)) {
+        // Discard
+    }
+    for (int i = 0; i < voices.size(); ++i) {
+        std::atomic<int> &playing = activeLayout->slots[voices.sample[i]].playing;
+        playing.store(playing.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+    voices.clear();  // Keeps the preallocated storage
+    streamer.closeAll();
+    activeLayout = currentLayout.load(std::memory_order_acquire);
+    limiter.reset();
+    resonanceBank.reset();
+    damperPosition = 0.0f;
+    unaCordaPosition = 0.0f;
+    unaCordaLevel = 0.0f;
+    publishedDamper.store(0.0f, std::memory_order_relaxed);
+    publishedUnaCorda.store(0.0f, std::memory_order_relaxed);
+    unaCordaFilter.reset();
+    unaCordaVoiceFilter.reset();
+}
+
+void PianoEngine::beginBuffer(int frames, std::uint64_t time)
+{
+    const std::uint64_t duration = static_cast<std::uint64_t>(frames) * 1000000000ull / outputSampleRate;
+    if (time != 0) {
+        bufferTime = time;
+        bufferEnd = time + duration;
+    } else {
+        // Real time: the buffer stands for the period that just went by, and takes everything
+        // queued up to now (an event stamped now lands on the last frame)
+        bufferEnd = NoteEvent::now() + 1;
+        bufferTime = bufferEnd - std::min(duration, bufferEnd);
+    }
+    bufferFrame = 0;
+}
+
+int PianoEngine::applyEvents(int frames)
+{
+    // Runs on the audio thread: no locks, no allocations (the voice pool is preallocated)
+
+    // A new sample set replaces the instrument: the old one's voices are cut
+    SampleLayout *latest = currentLayout.load(std::memory_order_acquire);
+    if (latest != activeLayout) {
+        for (int i = voices.size() - 1; i >= 0; --i) {
+            retireVoice(i);
+        }
+        activeLayout = latest;
+    }
+
+    // Everything due by this block's first frame; the block is cut short where the next
+    // event is due, so that one starts the following block on its own frame
+    const std::uint64_t lastFrame = static_cast<std::uint64_t>(bufferFrame + frames - 1);
+    while (NoteEventQueue *queue = earliestQueue()) {
+        const std::uint64_t timestamp = queue->front()->timestamp;
+        if (timestamp >= bufferEnd) {
+            break;  // Belongs to a later buffer
+        }
+        // Its frame in the buffer (the one it falls within); late events go first
+        const std::uint64_t offset = timestamp > bufferTime ? timestamp - bufferTime : 0;
+        const std::uint64_t frame = offset * outputSampleRate / 1000000000ull;
+        if (frame > static_cast<std::uint64_t>(bufferFrame)) {
+            if (frame <= lastFrame) {
+                frames = static_cast<int>(frame) - bufferFrame;
+            }
+            break;
+        }
+        NoteEvent event;
+        queue->pop(event);
+        applyEvent(event);
+    }
+    publishedDamper.store(damperPosition, std::memory_order_relaxed);
+    publishedUnaCorda.store(unaCordaPosition, std::memory_order_relaxed);
+    return frames;
+}
+
+void PianoEngine::applyEvent(const NoteEvent &event)
+{
+    switch (event.type) {
+    case NoteEvent::NoteOn: {
+        // Velocity layer and round-robin alternate (or the nearest loaded stand-in)
+        float gainScale = 1.0f;
+        const int slot = pickSample(*activeLayout, event.note, event.value, gainScale);
+        if (slot < 0) {
+            break;  // Not loaded (yet)
+        }
+        // Steals a voice (per the steal policy) if the pool is full
+        const bool stealing = voices.size() == voices.capacity();
+        const int v = voices.allocate();
+        if (stealing) {
+            releaseVoice(v);
+        }
+        Slot &target = activeLayout->slots[slot];
+        target.playing.store(target.playing.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        target.lastUsed.store(++noteOnSerial, std::memory_order_relaxed);
+        const Sample &sample = target.sample;
+        const int shift = maxPitchShift + activeLayout->pitchShift[event.note];
+        voices.step[v] = sample.resampleSteps[shift];
+        voices.sincTable[v] = sample.resampleTables[shift];
+        voices.data[v] = sample.data;
+        voices.position[v] = 0;
+        voices.fraction[v] = 0;
+        voices.length[v] = sample.length;
+        voices.resident[v] = sample.resident;
+        voices.stream[v] = -1;
+        if (sample.stream) {
+            // Streams start where the resident head ends; without a free stream
+            // (or when resampling) the voice plays just the head
+            if (voices.step[v] == unityStep && sample.channels == outputChannels) {
+                voices.stream[v] = streamer.open(sample.stream.get(), sample.resident);
+            }
+            if (voices.stream[v] < 0) {
+                voices.length[v] = sample.resident;
+            }
+        }
+        voices.channels[v] = sample.channels;
+        voices.loop[v] = sample.loop.get();
+        voices.looping[v] = false;
+        envelope.start(voices.envelopeStage[v], voices.envelopeLevel[v]);
+        voices.keyDown[v] = true;
+        voices.framesPlayed[v] = 0;  // Initialize frames played counter
+        // Velocity as linear gain within the layer (1.0 = unity, which mixes without a multiply)
+        voices.gain[v] = std::clamp(event.value * gainScale, 0.0f, mixUnityGain);
+        voices.note[v] = static_cast<std::int16_t>(event.note);
+        voices.sample[v] = slot;
+        voices.unaCorda[v] = perVoiceUnaCorda.load(std::memory_order_relaxed) &&
+                             unaCordaPosition >= unaCordaShiftPosition;
+        break;
+    }
+    case NoteEvent::NoteOff:
+        // Let go of the key: the voices of the note go into release from this frame on,
+        // unless the damper holds them
+        for (int i = 0; i < voices.size(); ++i) {
+            if (voices.note[i] == event.note) {
+                voices.keyDown[i] = false;
+            }
+        }
+        break;
+    case NoteEvent::DamperPedal:
+        damperPosition = event.value;
+        break;
+    case NoteEvent::UnaCorda:
+        unaCordaPosition = event.value;
+        break;
+    case NoteEvent::AllSoundOff:
+        // Cut, the way a new sample set cuts the old one's voices: no release to fade through
+        for (int i = voices.size() - 1; i >= 0; --i) {
+            retireVoice(i);
+        }
+        resonanceBank.reset();
+        break;
+    }
+}
+
+void PianoEngine::render(std::int16_t *out, int frames, std::uint64_t time)
+{
+    // Split requests larger than the pre-allocated buffers instead of resizing them, and
+    // wherever an event is due
+    beginBuffer(frames, time);
+    while (frames > 0) {
+        const int blockFrames = renderBlock(std::min(frames, maxFrames));
+        writeOutput(out, blockFrames);
+        out += static_cast<size_t>(blockFrames) * outputChannels;
+        frames -= blockFrames;
+    }
+}
+
+void PianoEngine::render(float *out, int frames, std::uint64_t time)
+{
+    beginBuffer(frames, time);
+    while (frames > 0) {
+        const int blockFrames = renderBlock(std::min(frames, maxFrames));
+        writeOutput(out, blockFrames);
+        out += static_cast<size_t>(blockFrames) * outputChannels;
+        frames -= blockFrames;
+    }
+}
+
+int PianoEngine::renderBlock(int frames)
+{
+    if (!renderPool.idle()) {
+        // A worker is still mixing a group the last block went on without, and owns its
+        // voices: the voices, and the events that would change them, wait for it, and the
+        // bus effects run on silence meanwhile
+        parallelMisses.fetch_add(1, std::memory_order_relaxed);
+        std::fill(mixBuffer.begin(), mixBuffer.begin() + static_cast<std::ptrdiff_t>(frames) * outputChannels, 0.0f);
+        unaCordaWritten = false;
+    } else {
+        // Voices left to retire by a block that went on without a worker
+        retireEndedVoices();
+        // First, apply the queued events that are due (lock-free); the block may end early, at
+        // the next one
+        frames = applyEvents(frames);
+        mixActiveNotes(frames);
+    }
+    applyUnaCordaVoices(frames);
+    applyResonance(frames);
+    applyUnaCorda(frames);
+    applyMasterBus(frames);
+    bufferFrame += frames;
+    return frames;
+}
+
+void PianoEngine::mixActiveNotes(int frames)
+{
+    const int voiceCount = voices.size();
+    const float contact = damperContact();
+    float *mix = mixBuffer.data();
+    const int totalSamples = frames * outputChannels;
+
+    if (renderPool.threadCount() > 0 && voiceCount > voicesPerTask) {
+        // Parallel: each group of voices into its own buffer, on whichever thread claims it,
+        // then the groups summed in order - the same output whoever mixed what
+        const int tasks = (voiceCount + voicesPerTask - 1) / voicesPerTask;
+        // A member, not a local: a group left running on a worker still reads it
+        mixJob = {this, frames, contact};
+        bool complete = true;
+        if (parallelBackoff > 0) {
+            // Recently missed the deadline: the audio thread mixes every group itself
+            parallelBackoff -= frames;
+            parallelSerialBlocks.fetch_add(1, std::memory_order_relaxed);
+            for (int task = 0; task < tasks; ++task) {
+                mixTask(&mixJob, task);
+                taskDone[task] = true;
+            }
+        } else {
+            // The wait for groups still on workers is cut off at the deadline: the groups not
+            // done by then are left out of this block (their voices owned by the worker until
+            // it is through) rather than holding up the device
+            const std::uint64_t waited = renderPool.run(&PianoEngine::mixTask, &mixJob, tasks, parallelDeadlineNs);
+            for (int task = 0; task < tasks; ++task) {
+                taskDone[task] = renderPool.finished(task);
+                complete = complete && taskDone[task];
+            }
+            if (!complete || waited > parallelDeadlineNs) {
+                parallelMisses.fetch_add(1, std::memory_order_relaxed);
+                parallelBackoff = parallelBackoffFrames;
+            }
+        }
+
+        // Returns whether any group wrote to its buffer
+        auto sumTasks = [&](const std::vector<float> &buffers, const std::vector<std::uint8_t> &written,
+                            float *target) {
+            bool any = false;
+            for (int task = 0; task < tasks; ++task) {
+                if (!taskDone[task] || !written[task]) {
+                    continue;
+                }
+                const float *partial = buffers.data() + static_cast<std::size_t>(task) * maxFrames * outputChannels;
+                if (!any) {
+                    std::copy(partial, partial + totalSamples, target);
+                    any = true;
+                } else {
+                    for (int i = 0; i < totalSamples; ++i) {
+                        target[i] += partial[i];
+                    }
+                }
+            }
+            return any;
+        };
+        if (!sumTasks(taskBuffers, taskWritten, mix)) {
+            std::fill(mix, mix + totalSamples, 0.0f);  // No voice wrote anything this block
+        }
+        unaCordaWritten = sumTasks(taskUnaCordaBuffers, taskUnaCordaWritten, unaCordaBuffer.data());
+        if (!complete) {
+            return;  // Retiring moves voices around: it waits until the worker is through
+        }
+    } else if (!mixVoices(0, voiceCount, mix, unaCordaBuffer.data(), frames, contact, unaCordaWritten)) {
+        std::fill(mix, mix + totalSamples, 0.0f);  // No voice wrote anything this block
+    }
+    retireEndedVoices();
+}
+
+void PianoEngine::retireEndedVoices()
+{
+    // Retire the voices that ended, walking downwards: retire() moves the last voice
+    // into slot i, and that one has already been checked
+    for (int i = voices.size() - 1; i >= 0; --i) {
+        if (voiceEnded[i]) {
+            voiceEnded[i] = false;
+            retireVoice(i);
+        }
+    }
+}
+
+void PianoEngine::mixTask(void *context, int task)
+{
+    const MixJob &job = *static_cast<const MixJob *>(context);
+    PianoEngine &engine = *job.engine;
+    const int first = task * voicesPerTask;
+    const int last = std::min(engine.voices.size(), first + voicesPerTask);
+    const std::size_t offset = static_cast<std::size_t>(task) * engine.maxFrames * engine.outputChannels;
+    bool unaCordaWritten = false;
+    engine.taskWritten[task] = engine.mixVoices(first, last, engine.taskBuffers.data() + offset,
+                                                engine.taskUnaCordaBuffers.data() + offset, job.frames,
+                                                job.damperContact, unaCordaWritten);
+    engine.taskUnaCordaWritten[task] = unaCordaWritten;
+}
+
+bool PianoEngine::mixVoices(int first, int last, float *mix, float *unaCordaMix, int frames, float damperContact,
+                            bool &unaCordaWritten)
+{
+    const int samplesPerFrame = outputChannels;
+    const int framesPerBuffer = frames;
+    const int totalSamples = framesPerBuffer * samplesPerFrame;
+
+    // The mix bus (float, so chords have headroom instead of clipping) is cleared lazily:
+    // the first direct-mix voice overwrites it instead of adding to zeros. Voices struck
+    // with the una corda (per-voice una corda) go to a bus of their own, cleared the same way.
+    struct Bus {
+        float *data;
+        bool cleared;
+    };
+    Bus dryBus = {mix, false};
+    Bus unaCordaBus = {unaCordaMix, false};
+    Bus *bus = &dryBus;
+    auto clearMix = [&]() {
+        if (!bus->cleared) {
+            std::fill(bus->data, bus->data + totalSamples, 0.0f);
+            bus->cleared = true;
+        }
+    };
+
+    // Direct sample playback of count samples into the mix at offset (SIMD kernels), the gain
+    // ramping by gainStep per frame (0 while the envelope holds still)
+    auto mixDirect = [&](int offset, const std::int16_t *src, int count, float gain, float gainStep) {
+        if (count <= 0) {
+            return;
+        }
+        if (gainStep != 0.0f) {
+            clearMix();
+            kernels.accumulateRamp(bus->data + offset, src, count, samplesPerFrame, gain, gainStep);
+        } else if (gain == mixUnityGain) {
+            if (!bus->cleared && offset == 0) {
+                kernels.store(bus->data, src, count, totalSamples);  // Clear and accumulate in one pass
+                bus->cleared = true;
+            } else {
+                clearMix();
+                kernels.accumulate(bus->data + offset, src, count);
+            }
+        } else {
+            clearMix();
+            kernels.accumulateGain(bus->data + offset, src, count, gain);
+        }
+    };
+
+    // Voice i: count frames into the mix at frame `at`, the gain ramping from gain by gainStep
+    // per frame. Plays the sample (resident head, disk stream, or through the resampler); a
+    // voice that isn't being released moves into its loop at the entry and from then on wraps
+    // at the end of the loop body, through the same kernels. Returns false once the sample
+    // has played to its end.
+    auto mixSource = [&](int i, int at, int count, float gain, float gainStep) {
+        const int channels = voices.channels[i];
+        const bool direct = voices.step[i] == unityStep && channels == samplesPerFrame;
+        int &position = voices.position[i];
+        while (count > 0) {
+            int segment = count;
+            if (voices.looping[i]) {
+                const SampleLoop &loop = *voices.loop[i];
+                const int wrap = SampleLoop::guardFrames + loop.loopFrames;
+                int frame = position / channels;
+                while (frame >= wrap) {
+                    frame -= loop.loopFrames;
+                }
+                segment = framesUntil(frame, voices.fraction[i], wrap, voices.step[i], count);
+                if (direct) {
+                    mixDirect(at * samplesPerFrame, loop.pcm.data() + frame * channels, segment * channels, gain,
+                              gainStep);
+                    frame += segment;
+                } else {
+                    clearMix();
+                    resampleMix(resamplerQuality, voices.sincTable[i], bus->data + at * samplesPerFrame, samplesPerFrame,
+                                segment, loop.pcm.data(), wrap + SampleLoop::guardFrames, channels, frame,
+                                voices.fraction[i], voices.step[i], gain, gainStep);
+                }
+                position = frame * channels;
+            } else {
+                const int length = voices.length[i];
+                if (position >= length) {
+                    return false;
+                }
+                const SampleLoop *loop = voices.loop[i];
+                const bool entering = loop && voices.envelopeStage[i] < Envelope::Release &&
+                                      position / channels < loop->entryFrame;
+                if (entering) {
+                    segment = framesUntil(position / channels, voices.fraction[i], loop->entryFrame,
+                                          voices.step[i], count);
+                }
+
+                if (direct) {
+                    // Same sample rate and channels, no pitch shift: straight from the data (SIMD kernels)
+                    const int samplesToMix = std::min(length - position, segment * channels);
+                    int mixed = 0;
+                    if (position < voices.resident[i]) {
+                        mixed = std::min(samplesToMix, voices.resident[i] - position);
+                        mixDirect(at * samplesPerFrame, voices.data[i] + position, mixed, gain, gainStep);
+                    }
+                    const int stream = voices.stream[i];
+                    if (mixed < samplesToMix && stream >= 0) {
+                        // Past the resident head: read from this voice's disk stream
+                        const std::int16_t *first;
+                        const std::int16_t *second;
+                        int firstCount;
+                        const int available = streamer.peek(stream, samplesToMix - mixed, first, firstCount, second);
+                        const int offset = at * samplesPerFrame + mixed;
+                        mixDirect(offset, first, firstCount, gain + gainStep * (mixed / channels), gainStep);
+                        mixDirect(offset + firstCount, second, available - firstCount,
+                                  gain + gainStep * ((mixed + firstCount) / channels), gainStep);
+                        streamer.consume(stream, available);
+                        if (available < samplesToMix - mixed) {
+                            streamer.countUnderrun();  // The voice stalls until the reader catches up
+                        }
+                        mixed += available;
+                    }
+                    position += mixed;
+                } else {
+                    // Sample rate conversion or pitch shift: fixed-point read position, interpolation per quality tier
+                    clearMix();
+                    int frame = position / channels;
+                    resampleMix(resamplerQuality, voices.sincTable[i], bus->data + at * samplesPerFrame, samplesPerFrame,
+                                segment, voices.data[i], length / channels, channels, frame, voices.fraction[i],
+                                voices.step[i], gain, gainStep);
+                    position = frame * channels;
+                }
+
+                if (entering && position / channels >= loop->entryFrame) {
+                    // Into the loop buffer (the audio is the same up to here), carrying over any
+                    // resampler overshoot. With no natural decay left, the envelope fades it out.
+                    if (voices.stream[i] >= 0) {
+                        streamer.close(voices.stream[i]);
+                        voices.stream[i] = -1;
+                    }
+                    voices.data[i] = loop->pcm.data();
+                    position = (loop->entryPosition + position / channels - loop->entryFrame) * channels;
+                    voices.looping[i] = true;
+                    if (voices.envelopeStage[i] < Envelope::LoopFade) {
+                        Envelope::fade(voices.envelopeStage[i]);
+                    }
+                }
+            }
+            at += segment;
+            count -= segment;
+            gain += gainStep * segment;
+        }
+        return true;
+    };
+
+    // Ended voices are only flagged here (retiring moves voices around, and other threads
+    // may be mixing the neighbouring groups); mixActiveNotes retires them afterwards
+    for (int i = last - 1; i >= first; --i) {
+        Envelope::Stage &stage = voices.envelopeStage[i];
+        float &level = voices.envelopeLevel[i];
+        std::uint8_t &keyDown = voices.keyDown[i];
+        int &framesPlayed = voices.framesPlayed[i];
+        const float gain = voices.gain[i];
+        // How fast the damper silences the string once the key is up (0: not at all)
+        const float releaseSpeed = dampingSpeed[voices.note[i]] * damperContact;
+        bus = voices.unaCorda[i] ? &unaCordaBus : &dryBus;
+
+        // The block in pieces of constant or linearly ramping gain: all of it while the
+        // envelope holds still, up to the next bend (a sub-block boundary) while it moves
+        bool sounding = true;
+        for (int done = 0; done < framesPerBuffer && sounding;) {
+            // Reaching the cutoff counts as letting go of the key; with a damper on the string,
+            // the voice is released
+            if (keyDown && framesPlayed >= cutoffFrames) {
+                keyDown = false;
+            }
+            if (!keyDown && releaseSpeed > 0.0f && stage < Envelope::Release) {
+                Envelope::release(stage);
+            }
+
+            int count = framesPerBuffer - done;
+            if (!Envelope::steady(stage, releaseSpeed)) {
+                count = std::min(count, envelope.rampFrames(stage, level, releaseSpeed));
+            }
+            if (keyDown && releaseSpeed > 0.0f) {
+                count = std::min(count, cutoffFrames - framesPlayed);  // The release starts right at the cutoff
+            }
+            const float from = level;
+            const float to = envelope.advance(stage, level, count, releaseSpeed);
+            sounding = mixSource(i, done, count, gain * from, gain * (to - from) / count) &&
+                       stage != Envelope::Done;
+            framesPlayed += count;
+            done += count;
+        }
+        voiceEnded[i] = !sounding;
+    }
+    unaCordaWritten = unaCordaBus.cleared;
+    return dryBus.cleared;
+}
+
+void PianoEngine::releaseVoice(int i)
+{
+    if (voices.stream[i] >= 0) {
+        streamer.close(voices.stream[i]);
+        voices.stream[i] = -1;
+    }
+    std::atomic<int> &playing = activeLayout->slots[voices.sample[i]].playing;
+    playing.store(playing.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+void PianoEngine::retireVoice(int i)
+{
+    releaseVoice(i);
+    voices.retire(i);
+}
+
+float PianoEngine::damperContact() const
+{
+    // 1 = dampers resting on the strings (pedal up) .. 0 = lifted clear of them
+    return std::clamp((damperLiftEnd - damperPosition) / (damperLiftEnd - damperLiftStart), 0.0f, 1.0f);
+}
+
+void PianoEngine::applyResonance(int frames)
+{
+    // The bank's block-rate inputs: the notes sounding (their strings aren't driven by the mix)
+    // and how far each damper is off its string. One pass over the voices, whatever they do.
+    const float lifted = 1.0f - damperContact();
+    for (int note = 0; note < maxNotes; ++note) {
+        stringOpen[note] = note < undampedNote ? lifted : 1.0f;
+    }
+    noteSounding.fill(0);
+    for (int i = 0; i < voices.size(); ++i) {
+        noteSounding[voices.note[i]] = 1;
+    }
+    resonanceBank.process(mixBuffer.data(), frames, stringOpen.data(), noteSounding.data(),
+                          resonanceLevel.load(std::memory_order_relaxed));
+}
+
+void PianoEngine::applyUnaCordaVoices(int frames)
+{
+    // The voices struck with the una corda, muted on their own bus and then mixed in - ahead
+    // of the resonance, so they excite the free strings like the rest
+    float *soft = unaCordaBuffer.data();
+    if (!unaCordaVoiceFilter.processWet(soft, frames, unaCordaWritten)) {
+        return;  // None playing, and the filter's tail has died away
+    }
+    float *mix = mixBuffer.data();
+    const int totalSamples = frames * outputChannels;
+    for (int i = 0; i < totalSamples; ++i) {
+        mix[i] += soft[i];
+    }
+}
+
+void PianoEngine::applyUnaCorda(int frames)
+{
+    // The pedal's amount moves from where the last block left it to the current position
+    // over this block, so pressing it (or easing it part way) doesn't click. Per voice, the
+    // notes struck with it have been muted already and the bus stays dry.
+    const double startLevel = unaCordaLevel;
+    const double endLevel = perVoiceUnaCorda.load(std::memory_order_relaxed) ? 0.0 : unaCordaPosition;
+    unaCordaLevel = static_cast<float>(endLevel);
+    unaCordaFilter.process(mixBuffer.data(), frames, startLevel, endLevel);
+}
+
+void PianoEngine::applyMasterBus(int frames)
+{
+    float *mix = mixBuffer.data();
+    const int totalSamples = frames * outputChannels;
+    const float gain = masterBusGain.load(std::memory_order_relaxed);
+
+    // Master gain and limiting in one pass over the bus
+    if (limitOutput) {
+        limiter.process(mix, frames, gain);
+    } else if (gain != 1.0f) {
+        for (int i = 0; i < totalSamples; ++i) {
+            mix[i] *= gain;
+        }
+    }
+}
+
+void PianoEngine::writeOutput(std::int16_t *out, int frames)
+{
+    // Round and clip to 16 bits (SIMD kernel); only reached by peaks when the limiter is off
+    kernels.saturate(out, mixBuffer.data(), frames * outputChannels);
+}
+
+void PianoEngine::writeOutput(float *out, int frames)
+{
+    const float *mix = mixBuffer.data();
+    const int totalSamples = frames * outputChannels;
+    const float scale = 1.0f / 32768.0f;
+    for (int i = 0; i < totalSamples; ++i) {
+        out[i] = std::clamp(mix[i], -32768.0f, 32767.0f) * scale;
+    }
+}
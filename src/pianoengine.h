@@ -0,0 +1,490 @@
+#ifndef PIANOENGINE_H
+#define PIANOENGINE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "diskstreamer.h"
+#include "envelope.h"
+#include "limiter.h"
+#include "mappedfile.h"
+#include "noteeventqueue.h"
+#include "renderpool.h"
+#include "resampler.h"
+#include "resonancebank.h"
+#include "samplecache.h"
+#include "sampleloop.h"
+#include "sampleset.h"
+#include "unacordafilter.h"
+#include "voicepool.h"
+
+struct MixKernels;
+
+// Platform-independent piano sound engine: sample storage, voice mixing, voice
+// envelopes (attack/decay/sustain/release, driven by keys, the damper pedal and the
+// 1-second cutoff), sympathetic string resonance, the una corda filter and the master
+// bus (float mix, master gain, lookahead limiter). No Qt, no Core Audio -
+// the GUI drives it from the device callback, tools drive it offline.
+//
+// Threading: noteOn/noteOff/setDamperPedal/setUnaCorda/allSoundOff are called from
+// one producer thread per event source (the UI, a MIDI input), render() from one consumer
+// thread (audio); they meet only in the lock-free event queues, so nothing the UI or
+// a MIDI driver does can hold up a block. The output
+// format must be set up before rendering starts. Samples are either loaded up
+// front, or by loadSamplesAsync() while rendering: each note is published
+// atomically once decoded, and note-ons for notes not yet published are ignored.
+//
+// Samples live in slots of a sample set (velocity layers and round-robin
+// alternates per note, see sampleset.h). Without one, every note has a single
+// slot that plays at all velocities.
+class PianoEngine {
+public:
+    static const int maxNotes = 128;  // MIDI note range
+    static const int defaultMaxPolyphony = 256;
+    static const int defaultPrefetchMs = 1000;  // Covers the 1-second cutoff
+    static const int defaultNoteCutoffMs = 1000;
+    static const int defaultPreloadMs = 500;  // Resident head of streamed samples
+    static const int maxPitchShift = 6;  // Semitones a note may borrow another note's samples across
+    static const int voicesPerTask = 16;  // Voices per group in parallel rendering
+    static const int defaultParallelDeadlineUs = 1000;
+    static const int parallelBackoffMs = 100;  // Audio thread alone after a missed deadline
+
+    explicit PianoEngine(int sampleRate = 44100, int channels = 2, int maxFramesPerRender = 512);
+    ~PianoEngine();
+
+    PianoEngine(const PianoEngine &) = delete;
+    PianoEngine &operator=(const PianoEngine &) = delete;
+
+    // Setup (not real-time safe, call before rendering starts)
+    // maxFramesPerRender: the largest request render() is expected to get (0 keeps the current
+    // size, 512 by default); every buffer is preallocated for it, and larger requests are split
+    void setOutputFormat(int sampleRate, int channels, int maxFramesPerRender = 0);
+    void setMaxPolyphony(int maxVoices);
+    void setVoiceStealPolicy(VoicePool::StealPolicy policy);
+    // A key counts as released this long after its note-on if no note-off came first (default:
+    // 1000 ms; the keyboard UI never sends note-offs); 0 = only a note-off releases it
+    void setNoteCutoff(int milliseconds);
+    // Voice envelope (see envelope.h). Released voices - key up and damper down on the string -
+    // fade out over their note's damping time (the release time at middle C, longer in the
+    // bass, shorter in the treble; see noteDampingMs) instead of being cut; voices sustained
+    // through a sample loop fade over loopFadeMs. The default adds no attack or decay, so
+    // notes start exactly as recorded.
+    void setEnvelope(const EnvelopeSettings &settings);
+    // Time a damper takes to silence a string of note at the current release time; 0 for the
+    // undamped strings at the top
+    double noteDampingMs(int note) const;
+    // Level of the sympathetic resonance of free strings (see resonancebank.h; default:
+    // ResonanceBank::defaultLevel, 0 = off). Any thread; applies from the next rendered block.
+    void setResonance(float level);
+    float resonance() const { return resonanceLevel.load(std::memory_order_relaxed); }
+    // Where the una corda mutes (see unacordafilter.h). Off (default): the whole mix bus,
+    // following the pedal as it moves. On: each note struck with the pedal at least
+    // unaCordaShiftPosition down plays muted for as long as it sounds, whatever the pedal does
+    // afterwards, and notes struck without it stay bright - as the shifted action of a real
+    // una corda behaves. Any thread; applies to notes struck from the next rendered block.
+    void setUnaCordaPerVoice(bool enabled);
+    bool unaCordaPerVoice() const { return perVoiceUnaCorda.load(std::memory_order_relaxed); }
+    static constexpr float unaCordaShiftPosition = 0.5f;
+    const EnvelopeSettings &envelopeSettings() const { return envelope.settings(); }
+    // Interpolation used for samples whose rate differs from the output (default: Cubic)
+    void setResampleQuality(ResampleQuality quality);
+    ResampleQuality resampleQuality() const { return resamplerQuality; }
+    // When enabled, loaded samples are converted to the current output format (set it first),
+    // so every voice takes the direct-mix path. Converted PCM is cached in cacheDirectory
+    // (keyed by file contents and target format) when it is not empty.
+    void setSampleNormalization(bool enabled, const std::string &cacheDirectory = std::string());
+    const SampleCache &normalizationCache() const { return sampleCache; }
+    // When enabled (the default), WAV files already in a playable format are memory-mapped and
+    // played straight from the mapping instead of being copied to the heap. The first
+    // prefetchMs of each sample (the attack) is read in at load time so note-ons don't
+    // fault on disk; the rest is paged in on first use.
+    void setMemoryMapping(bool enabled, int prefetchMs = defaultPrefetchMs);
+    // When enabled, samples loaded afterwards that are already in the output format keep
+    // only their first preloadMs in memory; the rest is read from disk by a background
+    // thread into per-voice ring buffers. At most maxStreams voices stream at once - a
+    // note-on beyond that plays only the resident part.
+    void setStreaming(bool enabled, int preloadMs = defaultPreloadMs,
+                      int maxStreams = DiskStreamer::defaultStreams);
+    // Parallel voice rendering (default: 0 = off): the voices of a block are mixed in groups of
+    // voicesPerTask, each into its own buffer, by the audio thread and `threads` pre-spawned
+    // worker threads - whoever is free takes the next group - and the groups are summed in
+    // order, so the output is the same for any thread count and timing (though not bit-equal
+    // to serial mixing, which sums in a different order). The audio thread never waits for a
+    // worker to start, only for groups already being mixed, and no longer than deadlineUs: a
+    // group that isn't done by then (its worker preempted) is left out of the block, and its
+    // voices are held - silent, their events waiting - until the worker is through. After a
+    // miss the blocks of the next parallelBackoffMs are mixed on the audio thread alone. Worth it
+    // once voices are expensive (resampling, pitch shift) and there are more than a few dozen.
+    void setParallelRendering(int threads, int deadlineUs = defaultParallelDeadlineUs);
+    int parallelThreads() const { return renderPool.threadCount(); }
+    // Workers that got real-time scheduling (any thread)
+    int parallelRealtimeThreads() const { return renderPool.realtimeThreadCount(); }
+    // Blocks whose wait for the workers reached the deadline (or that were rendered without
+    // voices because a worker still held some), blocks mixed on the audio thread
+    // alone because of that, and groups mixed by workers (any thread)
+    std::uint64_t parallelDeadlineMisses() const { return parallelMisses.load(std::memory_order_relaxed); }
+    std::uint64_t parallelSerialBlockCount() const { return parallelSerialBlocks.load(std::memory_order_relaxed); }
+    std::uint64_t parallelWorkerTaskCount() const { return renderPool.workerTaskCount(); }
+    // Lookahead brickwall limiter at the end of the float mix bus (default: on). Adds the
+    // lookahead to the output latency; when off, the bus is hard-clipped at full scale.
+    void setLimiter(bool enabled, double lookaheadMs = Limiter::defaultLookaheadMs,
+                    double releaseMs = Limiter::defaultReleaseMs, double ceilingDb = Limiter::defaultCeilingDb);
+    bool limiterEnabled() const { return limitOutput; }
+    // Frames of delay the engine adds between an event and its sound (limiter lookahead)
+    int outputLatency() const { return limitOutput ? limiter.latency() : 0; }
+    // Velocity layers and round-robin alternates: gives every zone of set a slot (nothing is
+    // loaded yet). Replaces the previous set, which stays in memory until the engine is
+    // destroyed; may be called while rendering (voices of the old set are cut at the next
+    // block), but not while loading. The note-addressed calls below (loadSample, loadSamples,
+    // setSample, ...) fill each note's first alternate of its loudest layer.
+    void setSampleSet(const SampleSet &set);
+    // Sparse sample sets (see SampleSet::sparse): a note without zones of its own plays the
+    // layers of the nearest sampled note within this many semitones (the lower one on a tie),
+    // pitch-shifted by the resampler - every layer, alternate and velocity of the source note
+    // carries over. 0 (the default) leaves such notes silent; at most maxPitchShift. Applies to
+    // sample sets installed afterwards. Shifted voices always take the resampling path, so a
+    // streamed source sample plays only its resident head there.
+    void setPitchShiftRange(int semitones);
+    int pitchShiftRange() const { return shiftRange; }
+    // Bytes of sample data to keep in memory: owned PCM plus the prefetched attacks of mapped
+    // samples (default 0 = no limit). Zones that don't fit are left on disk; a note-on that
+    // picks one plays the nearest loaded layer of the same note, and a pager thread brings the
+    // zone in for next time, dropping the pages of the least recently used mapped samples to
+    // stay within the budget.
+    void setSampleMemoryBudget(std::size_t bytes);
+    std::size_t sampleMemoryBudget() const { return memoryBudget; }
+    bool loadSample(int note, const std::string &filePath, std::string *errorMessage = nullptr);
+    // Load (note, path) pairs, decoding and converting on all cores. Returns the number
+    // loaded; a message per failed file is appended to errorMessages.
+    int loadSamples(const std::vector<std::pair<int, std::string>> &files,
+                    std::vector<std::string> *errorMessages = nullptr);
+    // Same, but returns immediately and may overlap rendering. Each note becomes playable
+    // as soon as it is decoded; onLoaded (if set) is then called on a loader thread.
+    // The notes must not already be loaded. Other setup calls must wait for waitForLoading().
+    using LoadCallback = std::function<void(int note, bool ok, const std::string &errorMessage)>;
+    void loadSamplesAsync(const std::vector<std::pair<int, std::string>> &files,
+                          LoadCallback onLoaded = LoadCallback());
+    // Load the files of the installed sample set the same way: first alternates of the loudest
+    // layers first, as far as the memory budget goes (estimated from file sizes). Returns the
+    // number of files queued; onLoaded is called for each with the zone's note.
+    int loadSampleSetAsync(LoadCallback onLoaded = LoadCallback());
+    void waitForLoading();
+    // Skip the files not started yet and wait for the rest
+    void stopLoading();
+    // Install the bank's sample set and load every entry with a single mapping (see samplebank.h).
+    // Entries not in the output format are converted in memory when normalization is on;
+    // mapped entries beyond the memory budget are left unprefetched for the pager.
+    bool loadSampleBank(const std::string &bankPath, std::string *errorMessage = nullptr);
+    // Loop points in frames (end exclusive), -1 for a sample without a sustain loop
+    void setSample(int note, std::vector<std::int16_t> pcm, int sampleRate, int channels,
+                   int loopStart = -1, int loopEnd = -1);
+    // Whether any layer of note is playable
+    bool hasSample(int note) const;
+    int sampleChannels(int note) const;
+    // Playable slots (every layer and alternate counts)
+    int sampleCount() const;
+    std::size_t residentSampleBytes() const { return residentBytes.load(std::memory_order_relaxed); }
+    // Note-ons that played another layer or alternate because theirs wasn't in memory (any thread)
+    std::uint64_t sampleFallbackCount() const { return fallbacks.load(std::memory_order_relaxed); }
+
+    int sampleRate() const { return outputSampleRate; }
+    int channels() const { return outputChannels; }
+    int maxFramesPerRender() const { return maxFrames; }
+
+    // Event producers. Each has a queue of its own, so the UI and a MIDI input thread can
+    // send events at the same time; the audio thread takes them from all queues in timestamp
+    // order.
+    enum class EventSource { UserInterface, Midi };
+    static const int eventSourceCount = 2;
+
+    // Producer side (one thread per source). Return false if the source's event queue is full.
+    // timestamp is when the event happened, on the NoteEvent::now() clock (0 = now): a MIDI
+    // driver's time stamp, for instance.
+    bool noteOn(int note, float velocity = 1.0f, std::uint64_t timestamp = 0,
+                EventSource source = EventSource::UserInterface);
+    bool noteOff(int note, std::uint64_t timestamp = 0, EventSource source = EventSource::UserInterface);
+    // Pedal positions are continuous, from 0 (up) to 1 (down), and clamped to that range. The
+    // una corda's muting follows the position. The damper pedal lifts the dampers off the
+    // strings between damperLiftStart and damperLiftEnd: below, released notes are damped
+    // in their damping time; above, they ring on (and the free strings resonate); in between
+    // (half pedal) the dampers only brush the strings and damp them that much more slowly.
+    bool setDamperPedal(float position, std::uint64_t timestamp = 0,
+                        EventSource source = EventSource::UserInterface);
+    bool setUnaCorda(float position, std::uint64_t timestamp = 0, EventSource source = EventSource::UserInterface);
+    // Silences everything on the event's frame (MIDI all sound off): the voices are cut, not
+    // released, and the resonance stops ringing. Pedals stay where they are.
+    bool allSoundOff(std::uint64_t timestamp = 0, EventSource source = EventSource::UserInterface);
+    static constexpr float damperLiftStart = 0.25f;
+    static constexpr float damperLiftEnd = 0.75f;
+    static const int undampedNote = 90;  // F#6: the strings from here up have no dampers
+    // Pedal positions as of the latest rendered block (any thread)
+    float damperPedal() const { return publishedDamper.load(std::memory_order_relaxed); }
+    float unaCorda() const { return publishedUnaCorda.load(std::memory_order_relaxed); }
+    // Linear gain of the mix bus ahead of the limiter (default: 1). Any thread; applies from
+    // the next rendered block.
+    void setMasterGain(float gain);
+    float masterGain() const { return masterBusGain.load(std::memory_order_relaxed); }
+
+    // Consumer side (audio thread). Renders interleaved frames; never locks or allocates.
+    // Events are applied at the frame their timestamp falls on, not at the start of the
+    // buffer: time is when the buffer's first frame is due, on the NoteEvent::now() clock,
+    // and events due after the buffer wait in the queue for a later one (offline rendering
+    // can queue them ahead). 0 - real-time callers - makes the buffer the last buffer period
+    // up to now: everything queued before the call is applied in it, each event one buffer
+    // period after it happened, so notes keep their spacing instead of snapping to buffer
+    // boundaries.
+    void render(std::int16_t *out, int frames, std::uint64_t time = 0);
+    void render(float *out, int frames, std::uint64_t time = 0);
+
+    // Drop all voices and queued events and return pedals/filters to their initial state.
+    // Call from the audio thread, or while no rendering is in progress (offline tools, benchmarks).
+    void reset();
+
+    // Number of voices currently sounding (audio thread only)
+    int activeVoiceCount() const { return voices.size(); }
+    int maxPolyphony() const { return voices.capacity(); }
+    // Voices taken over because the pool was full (audio thread only)
+    std::uint64_t stolenVoiceCount() const { return voices.stolenCount(); }
+    // Disk streaming counters (any thread): blocks where a voice's ring ran dry, note-ons
+    // that found no free stream, and streams currently open
+    std::uint64_t streamUnderrunCount() const { return streamer.underrunCount(); }
+    std::uint64_t streamUnavailableCount() const { return streamer.unavailableCount(); }
+    int activeStreamCount() const { return streamer.openStreamCount(); }
+    // Deepest limiter gain reduction since reset(), in dB (0 = never limited; audio thread only)
+    double limiterReduction() const;
+
+private:
+    struct Sample {
+        std::vector<std::int16_t> pcm;  // Owned PCM (decoded, converted or set directly)...
+        std::shared_ptr<const MappedFile> mapping;  // ...or the mapped WAV file data points into
+        const std::int16_t *data = nullptr;
+        int length = 0;  // In samples
+        int resident = 0;  // Samples readable through data (less than length when streamed)
+        std::unique_ptr<StreamSource> stream;  // Where the rest of a streamed sample lives
+        int sampleRate = 0;
+        int channels = 0;
+        int loopStart = -1;  // Sustain loop in frames (end exclusive), -1 if none
+        int loopEnd = -1;
+        std::unique_ptr<SampleLoop> loop;  // The loop, prepared for playback (built at install time)
+        // Per pitch shift, at [maxPitchShift + semitones]: 32.32 source frames per output
+        // frame, and the sinc table when the effective rate differs and quality is Sinc
+        std::array<std::uint64_t, 2 * maxPitchShift + 1> resampleSteps{};
+        std::array<const SincTable *, 2 * maxPitchShift + 1> resampleTables{};
+    };
+
+    // One zone of the sample set
+    struct Slot {
+        Sample sample;
+        std::string path;  // Empty for bank entries and samples set directly
+        int note = 0;
+        int alternate = 0;  // Position within its layer
+        int velocity = 0;  // Top of its layer
+        // Set (release) once the Sample is complete and its attack resident; the audio thread
+        // reads (acquire) before use
+        std::atomic<bool> ready{false};
+        std::atomic<bool> cold{false};  // Left on disk for the pager (budget), or evicted by it
+        std::atomic<bool> requested{false};  // Queued for the pager
+        std::atomic<std::uint32_t> lastUsed{0};  // Note-on serial of the latest use (pager LRU)
+        std::atomic<int> playing{0};  // Voices on this slot (written by the audio thread)
+    };
+
+    // Slots grouped by note, layer (softest first) and alternate. Built by setup, then
+    // published through currentLayout; only nextAlternate changes afterwards (audio thread).
+    struct SampleLayout {
+        struct Layer {
+            int first;  // Slots first .. first + count - 1 are the layer's alternates
+            int count;
+            float gainScale;  // 127 / top velocity: the recorded level at the top of the layer
+        };
+        static constexpr std::uint16_t noLayer = 0xffff;
+
+        std::unique_ptr<Slot[]> slots;
+        int slotCount = 0;
+        std::vector<Layer> layers;
+        std::array<int, maxNotes> firstLayer{};  // The note's layers are firstLayer .. + layerCount - 1
+        std::array<int, maxNotes> layerCount{};
+        std::vector<std::uint16_t> velocityLayers;  // [note * 128 + velocity] -> layer, noLayer if none
+        std::vector<std::uint32_t> nextAlternate;  // Per layer (round-robin position)
+        // Semitones each note sounds above the sampled note whose layers it borrows (0 = its own)
+        std::array<int, maxNotes> pitchShift{};
+        int shiftRange = 0;  // setPitchShiftRange() when the layout was built
+    };
+
+    SampleLayout &publishLayout(const std::vector<SampleZone> &zones);
+    SampleLayout &layout() const { return *currentLayout.load(std::memory_order_acquire); }
+    int primarySlot(int note) const;
+    int firstReadySlot(int note) const;
+    std::vector<int> loadOrder(const SampleLayout &layout) const;
+    int pickSample(SampleLayout &layout, int note, float velocity, float &gainScale);
+    std::size_t sampleMemory(const Sample &sample) const;
+    static std::size_t loopMemory(const Sample &sample)
+    {
+        return sample.loop ? sample.loop->pcm.size() * sizeof(std::int16_t) : 0;
+    }
+    std::size_t attackBytes(int sampleRate, int channels) const;
+    void startPager();
+    void stopPager();
+    void pagerLoop();
+    void pageIn(SampleLayout &layout, int slot);
+    void trimToBudget(SampleLayout &layout, int keep);
+    void prepareResampling(Sample &sample, int shiftRange);
+    const SincTable *sincTableFor(int sourceRate);
+    bool readSample(const std::string &filePath, Sample &sample, std::string *errorMessage);
+    void prefetchAttack(const MappedFile &mapping, std::size_t offset, int sampleRate, int channels) const;
+    bool shouldStream(int sampleRate, int channels, std::size_t length) const;
+    void prepareLoop(Sample &sample, const std::int16_t *pcm) const;
+    void makeStreamed(Sample &sample, const std::int16_t *pcm, std::shared_ptr<StreamFile> file,
+                      std::uint64_t dataOffset) const;
+    void startStreamer();
+    void releaseVoice(int i);
+    void retireVoice(int i);
+    void installSample(SampleLayout &layout, int slot, Sample &&sample, bool playable = true);
+    struct LoadItem {
+        int slot;
+        int note;
+        std::string path;
+    };
+    void startLoading(std::vector<LoadItem> items, LoadCallback onLoaded);
+    void loadWorker(const std::vector<LoadItem> &items, std::atomic<std::size_t> &nextItem,
+                    const LoadCallback &onLoaded);
+    bool pushEvent(NoteEvent::Type type, int note, float value, std::uint64_t timestamp, EventSource source);
+    NoteEventQueue *earliestQueue();
+    bool popEvent(NoteEvent &event);
+    void beginBuffer(int frames, std::uint64_t time);
+    int applyEvents(int frames);
+    void applyEvent(const NoteEvent &event);
+    int renderBlock(int frames);
+    void allocateMixBuffers();
+    void mixActiveNotes(int frames);
+    struct MixJob {
+        PianoEngine *engine;
+        int frames;
+        float damperContact;
+    };
+    static void mixTask(void *context, int task);
+    void retireEndedVoices();
+    bool mixVoices(int first, int last, float *mix, float *unaCordaMix, int frames, float damperContact,
+                   bool &unaCordaWritten);
+    float damperContact() const;
+    void setupDamping();
+    void applyUnaCordaVoices(int frames);
+    void applyResonance(int frames);
+    void applyUnaCorda(int frames);
+    void applyMasterBus(int frames);
+    void writeOutput(std::int16_t *out, int frames);
+    void writeOutput(float *out, int frames);
+
+    int outputSampleRate;
+    int outputChannels;
+    int maxFrames;  // Largest block rendered in one pass; longer requests are split
+    int noteCutoffMs;
+    int cutoffFrames;  // noteCutoffMs at the output rate (INT_MAX when disabled)
+    Envelope envelope;  // Settings and per-frame rates at the output rate
+    // Per note: release speed of a damped string relative to the envelope's release time (0 for
+    // undamped strings), and the resulting damping time
+    std::array<float, maxNotes> dampingSpeed;
+    std::array<float, maxNotes> dampingMs;
+
+    // Every sample set installed so far (the last one is current): voices and the disk
+    // streamer may still point into a replaced one
+    std::vector<std::unique_ptr<SampleLayout>> layouts;
+    std::atomic<SampleLayout *> currentLayout;
+    SampleLayout *activeLayout;  // The layout the voices play from (audio thread)
+    // Declared after the layouts so its reader thread stops before stream sources go away
+    DiskStreamer streamer;
+    bool streamSamples;
+    int preloadMs;
+    int maxStreams;
+    const MixKernels &kernels;  // SIMD mixing kernels for this CPU
+    ResampleQuality resamplerQuality;
+    std::vector<std::unique_ptr<SincTable>> sincTables;  // One per effective source rate, built at load time
+    std::mutex sincTableMutex;  // Loader threads share the table cache (never taken by render)
+    bool normalizeSamples;
+    bool mapSamples;
+    int prefetchMs;
+    int shiftRange;
+
+    // Background loading (loadSamplesAsync)
+    struct LoadJob {
+        std::vector<LoadItem> items;
+        std::atomic<std::size_t> nextItem{0};
+        LoadCallback onLoaded;
+    };
+    std::unique_ptr<LoadJob> loadJob;
+    std::vector<std::thread> loaderThreads;
+    std::atomic<bool> loadCancelled;
+    SampleCache sampleCache;
+
+    // Memory budget: cold slots are brought in by the pager thread on request from the audio thread
+    std::size_t memoryBudget;
+    std::atomic<std::size_t> residentBytes;
+    std::atomic<std::uint64_t> fallbacks;
+    SpscRingBuffer<int, 256> pageRequests;  // Slots, audio thread -> pager
+    std::thread pagerThread;
+    std::atomic<bool> pagerRunning;
+    std::uint32_t noteOnSerial;  // Audio thread
+
+    // Active notes (for mixing) - owned by the audio thread only
+    VoicePool voices;
+    NoteEventQueue noteEvents[eventSourceCount];  // Indexed by EventSource
+    // The buffer render() is working on, on the NoteEvent::now() clock: events up to
+    // bufferEnd (exclusive) are applied at their frame, later ones are left queued
+    std::uint64_t bufferTime;
+    std::uint64_t bufferEnd;
+    int bufferFrame;  // Frames of the buffer rendered so far
+
+    // Pre-allocated mix bus (float, 16-bit sample units) to avoid allocations in render()
+    std::vector<float> mixBuffer;
+    std::vector<float> unaCordaBuffer;  // Voices struck with the una corda (per-voice una corda)
+    bool unaCordaWritten;  // Whether a voice mixed into unaCordaBuffer this block
+    std::vector<std::uint8_t> voiceEnded;  // Per voice slot: flagged while mixing, retired after
+
+    // Parallel rendering: one buffer per group of voices (and one for its una corda voices),
+    // and whether the group wrote to it
+    RenderPool renderPool;
+    std::vector<float> taskBuffers;
+    std::vector<std::uint8_t> taskWritten;
+    std::vector<float> taskUnaCordaBuffers;
+    std::vector<std::uint8_t> taskUnaCordaWritten;
+    std::vector<std::uint8_t> taskDone;  // Per group: mixed in time for this block
+    MixJob mixJob;  // The block's job, read by the groups (which may outlast the block)
+    std::uint64_t parallelDeadlineNs;
+    int parallelBackoffFrames;
+    int parallelBackoff;  // Frames left to mix on the audio thread alone
+    std::atomic<std::uint64_t> parallelMisses;
+    std::atomic<std::uint64_t> parallelSerialBlocks;
+
+    // Master bus
+    Limiter limiter;
+    bool limitOutput;
+    std::atomic<float> masterBusGain;
+
+    // Sympathetic resonance, and its block-rate inputs: how far each string's damper is lifted,
+    // which notes voices are playing
+    ResonanceBank resonanceBank;
+    std::atomic<float> resonanceLevel;
+    std::array<float, maxNotes> stringOpen;
+    std::array<std::uint8_t, maxNotes> noteSounding;
+
+    // Pedal positions as seen by the audio thread (updated from pedal events at the start of
+    // each block), and published for other threads once the block has them
+    float damperPosition;
+    float unaCordaPosition;
+    float unaCordaLevel;  // Una corda amount at the end of the last block; ramps to the position
+    std::atomic<float> publishedDamper;
+    std::atomic<float> publishedUnaCorda;
+
+    // Una corda tone: on the mix bus, or (per voice) on the bus of the voices struck with it
+    UnaCordaFilter unaCordaFilter;
+    UnaCordaFilter unaCordaVoiceFilter;
+    std::atomic<bool> perVoiceUnaCorda;
+};
+
+#endif // PIANOENGINE_H
@@ -0,0 +1,218 @@
+#include "renderpool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#define RENDERPOOL_PTHREADS 1
+#endif
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+
+struct RenderPool::Semaphore {
+    Semaphore() : handle(dispatch_semaphore_create(0)) {}
+    ~Semaphore() { dispatch_release(handle); }
+    void post() { dispatch_semaphore_signal(handle); }
+    void wait() { dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER); }
+
+    dispatch_semaphore_t handle;
+};
+#elif defined(__unix__)
+#include <cerrno>
+#include <semaphore.h>
+
+struct RenderPool::Semaphore {
+    Semaphore() { sem_init(&handle, 0, 0); }
+    ~Semaphore() { sem_destroy(&handle); }
+    void post() { sem_post(&handle); }
+    void wait()
+    {
+        while (sem_wait(&handle) != 0 && errno == EINTR) {
+            // Interrupted by a signal: wait on
+        }
+    }
+
+    sem_t handle;
+};
+#else
+#include <condition_variable>
+#include <mutex>
+
+// Elsewhere: a counting semaphore from a mutex and a condition variable - it takes a lock
+// to post, but the count means a post can't be missed either
+struct RenderPool::Semaphore {
+    void post()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++count;
+        }
+        ready.notify_one();
+    }
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return count > 0; });
+        --count;
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    int count = 0;
+};
+#endif
+
+static std::uint32_t generationOf(std::uint64_t claim)
+{
+    return static_cast<std::uint32_t>(claim >> 32);
+}
+
+static int taskCountOf(std::uint64_t claim)
+{
+    return static_cast<int>((claim >> 16) & 0xffffu);
+}
+
+static int taskOf(std::uint64_t claim)
+{
+    return static_cast<int>(claim & 0xffffu);
+}
+
+RenderPool::RenderPool()
+    : wakeup(new Semaphore()), stopping(false), claim(0), jobFunction(nullptr), jobContext(nullptr), completed(0),
+      finishedGeneration(new std::atomic<std::uint32_t>[maxTasks]), realtimeThreads(0), workerTasks(0)
+{
+    for (int task = 0; task < maxTasks; ++task) {
+        finishedGeneration[task].store(0, std::memory_order_relaxed);
+    }
+}
+
+RenderPool::~RenderPool()
+{
+    stop();
+}
+
+void RenderPool::start(int threads)
+{
+    stop();
+    threads = std::clamp(threads, 0, maxThreads);
+    wakeup.reset(new Semaphore());  // No posts left over from the last workers
+    stopping.store(false, std::memory_order_relaxed);
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(&RenderPool::workerLoop, this);
+    }
+}
+
+void RenderPool::stop()
+{
+    stopping.store(true, std::memory_order_release);
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        wakeup->post();
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    realtimeThreads.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t RenderPool::run(TaskFunction function, void *context, int tasks, std::uint64_t deadlineNs)
+{
+    tasks = std::min(tasks, maxTasks);
+    if (tasks <= 0) {
+        return 0;
+    }
+    // The previous job is complete (every task done), so no claim can succeed until the new
+    // generation is published: whoever reads these early finds nothing left to claim
+    jobFunction.store(function, std::memory_order_relaxed);
+    jobContext.store(context, std::memory_order_relaxed);
+    completed.store(0, std::memory_order_relaxed);
+    const std::uint32_t generation = generationOf(claim.load(std::memory_order_relaxed)) + 1;
+    claim.store((static_cast<std::uint64_t>(generation) << 32) | (static_cast<std::uint64_t>(tasks) << 16),
+                std::memory_order_release);
+    // One post per worker: a worker that isn't asleep yet finds its post when it gets there
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        wakeup->post();
+    }
+
+    runTasks(generation, false);
+
+    // Everything is claimed; wait for the tasks still running on workers, up to the deadline -
+    // a worker preempted mid-task may not be back for a long time
+    if (completed.load(std::memory_order_acquire) == tasks) {
+        return 0;
+    }
+    const auto waitStart = std::chrono::steady_clock::now();
+    std::uint64_t waited = 0;
+    while (completed.load(std::memory_order_acquire) < tasks && waited < deadlineNs) {
+        std::this_thread::yield();
+        waited = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - waitStart).count());
+    }
+    return waited;
+}
+
+bool RenderPool::idle() const
+{
+    return completed.load(std::memory_order_acquire) >= taskCountOf(claim.load(std::memory_order_relaxed));
+}
+
+bool RenderPool::finished(int task) const
+{
+    return finishedGeneration[task].load(std::memory_order_acquire) ==
+           generationOf(claim.load(std::memory_order_relaxed));
+}
+
+void RenderPool::wait() const
+{
+    while (!idle()) {
+        std::this_thread::yield();
+    }
+}
+
+void RenderPool::runTasks(std::uint32_t generation, bool worker)
+{
+    // Read after seeing the generation: they belong to it, unless it is already complete and
+    // the next job is being set up - then the claim below fails
+    const TaskFunction function = jobFunction.load(std::memory_order_relaxed);
+    void *const context = jobContext.load(std::memory_order_relaxed);
+
+    std::uint64_t current = claim.load(std::memory_order_acquire);
+    while (generationOf(current) == generation && taskOf(current) < taskCountOf(current)) {
+        if (!claim.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+            continue;  // Someone else claimed it (current is reloaded)
+        }
+        function(context, taskOf(current));
+        finishedGeneration[taskOf(current)].store(generation, std::memory_order_release);
+        completed.fetch_add(1, std::memory_order_release);
+        if (worker) {
+            workerTasks.fetch_add(1, std::memory_order_relaxed);
+        }
+        current = claim.load(std::memory_order_acquire);
+    }
+}
+
+void RenderPool::workerLoop()
+{
+#ifdef RENDERPOOL_PTHREADS
+    // A middle real-time priority, above every normal thread; needs permission (an rtprio
+    // limit, or root) - without it the worker stays at normal priority
+    sched_param param{};
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        realtimeThreads.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+
+    for (;;) {
+        wakeup->wait();
+        if (stopping.load(std::memory_order_acquire)) {
+            return;
+        }
+        // A post from a job that is already done just finds nothing left to claim
+        runTasks(generationOf(claim.load(std::memory_order_acquire)), true);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef RENDERPOOL_H
+#define RENDERPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Pre-spawned worker threads that help the audio thread through a block's work.
+//
+// run() publishes a set of numbered tasks and works on them itself: every thread,
+// the caller included, claims the next unclaimed task until none are left, so
+// tasks go to whoever is free (a late or sleeping worker simply takes none) and
+// the caller never waits for a worker to start. It only waits for tasks a worker
+// has already claimed, and no longer than the deadline it gives: a worker that is
+// preempted in the middle of a task keeps that task, and the caller goes on without
+// it (finished() tells which tasks are done) until idle() says the worker is through.
+// Which thread runs a task doesn't matter to the caller: each task writes its own output.
+//
+// Workers sleep on a semaphore between blocks, posted once per worker by run() -
+// a post can't be lost the way a condition variable's notify can, and posting never
+// takes a lock. They ask for real-time scheduling (SCHED_FIFO) and stay at normal
+// priority where that isn't permitted.
+class RenderPool {
+public:
+    static const int maxThreads = 64;
+    static const int maxTasks = 4096;  // Per run()
+    using TaskFunction = void (*)(void *context, int task);
+
+    RenderPool();
+    ~RenderPool();
+
+    RenderPool(const RenderPool &) = delete;
+    RenderPool &operator=(const RenderPool &) = delete;
+
+    // Setup (not real-time safe): replaces the workers with `threads` new ones (0 stops them)
+    void start(int threads);
+    void stop();
+    int threadCount() const { return static_cast<int>(workers.size()); }
+    // Workers that got real-time scheduling
+    int realtimeThreadCount() const { return realtimeThreads.load(std::memory_order_relaxed); }
+
+    // Audio thread: runs function(context, task) for every task in 0..tasks-1 (at most
+    // maxTasks), each exactly once, on the calling thread and any workers that join in, and
+    // returns once all are done or, with tasks still running on workers, once it has waited
+    // deadlineNs for them - with the nanoseconds spent waiting. Only while idle(): tasks left
+    // running belong to their worker (and context must outlive them) until idle() again.
+    std::uint64_t run(TaskFunction function, void *context, int tasks,
+                      std::uint64_t deadlineNs = std::numeric_limits<std::uint64_t>::max());
+    // Audio thread: whether every task of the last run() is done, and whether one of them is
+    bool idle() const;
+    bool finished(int task) const;
+    // Not real-time: waits until idle() (before changing what running tasks work on)
+    void wait() const;
+
+    // Tasks run by workers rather than the caller since start (any thread)
+    std::uint64_t workerTaskCount() const { return workerTasks.load(std::memory_order_relaxed); }
+
+private:
+    void workerLoop();
+    void runTasks(std::uint32_t generation, bool worker);
+
+    struct Semaphore;  // Platform semaphore, see renderpool.cpp
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<Semaphore> wakeup;
+    std::atomic<bool> stopping;
+
+    // The current job. claim holds generation << 32 | task count << 16 | next task, so a
+    // worker that wakes late can't claim a task of a job that has already been replaced.
+    std::atomic<std::uint64_t> claim;
+    std::atomic<TaskFunction> jobFunction;
+    std::atomic<void *> jobContext;
+    std::atomic<int> completed;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> finishedGeneration;  // Per task: the last run that did it
+    std::atomic<int> realtimeThreads;
+    std::atomic<std::uint64_t> workerTasks;
+};
+
+#endif // RENDERPOOL_H
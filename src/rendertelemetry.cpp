@@ -0,0 +1,196 @@
+#include "rendertelemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+double RenderTelemetry::Snapshot::load(const Snapshot &earlier, const Snapshot &later)
+{
+    const std::uint64_t period = later.periodNs - earlier.periodNs;
+    return period > 0 ? static_cast<double>(later.renderNs - earlier.renderNs) / period : 0.0;
+}
+
+RenderTelemetry::RenderTelemetry()
+{
+    reset();
+}
+
+void RenderTelemetry::reset()
+{
+    sequence.store(0, std::memory_order_relaxed);
+    buffers.store(0, std::memory_order_relaxed);
+    frames.store(0, std::memory_order_relaxed);
+    renderNs.store(0, std::memory_order_relaxed);
+    periodNs.store(0, std::memory_order_relaxed);
+    lastRenderNs.store(0, std::memory_order_relaxed);
+    lastPeriodNs.store(0, std::memory_order_relaxed);
+    maxRenderNs.store(0, std::memory_order_relaxed);
+    peakLoadPpm.store(0, std::memory_order_relaxed);
+    deadlineMisses.store(0, std::memory_order_relaxed);
+    for (std::atomic<std::uint64_t> &bucket : histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    activeVoices.store(0, std::memory_order_relaxed);
+    peakVoices.store(0, std::memory_order_relaxed);
+    stolenVoices.store(0, std::memory_order_relaxed);
+    xruns.store(0, std::memory_order_release);
+}
+
+void RenderTelemetry::record(std::uint64_t cycleNs, int bufferFrames, int sampleRate, int voiceCount,
+                             std::uint64_t stolen, std::uint64_t xrunCount)
+{
+    const std::uint64_t bufferNs = sampleRate > 0 ? static_cast<std::uint64_t>(bufferFrames) * 1000000000ull / sampleRate : 0;
+    int bucket = 0;
+    while (bucket < histogramBuckets - 1 && cycleNs >= bucketLimitUs(bucket) * 1000.0) {
+        ++bucket;
+    }
+    const std::uint32_t loadPpm = bufferNs > 0
+        ? static_cast<std::uint32_t>(std::min<std::uint64_t>(cycleNs * 1000000ull / bufferNs, 0xffffffffu))
+        : 0;
+
+    // Single writer: plain load-and-store instead of read-modify-write; the odd sequence number
+    // tells readers to come back
+    const std::uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    buffers.store(buffers.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    frames.store(frames.load(std::memory_order_relaxed) + bufferFrames, std::memory_order_relaxed);
+    renderNs.store(renderNs.load(std::memory_order_relaxed) + cycleNs, std::memory_order_relaxed);
+    periodNs.store(periodNs.load(std::memory_order_relaxed) + bufferNs, std::memory_order_relaxed);
+    lastRenderNs.store(cycleNs, std::memory_order_relaxed);
+    lastPeriodNs.store(bufferNs, std::memory_order_relaxed);
+    if (cycleNs > maxRenderNs.load(std::memory_order_relaxed)) {
+        maxRenderNs.store(cycleNs, std::memory_order_relaxed);
+    }
+    if (loadPpm > peakLoadPpm.load(std::memory_order_relaxed)) {
+        peakLoadPpm.store(loadPpm, std::memory_order_relaxed);
+    }
+    if (cycleNs > deadlineFraction * bufferNs) {
+        deadlineMisses.store(deadlineMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    histogram[bucket].store(histogram[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    activeVoices.store(voiceCount, std::memory_order_relaxed);
+    if (voiceCount > peakVoices.load(std::memory_order_relaxed)) {
+        peakVoices.store(voiceCount, std::memory_order_relaxed);
+    }
+    stolenVoices.store(stolen, std::memory_order_relaxed);
+    xruns.store(xrunCount, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+RenderTelemetry::Snapshot RenderTelemetry::snapshot() const
+{
+    Snapshot copy;
+    for (;;) {
+        const std::uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1u) {
+            std::this_thread::yield();  // A buffer is being recorded right now
+            continue;
+        }
+        copy.buffers = buffers.load(std::memory_order_relaxed);
+        copy.frames = frames.load(std::memory_order_relaxed);
+        copy.renderNs = renderNs.load(std::memory_order_relaxed);
+        copy.periodNs = periodNs.load(std::memory_order_relaxed);
+        copy.lastRenderNs = lastRenderNs.load(std::memory_order_relaxed);
+        const std::uint64_t lastPeriod = lastPeriodNs.load(std::memory_order_relaxed);
+        copy.maxRenderNs = maxRenderNs.load(std::memory_order_relaxed);
+        copy.peakLoad = peakLoadPpm.load(std::memory_order_relaxed) / 1e6;
+        copy.deadlineMisses = deadlineMisses.load(std::memory_order_relaxed);
+        for (int i = 0; i < histogramBuckets; ++i) {
+            copy.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+        }
+        copy.activeVoices = activeVoices.load(std::memory_order_relaxed);
+        copy.peakVoices = peakVoices.load(std::memory_order_relaxed);
+        copy.stolenVoices = stolenVoices.load(std::memory_order_relaxed);
+        copy.xruns = xruns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            copy.lastLoad = lastPeriod > 0 ? static_cast<double>(copy.lastRenderNs) / lastPeriod : 0.0;
+            return copy;
+        }
+    }
+}
+
+TelemetryLog::~TelemetryLog()
+{
+    stop();
+}
+
+bool TelemetryLog::start(const std::string &path, int intervalMs, const RenderTelemetry &telemetry,
+                         std::string *errorMessage)
+{
+    stop();
+    file.open(path, std::ios::trunc);
+    if (!file) {
+        if (errorMessage) {
+            *errorMessage = "Failed to create telemetry log: " + path;
+        }
+        return false;
+    }
+    source = &telemetry;
+    stopping = false;
+    thread = std::thread(&TelemetryLog::run, this, std::max(1, intervalMs));
+    return true;
+}
+
+void TelemetryLog::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+void TelemetryLog::run(int intervalMs)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+    RenderTelemetry::Snapshot previous = source->snapshot();
+    Clock::time_point due = startTime;
+    bool last = false;
+    while (!last) {
+        due += std::chrono::milliseconds(intervalMs);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            last = wake.wait_until(lock, due, [this]() { return stopping; });
+        }
+        const RenderTelemetry::Snapshot current = source->snapshot();
+        writeLine(previous, current, std::chrono::duration<double>(Clock::now() - startTime).count());
+        previous = current;
+    }
+}
+
+void TelemetryLog::writeLine(const RenderTelemetry::Snapshot &previous, const RenderTelemetry::Snapshot &current,
+                             double seconds)
+{
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "{\"t\": %.3f, \"buffers\": %llu, \"load\": %.4f, \"deadline_misses\": %llu, \"xruns\": %llu, "
+                  "\"stolen_voices\": %llu, \"voices\": %d, \"peak_load\": %.4f, \"max_cycle_us\": %.1f, "
+                  "\"peak_voices\": %d, \"total_buffers\": %llu, \"total_deadline_misses\": %llu, "
+                  "\"total_xruns\": %llu, \"histogram\": [",
+                  seconds, static_cast<unsigned long long>(current.buffers - previous.buffers),
+                  RenderTelemetry::Snapshot::load(previous, current),
+                  static_cast<unsigned long long>(current.deadlineMisses - previous.deadlineMisses),
+                  static_cast<unsigned long long>(current.xruns - previous.xruns),
+                  static_cast<unsigned long long>(current.stolenVoices - previous.stolenVoices),
+                  current.activeVoices, current.peakLoad, current.maxRenderNs / 1000.0, current.peakVoices,
+                  static_cast<unsigned long long>(current.buffers),
+                  static_cast<unsigned long long>(current.deadlineMisses),
+                  static_cast<unsigned long long>(current.xruns));
+    file << line;
+    for (int i = 0; i < RenderTelemetry::histogramBuckets; ++i) {
+        file << (i > 0 ? ", " : "") << current.histogram[i] - previous.histogram[i];
+    }
+    file << "]}\n";
+    file.flush();  // A soak test that crashes still leaves its log behind
+}
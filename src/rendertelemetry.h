@@ -0,0 +1,116 @@
+#ifndef RENDERTELEMETRY_H
+#define RENDERTELEMETRY_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Statistics of a render loop, written by the render thread and read from anywhere.
+//
+// The render thread calls record() once per buffer: a few relaxed atomic stores between
+// two bumps of a sequence counter, no locks, no waiting. A reader copies a consistent
+// snapshot() and just tries again if a buffer was recorded while it was copying, so reading
+// never holds up the render thread. Every counter is cumulative since reset(); a consumer
+// gets the figures for an interval (DSP load, cycle times) from the difference of two
+// snapshots.
+class RenderTelemetry {
+public:
+    // Cycle-time histogram: bucket i counts buffers rendered in under bucketLimitUs(i)
+    // (and at least the limit of bucket i-1): 4 us, 8 us, ... 65 ms; the last one takes the rest
+    static const int histogramBuckets = 16;
+    // Share of a buffer's playing time its rendering may take; the rest is left to the driver
+    static constexpr double deadlineFraction = 0.75;
+
+    struct Snapshot {
+        std::uint64_t buffers = 0;
+        std::uint64_t frames = 0;
+        std::uint64_t renderNs = 0;  // Time spent rendering
+        std::uint64_t periodNs = 0;  // Playing time of what was rendered
+        std::uint64_t lastRenderNs = 0;
+        std::uint64_t maxRenderNs = 0;
+        double lastLoad = 0.0;  // Render time / playing time of the latest buffer
+        double peakLoad = 0.0;  // Highest of those
+        std::uint64_t deadlineMisses = 0;  // Buffers over deadlineFraction
+        std::array<std::uint64_t, histogramBuckets> histogram{};
+        int activeVoices = 0;  // After the latest buffer
+        int peakVoices = 0;
+        std::uint64_t stolenVoices = 0;
+        std::uint64_t xruns = 0;  // As reported by the audio device
+
+        // Average DSP load (render time / playing time) since reset(), or between two snapshots
+        double load() const { return periodNs > 0 ? static_cast<double>(renderNs) / periodNs : 0.0; }
+        static double load(const Snapshot &earlier, const Snapshot &later);
+    };
+
+    RenderTelemetry();
+
+    RenderTelemetry(const RenderTelemetry &) = delete;
+    RenderTelemetry &operator=(const RenderTelemetry &) = delete;
+
+    static double bucketLimitUs(int bucket) { return 4.0 * (1u << bucket); }
+
+    // Render thread: one buffer of frames at sampleRate took renderNs; the engine's voice
+    // counters and the device's xrun count as they stand after it
+    void record(std::uint64_t renderNs, int frames, int sampleRate, int activeVoices,
+                std::uint64_t stolenVoices, std::uint64_t xruns);
+    // Not while record() may run
+    void reset();
+
+    // Any thread
+    Snapshot snapshot() const;
+    std::uint64_t deadlineMissCount() const { return deadlineMisses.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint32_t> sequence;  // Odd while record() is writing
+    std::atomic<std::uint64_t> buffers;
+    std::atomic<std::uint64_t> frames;
+    std::atomic<std::uint64_t> renderNs;
+    std::atomic<std::uint64_t> periodNs;
+    std::atomic<std::uint64_t> lastRenderNs;
+    std::atomic<std::uint64_t> lastPeriodNs;
+    std::atomic<std::uint64_t> maxRenderNs;
+    std::atomic<std::uint32_t> peakLoadPpm;  // Parts per million
+    std::atomic<std::uint64_t> deadlineMisses;
+    std::array<std::atomic<std::uint64_t>, histogramBuckets> histogram;
+    std::atomic<int> activeVoices;
+    std::atomic<int> peakVoices;
+    std::atomic<std::uint64_t> stolenVoices;
+    std::atomic<std::uint64_t> xruns;
+};
+
+// Appends a line of JSON to a file every intervalMs, from a thread of its own - for soak
+// tests. Each line has the seconds since start; the interval's buffers, DSP load, deadline
+// misses, xruns, stolen voices and cycle-time histogram; the current voice count; and the
+// peaks (load, cycle time, voices) and totals since the telemetry was reset.
+class TelemetryLog {
+public:
+    TelemetryLog() = default;
+    ~TelemetryLog();
+
+    TelemetryLog(const TelemetryLog &) = delete;
+    TelemetryLog &operator=(const TelemetryLog &) = delete;
+
+    bool start(const std::string &path, int intervalMs, const RenderTelemetry &telemetry,
+               std::string *errorMessage = nullptr);
+    // Writes a last line and closes the file
+    void stop();
+
+private:
+    void run(int intervalMs);
+    void writeLine(const RenderTelemetry::Snapshot &previous, const RenderTelemetry::Snapshot &current,
+                   double seconds);
+
+    const RenderTelemetry *source = nullptr;
+    std::ofstream file;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif // RENDERTELEMETRY_H
@@ -0,0 +1,184 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+const char *resampleQualityName(ResampleQuality quality)
+{
+    switch (quality) {
+    case ResampleQuality::Nearest: return "nearest";
+    case ResampleQuality::Linear: return "linear";
+    case ResampleQuality::Cubic: return "cubic";
+    case ResampleQuality::Sinc: return "sinc";
+    }
+    return "unknown";
+}
+
+bool parseResampleQuality(const std::string &name, ResampleQuality &quality)
+{
+    static const ResampleQuality all[] = {
+        ResampleQuality::Nearest, ResampleQuality::Linear, ResampleQuality::Cubic, ResampleQuality::Sinc
+    };
+    for (ResampleQuality candidate : all) {
+        if (name == resampleQualityName(candidate)) {
+            quality = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t resampleStep(int sourceRate, int outputRate)
+{
+    return (static_cast<std::uint64_t>(sourceRate) << 32) / static_cast<std::uint64_t>(outputRate);
+}
+
+// Zeroth-order modified Bessel function of the first kind (for the Kaiser window)
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+SincTable::SincTable(int sourceRate, int outputRate)
+    : fromRate(sourceRate), toRate(outputRate), coefficients(static_cast<size_t>(phases) * taps)
+{
+    // Cut off below the lower Nyquist frequency, leaving room for the transition band
+    const double cutoff = std::min(1.0, static_cast<double>(outputRate) / sourceRate) * 0.91;
+    const double beta = 8.0;
+    const double windowNorm = besselI0(beta);
+    const int half = taps / 2;
+
+    for (int phase = 0; phase < phases; ++phase) {
+        const double offset = static_cast<double>(phase) / phases;  // Position between frame 0 and 1
+        float *row = coefficients.data() + static_cast<size_t>(phase) * taps;
+        double sum = 0.0;
+        for (int k = 0; k < taps; ++k) {
+            // Distance from the interpolation point to tap frame (k - half + 1)
+            const double x = (k - half + 1) - offset;
+            const double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            const double r = x / half;
+            const double window = (std::abs(r) >= 1.0) ? 0.0
+                                                       : besselI0(beta * std::sqrt(1.0 - r * r)) / windowNorm;
+            row[k] = static_cast<float>(sinc * window);
+            sum += row[k];
+        }
+        // Unity gain at DC for every phase, so there is no phase-dependent ripple in level
+        for (int k = 0; k < taps; ++k) {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+}
+
+// Sample of frame `index`, channel `ch`, or silence outside the data
+static inline float sampleAt(const std::int16_t *data, int lengthFrames, int channels, int index, int ch)
+{
+    return (index >= 0 && index < lengthFrames) ? data[index * channels + ch] : 0.0f;
+}
+
+static inline void advance(int &frame, std::uint32_t &fraction, std::uint64_t step)
+{
+    const std::uint64_t next = static_cast<std::uint64_t>(fraction) + (step & 0xffffffffu);
+    fraction = static_cast<std::uint32_t>(next);
+    frame += static_cast<int>(step >> 32) + static_cast<int>(next >> 32);
+}
+
+void resampleMix(ResampleQuality quality, const SincTable *sincTable,
+                 float *mix, int outputChannels, int frames,
+                 const std::int16_t *data, int lengthFrames, int channels,
+                 int &frame, std::uint32_t &fraction, std::uint64_t step, float gain, float gainStep)
+{
+    const int mixChannels = std::min(outputChannels, channels);
+    const float fractionScale = 1.0f / 4294967296.0f;
+    int out = 0;
+
+    switch (quality) {
+    case ResampleQuality::Nearest:
+        for (; out < frames && frame < lengthFrames; ++out) {
+            const float frameGain = gain + gainStep * static_cast<float>(out);
+            const std::int16_t *src = data + frame * channels;
+            for (int ch = 0; ch < mixChannels; ++ch) {
+                mix[out * outputChannels + ch] += src[ch] * frameGain;
+            }
+            advance(frame, fraction, step);
+        }
+        break;
+
+    case ResampleQuality::Linear:
+        for (; out < frames && frame < lengthFrames; ++out) {
+            const float frameGain = gain + gainStep * static_cast<float>(out);
+            const float t = fraction * fractionScale;
+            for (int ch = 0; ch < mixChannels; ++ch) {
+                const float x0 = data[frame * channels + ch];
+                const float x1 = sampleAt(data, lengthFrames, channels, frame + 1, ch);
+                mix[out * outputChannels + ch] += (x0 + (x1 - x0) * t) * frameGain;
+            }
+            advance(frame, fraction, step);
+        }
+        break;
+
+    case ResampleQuality::Cubic:
+        for (; out < frames && frame < lengthFrames; ++out) {
+            const float frameGain = gain + gainStep * static_cast<float>(out);
+            const float t = fraction * fractionScale;
+            for (int ch = 0; ch < mixChannels; ++ch) {
+                const float xm1 = sampleAt(data, lengthFrames, channels, frame - 1, ch);
+                const float x0 = data[frame * channels + ch];
+                const float x1 = sampleAt(data, lengthFrames, channels, frame + 1, ch);
+                const float x2 = sampleAt(data, lengthFrames, channels, frame + 2, ch);
+                // Catmull-Rom spline through the four neighbouring frames
+                const float c1 = 0.5f * (x1 - xm1);
+                const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+                const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+                const float value = ((c3 * t + c2) * t + c1) * t + x0;
+                mix[out * outputChannels + ch] += value * frameGain;
+            }
+            advance(frame, fraction, step);
+        }
+        break;
+
+    case ResampleQuality::Sinc: {
+        const int half = SincTable::taps / 2;
+        for (; out < frames && frame < lengthFrames; ++out) {
+            const float frameGain = gain + gainStep * static_cast<float>(out);
+            const float *coefficients = sincTable->row(fraction);
+            const int first = frame - half + 1;
+            for (int ch = 0; ch < mixChannels; ++ch) {
+                float value = 0.0f;
+                if (first >= 0 && first + SincTable::taps <= lengthFrames) {
+                    // Interior: no bounds checks, vectorizes across taps
+                    const std::int16_t *src = data + first * channels + ch;
+                    for (int k = 0; k < SincTable::taps; ++k) {
+                        value += coefficients[k] * src[k * channels];
+                    }
+                } else {
+                    for (int k = 0; k < SincTable::taps; ++k) {
+                        value += coefficients[k] * sampleAt(data, lengthFrames, channels, first + k, ch);
+                    }
+                }
+                mix[out * outputChannels + ch] += value * frameGain;
+            }
+            advance(frame, fraction, step);
+        }
+        break;
+    }
+    }
+
+    // Frames requested past the end of the data still advance the read position,
+    // so the voice's clock keeps matching the output clock
+    for (; out < frames; ++out) {
+        advance(frame, fraction, step);
+    }
+}
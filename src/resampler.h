@@ -0,0 +1,66 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Sample-rate conversion for voices whose sample rate differs from the output.
+//
+// Read positions are 32.32 fixed point (integer frame + 32-bit fraction), so the
+// per-frame update is one add with carry and never drifts. Quality tiers trade
+// CPU for aliasing:
+//   Nearest - original behaviour, truncates to the previous frame (aliases badly)
+//   Linear  - 2-point linear interpolation
+//   Cubic   - 4-point Catmull-Rom interpolation
+//   Sinc    - 16-tap Kaiser-windowed sinc, 512-phase polyphase table, band-limited
+//             to the lower of the two Nyquist frequencies
+enum class ResampleQuality {
+    Nearest,
+    Linear,
+    Cubic,
+    Sinc
+};
+
+const char *resampleQualityName(ResampleQuality quality);
+bool parseResampleQuality(const std::string &name, ResampleQuality &quality);
+
+// 32.32 fixed-point source frames advanced per output frame
+std::uint64_t resampleStep(int sourceRate, int outputRate);
+
+// Precomputed windowed-sinc coefficients, one row of `taps` per phase.
+// Built once per (source rate, output rate) pair at load time.
+class SincTable {
+public:
+    static const int taps = 16;
+    static const int phaseBits = 9;
+    static const int phases = 1 << phaseBits;
+
+    SincTable(int sourceRate, int outputRate);
+
+    // Coefficients for the given 32-bit fractional position; tap k applies to frame (index - taps/2 + 1 + k)
+    const float *row(std::uint32_t fraction) const
+    {
+        return coefficients.data() + static_cast<size_t>(fraction >> (32 - phaseBits)) * taps;
+    }
+
+    int sourceRate() const { return fromRate; }
+    int outputRate() const { return toRate; }
+
+private:
+    int fromRate;
+    int toRate;
+    std::vector<float> coefficients;
+};
+
+// Mixes `frames` output frames of one voice into `mix` (interleaved, outputChannels wide),
+// advancing the voice's read position. Frames past the end of the data contribute nothing.
+// gain is linear (1.0 = unity) and ramps by gainStep per output frame (envelope sub-blocks;
+// 0 = constant). sincTable is only used (and must be non-null) for Sinc.
+void resampleMix(ResampleQuality quality, const SincTable *sincTable,
+                 float *mix, int outputChannels, int frames,
+                 const std::int16_t *data, int lengthFrames, int channels,
+                 int &frame, std::uint32_t &fraction, std::uint64_t step, float gain,
+                 float gainStep = 0.0f);
+
+#endif // RESAMPLER_H
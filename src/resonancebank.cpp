@@ -0,0 +1,153 @@
+#include "resonancebank.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Below this (16-bit sample units) a string counts as silent and its state is dropped
+static const double silence = 1e-3;
+
+// Amplitude decay per sample, in nepers, of something that falls 60 dB in seconds
+static double decayPerSample(double seconds, int sampleRate)
+{
+    return std::log(1000.0) / (std::max(seconds, 0.001) * sampleRate);
+}
+
+ResonanceBank::ResonanceBank()
+    : channels(2), ringing(0)
+{
+    const float noDamping[128] = {};
+    setup(44100, 2, 0, noDamping);
+}
+
+void ResonanceBank::setup(int sampleRate, int channelCount, int maxFrames, const float *dampingMs)
+{
+    channels = std::max(1, channelCount);
+    input.assign(std::max(0, maxFrames), 0.0f);
+    for (int s = 0; s < strings; ++s) {
+        const int note = lowestNote + s;
+        const double w = 2.0 * M_PI * 440.0 * std::pow(2.0, (note - 69) / 12.0) / sampleRate;
+        cosine[s] = std::cos(w);
+        cosine2[s] = std::cos(2.0 * w);
+        // A free string rings for about 3 s in the bass, half a second at the top of the bank;
+        // a damped one for the note's damping time (never less than 20 ms)
+        freeDecay[s] = decayPerSample(3.0 * std::pow(2.0, -s / 24.0), sampleRate);
+        dampedDecay[s] = decayPerSample(std::max(20.0f, dampingMs[note]) / 1000.0, sampleRate);
+        // Bass to the left, treble to the right, as seen from the keyboard
+        const double pan = 0.5 * M_PI * s / (strings - 1);
+        panLeft[s] = channels == 1 ? 1.0f : static_cast<float>(std::cos(pan));
+        panRight[s] = channels == 1 ? 0.0f : static_cast<float>(std::sin(pan));
+    }
+    reset();
+}
+
+void ResonanceBank::reset()
+{
+    std::fill(state1, state1 + strings, 0.0);
+    std::fill(state2, state2 + strings, 0.0);
+    ringing = 0;
+}
+
+void ResonanceBank::process(float *mix, int frames, const float *open, const std::uint8_t *sounding, float level)
+{
+    // Strings are driven where the damper is at least partly lifted and the note isn't playing
+    bool driven = false;
+    for (int s = 0; s < strings && !driven; ++s) {
+        driven = open[lowestNote + s] > 0.0f && !sounding[lowestNote + s];
+    }
+    if (level <= 0.0f || (!driven && ringing == 0)) {
+        if (ringing > 0) {
+            reset();  // Turned off: drop whatever was still ringing
+        }
+        return;
+    }
+
+    // One mono input for all strings (the first two channels; the bus may have more)
+    frames = std::min(frames, static_cast<int>(input.size()));
+    if (channels == 1) {
+        std::copy(mix, mix + frames, input.begin());
+    } else {
+        for (int frame = 0; frame < frames; ++frame) {
+            input[frame] = 0.5f * (mix[frame * channels] + mix[frame * channels + 1]);
+        }
+    }
+
+    // This block's coefficients, for the strings that are driven or still ringing
+    int count = 0;
+    for (int s = 0; s < strings; ++s) {
+        const int note = lowestNote + s;
+        const float lifted = open[note];
+        const double drive = sounding[note] ? 0.0 : lifted;
+        if (drive == 0.0 && std::abs(state1[s]) + std::abs(state2[s]) < silence) {
+            state1[s] = 0.0;
+            state2[s] = 0.0;
+            continue;
+        }
+        // The pole radius from the damper position, and an input gain that gives a steady sine
+        // at the string's frequency unity gain whatever the radius
+        const double decay = dampedDecay[s] + (freeDecay[s] - dampedDecay[s]) * lifted;
+        const double radius = std::exp(-decay);
+        Active &string = active[count++];
+        string.string = s;
+        string.b1 = 2.0 * radius * cosine[s];
+        string.b2 = -radius * radius;
+        string.drive = drive * (1.0 - radius) * std::sqrt(1.0 - 2.0 * radius * cosine2[s] + radius * radius);
+        string.left = level * panLeft[s];
+        string.right = level * panRight[s];
+    }
+    while (count % group != 0) {
+        active[count++] = Active{-1, 0.0, 0.0, 0.0, 0.0f, 0.0f};
+    }
+
+    // A group of strings at a time: the recurrences of one string depend on each other's
+    // results sample by sample, those of different strings don't, so the CPU can overlap them
+    ringing = 0;
+    for (int first = 0; first < count; first += group) {
+        const Active *strings = active + first;
+        double y1[group];
+        double y2[group];
+        double b1[group];
+        double b2[group];
+        double drive[group];
+        double gainLeft[group];
+        double gainRight[group];
+        for (int k = 0; k < group; ++k) {
+            y1[k] = strings[k].string >= 0 ? state1[strings[k].string] : 0.0;
+            y2[k] = strings[k].string >= 0 ? state2[strings[k].string] : 0.0;
+            b1[k] = strings[k].b1;
+            b2[k] = strings[k].b2;
+            drive[k] = strings[k].drive;
+            gainLeft[k] = strings[k].left;
+            gainRight[k] = strings[k].right;
+        }
+        float *out = mix;
+        for (int frame = 0; frame < frames; ++frame, out += channels) {
+            const double x = input[frame];
+            double left = 0.0;
+            double right = 0.0;
+            for (int k = 0; k < group; ++k) {
+                const double y = drive[k] * x + b1[k] * y1[k] + b2[k] * y2[k];
+                y2[k] = y1[k];
+                y1[k] = y;
+                left += y * gainLeft[k];
+                right += y * gainRight[k];
+            }
+            out[0] += static_cast<float>(left);
+            if (channels > 1) {
+                out[1] += static_cast<float>(right);
+            }
+        }
+        for (int k = 0; k < group; ++k) {
+            if (strings[k].string >= 0) {
+                state1[strings[k].string] = y1[k];
+                state2[strings[k].string] = y2[k];
+                if (std::abs(y1[k]) + std::abs(y2[k]) >= silence) {
+                    ++ringing;
+                }
+            }
+        }
+    }
+}
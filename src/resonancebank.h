@@ -0,0 +1,72 @@
+#ifndef RESONANCEBANK_H
+#define RESONANCEBANK_H
+
+#include <cstdint>
+#include <vector>
+
+// Sympathetic string resonance: a fixed bank of resonators, one per string from
+// lowestNote up, driven by the mix bus.
+//
+// Every string is a two-pole resonator tuned to its note's fundamental and fed the
+// (mono) mix, so whatever is playing sets the strings it shares partials with ringing -
+// an octave or a fifth below a held chord, say. How freely a string rings depends on its
+// damper: lifted, it decays over seconds; resting on the string, within the note's
+// damping time. Strings whose own note is sounding aren't driven (their sound is the
+// voice itself).
+//
+// Dampers, excitation and the resonators' coefficients are updated once per block, not
+// per sample, from the pedal position and the notes sounding - so the per-sample work is
+// one multiply-add recurrence per ringing string whatever the number of voices, and never
+// more than `strings` of them: a fixed CPU budget. A string that has decayed to silence
+// with its damper down costs nothing until it is excited again.
+class ResonanceBank {
+public:
+    static const int strings = 64;
+    static const int lowestNote = 24;  // C1; the bank spans C1 .. D#6
+    static constexpr float defaultLevel = 0.25f;
+
+    ResonanceBank();
+
+    // Setup (not real-time safe): sizes the scratch buffer for blocks of up to maxFrames and
+    // clears the strings. dampingMs[note] is how long a damped string takes to fall silent;
+    // free strings ring for free decay times of their own (longer in the bass).
+    void setup(int sampleRate, int channels, int maxFrames, const float *dampingMs);
+    void reset();
+
+    // Audio thread: adds level times the resonance excited by frames of interleaved mix (16-bit
+    // sample units) to it. open is how far each string's damper is lifted (indexed by note,
+    // 0 = resting on it, 1 = clear of it), sounding flags the notes voices are playing.
+    void process(float *mix, int frames, const float *open, const std::uint8_t *sounding, float level);
+
+    // Whether every string is silent (process() then costs only the idle check)
+    bool idle() const { return ringing == 0; }
+
+private:
+    int channels;
+    std::vector<float> input;  // Mono mix of the current block
+    // Per string; double, as the low strings' poles sit very close to the unit circle
+    double freeDecay[strings];  // Per-sample amplitude decay in nepers, damper lifted
+    double dampedDecay[strings];  // Same with the damper on the string
+    double cosine[strings];  // cos(w), w = the string's frequency in radians per sample
+    double cosine2[strings];  // cos(2w)
+    float panLeft[strings];
+    float panRight[strings];
+    double state1[strings];  // y[n-1]
+    double state2[strings];  // y[n-2]
+    int ringing;  // Strings with a non-silent state after the last block
+
+    // The current block's active strings (driven or still ringing) with their coefficients,
+    // padded to whole groups: the sample loop runs a group's recurrences side by side
+    static const int group = 4;
+    struct Active {
+        int string;  // -1 for padding
+        double b1;
+        double b2;
+        double drive;
+        float left;
+        float right;
+    };
+    Active active[strings + group - 1];
+};
+
+#endif // RESONANCEBANK_H
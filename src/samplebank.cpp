@@ -0,0 +1,109 @@
+#include "samplebank.h"
+
+#include <cstring>
+#include <fstream>
+
+static const char bankMagic[8] = {'P', 'N', 'O', 'B', 'A', 'N', 'K', '\0'};
+
+static bool fail(std::string *errorMessage, const std::string &message)
+{
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+    return false;
+}
+
+bool SampleBank::open(const std::string &path, std::string *errorMessage)
+{
+    index.clear();
+    file = std::make_shared<MappedFile>();
+    if (!file->open(path, errorMessage)) {
+        return false;
+    }
+
+    const unsigned char *bytes = file->data();
+    const std::size_t size = file->size();
+    SampleBankHeader header;
+    if (size < sizeof(header)) {
+        return fail(errorMessage, "Invalid sample bank: " + path);
+    }
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, bankMagic, sizeof(bankMagic)) != 0) {
+        return fail(errorMessage, "Invalid sample bank: " + path);
+    }
+    if (header.version != version) {
+        return fail(errorMessage, "Unsupported sample bank version: " + path);
+    }
+    if (header.fileSize != size ||
+        sizeof(header) + static_cast<std::uint64_t>(header.entryCount) * sizeof(SampleBankEntry) > size) {
+        return fail(errorMessage, "Truncated sample bank: " + path);
+    }
+
+    // Validate every entry up front so the render path can trust the index
+    index.resize(header.entryCount);
+    std::memcpy(index.data(), bytes + sizeof(header), index.size() * sizeof(SampleBankEntry));
+    for (const SampleBankEntry &entry : index) {
+        const std::uint64_t bytesUsed = entry.length * sizeof(std::int16_t);
+        if (entry.note < 0 || entry.note > 127 || entry.velocity > 127 || entry.channels == 0 || entry.sampleRate == 0 ||
+            entry.offset % sizeof(std::int16_t) != 0 || entry.offset > size || bytesUsed > size - entry.offset) {
+            index.clear();
+            return fail(errorMessage, "Corrupt sample bank index: " + path);
+        }
+    }
+    return true;
+}
+
+bool writeSampleBank(const std::string &path, const std::vector<SampleBankInput> &samples,
+                     std::string *errorMessage)
+{
+    SampleBankHeader header;
+    std::memcpy(header.magic, bankMagic, sizeof(bankMagic));
+    header.version = SampleBank::version;
+    header.entryCount = static_cast<std::uint32_t>(samples.size());
+    header.alignment = SampleBank::alignment;
+    header.reserved = 0;
+
+    // Lay out the PCM after the index, each entry on an alignment boundary
+    const auto align = [](std::uint64_t offset) {
+        return (offset + SampleBank::alignment - 1) / SampleBank::alignment * SampleBank::alignment;
+    };
+    std::vector<SampleBankEntry> index(samples.size());
+    std::uint64_t offset = sizeof(header) + index.size() * sizeof(SampleBankEntry);
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const WavData &wav = samples[i].wav;
+        SampleBankEntry &entry = index[i];
+        entry.note = samples[i].note;
+        entry.sampleRate = static_cast<std::uint32_t>(wav.sampleRate);
+        entry.channels = static_cast<std::uint32_t>(wav.channels);
+        entry.velocity = static_cast<std::uint8_t>(samples[i].velocity);
+        entry.alternate = static_cast<std::uint8_t>(samples[i].alternate);
+        entry.reserved = 0;
+        entry.offset = align(offset);
+        entry.length = wav.samples.size();
+        entry.loopStart = wav.loopStart;
+        entry.loopEnd = wav.loopEnd;
+        offset = entry.offset + entry.length * sizeof(std::int16_t);
+    }
+    header.fileSize = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return fail(errorMessage, "Failed to create sample bank: " + path);
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(index.data()),
+               static_cast<std::streamsize>(index.size() * sizeof(SampleBankEntry)));
+    std::uint64_t written = sizeof(header) + index.size() * sizeof(SampleBankEntry);
+    const char padding[SampleBank::alignment] = {};
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        file.write(padding, static_cast<std::streamsize>(index[i].offset - written));
+        file.write(reinterpret_cast<const char *>(samples[i].wav.samples.data()),
+                   static_cast<std::streamsize>(index[i].length * sizeof(std::int16_t)));
+        written = index[i].offset + index[i].length * sizeof(std::int16_t);
+    }
+
+    if (!file) {
+        return fail(errorMessage, "Failed to write sample bank: " + path);
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef SAMPLEBANK_H
+#define SAMPLEBANK_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mappedfile.h"
+#include "wavfile.h"
+
+// Packed sample bank: every sample's PCM in one file behind a fixed index, so
+// startup is one open and one mmap instead of a path probe and a WAV parse per key.
+// The index is a sample set (see sampleset.h): each entry names its note, velocity
+// layer and round-robin alternate.
+//
+// Layout (host byte order; all supported targets are little-endian):
+//   SampleBankHeader
+//   SampleBankEntry[entryCount]
+//   PCM for each entry, 16-bit interleaved, starting on an `alignment` boundary
+// Page-aligned PCM means each note faults in independently of its neighbours.
+struct SampleBankHeader {
+    char magic[8];  // "PNOBANK\0"
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t alignment;  // Of every entry's PCM offset
+    std::uint32_t reserved;
+    std::uint64_t fileSize;  // Detects truncated files
+};
+
+struct SampleBankEntry {
+    std::int32_t note;  // MIDI note number
+    std::uint32_t sampleRate;
+    std::uint32_t channels;
+    std::uint8_t velocity;  // Top of the entry's velocity layer, 0 = 127 (banks without layers)
+    std::uint8_t alternate;  // Round-robin order within the layer
+    std::uint16_t reserved;
+    std::uint64_t offset;  // Bytes from the start of the file
+    std::uint64_t length;  // Interleaved samples
+    std::int32_t loopStart;  // Sustain loop in frames (end exclusive), -1 if none
+    std::int32_t loopEnd;
+};
+
+static_assert(sizeof(SampleBankHeader) == 32, "bank header layout");
+static_assert(sizeof(SampleBankEntry) == 40, "bank entry layout");
+
+inline int bankVelocity(const SampleBankEntry &entry)
+{
+    return entry.velocity == 0 ? 127 : entry.velocity;
+}
+
+// Read side: maps the whole bank and validates the index; PCM stays in the mapping
+class SampleBank {
+public:
+    static const std::uint32_t version = 1;
+    static const std::uint32_t alignment = 4096;
+
+    bool open(const std::string &path, std::string *errorMessage = nullptr);
+
+    const std::vector<SampleBankEntry> &entries() const { return index; }
+    const std::int16_t *pcm(const SampleBankEntry &entry) const
+    {
+        return reinterpret_cast<const std::int16_t *>(file->data() + entry.offset);
+    }
+    // Shared with every sample that points into the bank
+    const std::shared_ptr<MappedFile> &mapping() const { return file; }
+
+private:
+    std::shared_ptr<MappedFile> file;
+    std::vector<SampleBankEntry> index;
+};
+
+// Write side (used by the pianobank tool)
+struct SampleBankInput {
+    int note;
+    int velocity = 127;
+    int alternate = 0;
+    WavData wav;
+};
+bool writeSampleBank(const std::string &path, const std::vector<SampleBankInput> &samples,
+                     std::string *errorMessage = nullptr);
+
+#endif // SAMPLEBANK_H
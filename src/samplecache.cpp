@@ -0,0 +1,212 @@
+#include "samplecache.h"
+#include "mixkernels.h"
+#include "resampler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace {
+
+// Cache file header, written in host order (all supported targets are little-endian)
+struct CacheHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t sourceHash;
+    std::uint32_t sampleRate;
+    std::uint32_t channels;
+    std::int32_t loopStart;
+    std::int32_t loopEnd;
+    std::uint64_t sampleCount;
+};
+
+const char cacheMagic[4] = {'P', 'N', 'O', 'C'};
+const std::uint32_t cacheVersion = 3;  // Bump when the conversion changes
+
+// 64-bit FNV-1a
+std::uint64_t hashBytes(const unsigned char *bytes, std::size_t size)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Loop points move with the timeline when the rate changes
+void scaleLoop(int &loopStart, int &loopEnd, int fromRate, int toRate, int frames)
+{
+    if (loopStart >= 0) {
+        loopStart = static_cast<int>(static_cast<std::int64_t>(loopStart) * toRate / fromRate);
+        loopEnd = std::min(frames, static_cast<int>(static_cast<std::int64_t>(loopEnd) * toRate / fromRate));
+    }
+}
+
+} // namespace
+
+SampleCache::SampleCache(const std::string &directory)
+    : cacheDirectory(directory), hitCount(0), missCount(0)
+{
+}
+
+bool SampleCache::load(const std::string &path, int sampleRate, int channels, WavData &wav,
+                       std::string *errorMessage)
+{
+    std::vector<unsigned char> bytes;
+    if (!readFileBytes(path, bytes, nullptr)) {
+        if (errorMessage) {
+            *errorMessage = "Failed to open WAV file: " + path;
+        }
+        return false;
+    }
+    return load(bytes.data(), bytes.size(), path, sampleRate, channels, wav, errorMessage);
+}
+
+bool SampleCache::load(const unsigned char *bytes, std::size_t size, const std::string &name,
+                       int sampleRate, int channels, WavData &wav, std::string *errorMessage)
+{
+    if (!parseWavData(bytes, size, wav, name, errorMessage)) {
+        return false;
+    }
+    readLoopSidecar(name, static_cast<int>(wav.samples.size() / wav.channels), wav.loopStart, wav.loopEnd);
+    if (wav.sampleRate == sampleRate && wav.channels == channels) {
+        return true;  // Already in the target format: nothing to convert or cache
+    }
+
+    const std::uint64_t sourceHash = hashBytes(bytes, size);
+    const std::string cached = cachePath(sourceHash, sampleRate, channels);
+    const int sourceRate = wav.sampleRate;
+    const int loopStart = wav.loopStart;
+    const int loopEnd = wav.loopEnd;
+    if (!cached.empty() && readCached(cached, sourceHash, sampleRate, channels, wav)) {
+        // The loop comes from the source, whose sidecar may have changed since the file was cached
+        wav.loopStart = loopStart;
+        wav.loopEnd = loopEnd;
+        scaleLoop(wav.loopStart, wav.loopEnd, sourceRate, sampleRate,
+                  static_cast<int>(wav.samples.size() / channels));
+        ++hitCount;
+        return true;
+    }
+
+    ++missCount;
+    convertSampleFormat(wav, sampleRate, channels);
+    if (!cached.empty()) {
+        writeCached(cached, sourceHash, wav);
+    }
+    return true;
+}
+
+std::string SampleCache::cachePath(std::uint64_t sourceHash, int sampleRate, int channels) const
+{
+    if (cacheDirectory.empty()) {
+        return std::string();
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%016llx-%d-%d.pcm",
+                  static_cast<unsigned long long>(sourceHash), sampleRate, channels);
+    return cacheDirectory + name;
+}
+
+bool SampleCache::readCached(const std::string &path, std::uint64_t sourceHash, int sampleRate, int channels,
+                             WavData &wav) const
+{
+    std::ifstream file(path, std::ios::binary);
+    CacheHeader header;
+    if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion ||
+        header.sourceHash != sourceHash || header.sampleRate != static_cast<std::uint32_t>(sampleRate) ||
+        header.channels != static_cast<std::uint32_t>(channels)) {
+        return false;
+    }
+
+    wav.samples.resize(static_cast<std::size_t>(header.sampleCount));
+    if (!file.read(reinterpret_cast<char *>(wav.samples.data()),
+                   static_cast<std::streamsize>(wav.samples.size() * sizeof(std::int16_t)))) {
+        return false;  // Truncated: treat as a miss and rewrite it
+    }
+    wav.sampleRate = sampleRate;
+    wav.channels = channels;
+    wav.loopStart = header.loopStart;
+    wav.loopEnd = header.loopEnd;
+    return true;
+}
+
+void SampleCache::writeCached(const std::string &path, std::uint64_t sourceHash, const WavData &wav) const
+{
+    CacheHeader header;
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.sourceHash = sourceHash;
+    header.sampleRate = static_cast<std::uint32_t>(wav.sampleRate);
+    header.channels = static_cast<std::uint32_t>(wav.channels);
+    header.loopStart = wav.loopStart;
+    header.loopEnd = wav.loopEnd;
+    header.sampleCount = wav.samples.size();
+
+    // Write under a temporary name and rename, so a concurrent or interrupted
+    // load never sees a half-written file. Failures just mean no cache next time.
+    std::string temporary = path + ".tmp";
+    {
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".%zx",
+                      std::hash<std::thread::id>()(std::this_thread::get_id()));
+        temporary += suffix;
+    }
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(wav.samples.data()),
+               static_cast<std::streamsize>(wav.samples.size() * sizeof(std::int16_t)));
+    file.close();
+    if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+    }
+}
+
+void convertSampleFormat(WavData &wav, int sampleRate, int channels)
+{
+    if (wav.channels <= 0 || wav.sampleRate <= 0 || channels <= 0 || sampleRate <= 0) {
+        return;
+    }
+
+    // Channels first, so the resampler works on the target layout
+    if (wav.channels != channels) {
+        const std::size_t frameCount = wav.samples.size() / wav.channels;
+        std::vector<std::int16_t> converted(frameCount * channels);
+        for (std::size_t frame = 0; frame < frameCount; ++frame) {
+            const std::int16_t *src = wav.samples.data() + frame * wav.channels;
+            for (int ch = 0; ch < channels; ++ch) {
+                converted[frame * channels + ch] = src[std::min(ch, wav.channels - 1)];
+            }
+        }
+        wav.samples.swap(converted);
+        wav.channels = channels;
+    }
+
+    if (wav.sampleRate != sampleRate) {
+        const int sourceFrames = static_cast<int>(wav.samples.size() / channels);
+        const std::uint64_t step = resampleStep(wav.sampleRate, sampleRate);
+        const int outputFrames = static_cast<int>(
+            ((static_cast<std::uint64_t>(sourceFrames) << 32) + step - 1) / step);
+        const SincTable table(wav.sampleRate, sampleRate);
+
+        std::vector<float> mix(static_cast<std::size_t>(outputFrames) * channels, 0.0f);
+        int frame = 0;
+        std::uint32_t fraction = 0;
+        resampleMix(ResampleQuality::Sinc, &table, mix.data(), channels, outputFrames,
+                    wav.samples.data(), sourceFrames, channels, frame, fraction, step, 1.0f);
+
+        scaleLoop(wav.loopStart, wav.loopEnd, wav.sampleRate, sampleRate, outputFrames);
+
+        wav.samples.resize(mix.size());
+        mixKernels().saturate(wav.samples.data(), mix.data(), static_cast<int>(mix.size()));
+        wav.sampleRate = sampleRate;
+    }
+}
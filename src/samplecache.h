@@ -0,0 +1,53 @@
+#ifndef SAMPLECACHE_H
+#define SAMPLECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "wavfile.h"
+
+// Load-time conversion of samples to the output format, with an optional on-disk cache.
+//
+// Converting every sample to the device rate and channel count once means every
+// voice can take the engine's direct-mix path. Conversion uses the band-limited
+// sinc resampler, so it is too slow to repeat on every launch: the converted PCM
+// is written to the cache directory, keyed by a hash of the source file's bytes
+// and the target format, and read back on the next start.
+//
+// load() may be called from several threads at once.
+class SampleCache {
+public:
+    explicit SampleCache(const std::string &directory = std::string());
+
+    // Empty directory disables the on-disk cache (conversion still happens)
+    void setDirectory(const std::string &directory) { cacheDirectory = directory; }
+    const std::string &directory() const { return cacheDirectory; }
+
+    // Read a WAV file converted to sampleRate/channels. Files already in that format are
+    // returned as-is and counted as neither hit nor miss.
+    bool load(const std::string &path, int sampleRate, int channels, WavData &wav,
+              std::string *errorMessage = nullptr);
+    // Same, for a WAV file image already in memory (e.g. mapped); name is the file's path, used
+    // for messages and to find its loop sidecar
+    bool load(const unsigned char *bytes, std::size_t size, const std::string &name,
+              int sampleRate, int channels, WavData &wav, std::string *errorMessage = nullptr);
+
+    int hits() const { return hitCount.load(); }
+    int misses() const { return missCount.load(); }
+
+private:
+    std::string cachePath(std::uint64_t sourceHash, int sampleRate, int channels) const;
+    bool readCached(const std::string &path, std::uint64_t sourceHash, int sampleRate, int channels,
+                    WavData &wav) const;
+    void writeCached(const std::string &path, std::uint64_t sourceHash, const WavData &wav) const;
+
+    std::string cacheDirectory;
+    std::atomic<int> hitCount;
+    std::atomic<int> missCount;
+};
+
+// Convert decoded PCM in place to the given rate and channel count. Mono is copied to
+// every output channel; other channel changes keep the first channels (or repeat the last).
+void convertSampleFormat(WavData &wav, int sampleRate, int channels);
+
+#endif // SAMPLECACHE_H
@@ -0,0 +1,44 @@
+#include "sampleloop.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::unique_ptr<SampleLoop> buildSampleLoop(const std::int16_t *pcm, int frames, int channels,
+                                            int loopStart, int loopEnd, int crossfadeFrames)
+{
+    const int guard = SampleLoop::guardFrames;
+    const int loopFrames = loopEnd - loopStart;
+    if (!pcm || channels <= 0 || loopStart < 0 || loopEnd > frames || loopFrames < guard) {
+        return nullptr;
+    }
+
+    std::unique_ptr<SampleLoop> loop(new SampleLoop);
+    loop->channels = channels;
+    loop->loopFrames = loopFrames;
+    loop->pcm.resize(static_cast<std::size_t>(guard + loopFrames + guard) * channels);
+    std::int16_t *body = loop->pcm.data() + guard * channels;
+    std::copy(pcm + static_cast<std::size_t>(loopStart) * channels,
+              pcm + static_cast<std::size_t>(loopEnd) * channels, body);
+
+    // Linear crossfade (the two sides are the same note, close to in phase) from the end of the
+    // loop into the audio just before its start, which is what the start follows on from
+    const int fade = std::min({crossfadeFrames, loopStart, loopFrames / 2});
+    const std::int16_t *lead = pcm + static_cast<std::size_t>(loopStart - fade) * channels;
+    std::int16_t *tail = body + static_cast<std::size_t>(loopFrames - fade) * channels;
+    for (int frame = 0; frame < fade; ++frame) {
+        const float weight = (frame + 0.5f) / fade;
+        for (int ch = 0; ch < channels; ++ch) {
+            const int i = frame * channels + ch;
+            tail[i] = static_cast<std::int16_t>(std::lround(tail[i] + (lead[i] - tail[i]) * weight));
+        }
+    }
+
+    // Guards: the end of the body before it, its start after it
+    std::copy(body + static_cast<std::size_t>(loopFrames - guard) * channels,
+              body + static_cast<std::size_t>(loopFrames) * channels, loop->pcm.data());
+    std::copy(body, body + guard * channels, body + static_cast<std::size_t>(loopFrames) * channels);
+
+    loop->entryFrame = loopEnd - fade;
+    loop->entryPosition = guard + loopFrames - fade;
+    return loop;
+}
@@ -0,0 +1,35 @@
+#ifndef SAMPLELOOP_H
+#define SAMPLELOOP_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Sustain loop of a sample, prepared at load time for playback.
+//
+// The loop body [loopStart, loopEnd) is copied out with a crossfade baked into its
+// last frames: they blend from the original audio into the frames that lead up to
+// loopStart, so jumping from the end of the body back to its start continues the
+// waveform seamlessly. A sustained voice moves from the sample into this buffer
+// where the crossfade begins (the audio is identical up to there) and then wraps
+// inside it, reading it with the same direct-mix or resampling kernels as any
+// other sample data. Guard frames on both sides hold what comes before and after
+// a wrap, so interpolation across the seam needs no special case.
+struct SampleLoop {
+    static const int guardFrames = 8;  // Reach of the widest interpolator (half the sinc taps)
+    static constexpr double defaultCrossfadeMs = 20.0;
+
+    std::vector<std::int16_t> pcm;  // guardFrames, the crossfaded body, guardFrames (interleaved)
+    int channels = 0;
+    int loopFrames = 0;  // Body length; frames guardFrames .. guardFrames + loopFrames - 1 of pcm
+    int entryFrame = 0;  // Frame of the sample where the crossfade begins and voices move in
+    int entryPosition = 0;  // The same frame in pcm
+};
+
+// Builds the loop [loopStart, loopEnd) of frames of interleaved pcm, crossfading over up to
+// crossfadeFrames (limited by the audio before loopStart and half the loop). Returns null
+// if the loop doesn't fit the sample or is shorter than the guard.
+std::unique_ptr<SampleLoop> buildSampleLoop(const std::int16_t *pcm, int frames, int channels,
+                                            int loopStart, int loopEnd, int crossfadeFrames);
+
+#endif // SAMPLELOOP_H
@@ -0,0 +1,145 @@
+#include "sampleset.h"
+#include "notenames.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+
+static bool zoneOrder(const SampleZone &a, const SampleZone &b)
+{
+    if (a.note != b.note) {
+        return a.note < b.note;
+    }
+    if (a.velocity != b.velocity) {
+        return a.velocity < b.velocity;
+    }
+    return a.alternate < b.alternate;
+}
+
+int dynamicVelocity(const std::string &marking)
+{
+    static const struct {
+        const char *marking;
+        int velocity;
+    } layers[] = {
+        {"ppp", 16}, {"pp", 32}, {"p", 48}, {"mp", 64}, {"mf", 80}, {"f", 96}, {"ff", 112}, {"fff", 127}
+    };
+    for (const auto &layer : layers) {
+        if (marking == layer.marking) {
+            return layer.velocity;
+        }
+    }
+    return 0;
+}
+
+void SampleSet::add(int note, int velocity, int alternate, const std::string &path)
+{
+    if (note < 0 || note > 127) {
+        return;
+    }
+    SampleZone zone;
+    zone.note = note;
+    zone.velocity = std::clamp(velocity, 1, 127);
+    zone.alternate = alternate;
+    zone.path = path;
+    zoneList.insert(std::upper_bound(zoneList.begin(), zoneList.end(), zone, zoneOrder), std::move(zone));
+}
+
+// "<instrument>.<dynamic>.<note>[.<n>].wav" -> zone fields; false for any other name
+static bool parseFileName(const std::string &name, const std::string &instrument, int &note,
+                          int &velocity, int &alternate)
+{
+    static const std::string extension = ".wav";
+    if (name.size() <= instrument.size() + extension.size() || name.compare(0, instrument.size(), instrument) != 0 ||
+        name[instrument.size()] != '.' ||
+        name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+        return false;
+    }
+
+    // Split what's between the instrument and the extension at the dots
+    std::vector<std::string> fields;
+    const std::string middle = name.substr(instrument.size() + 1,
+                                           name.size() - instrument.size() - 1 - extension.size());
+    std::size_t start = 0;
+    for (std::size_t dot = middle.find('.'); ; dot = middle.find('.', start)) {
+        fields.push_back(middle.substr(start, dot - start));
+        if (dot == std::string::npos) {
+            break;
+        }
+        start = dot + 1;
+    }
+    if (fields.size() < 2 || fields.size() > 3) {
+        return false;
+    }
+
+    velocity = dynamicVelocity(fields[0]);
+    note = noteNumberFromName(fields[1]);
+    alternate = 0;
+    if (fields.size() == 3) {
+        char *end = nullptr;
+        const long number = std::strtol(fields[2].c_str(), &end, 10);
+        if (fields[2].empty() || *end != '\0' || number < 1) {
+            return false;
+        }
+        alternate = static_cast<int>(number) - 1;  // Files count alternates from 1
+    }
+    return velocity > 0 && note >= 0;
+}
+
+bool SampleSet::scanDirectory(const std::string &directory, const std::string &instrument,
+                              std::string *errorMessage)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+        if (errorMessage) {
+            *errorMessage = "Failed to read sample directory " + directory + ": " + std::strerror(errno);
+        }
+        return false;
+    }
+    // Only names are looked at, so thousands of files cost one pass over the directory
+    while (const dirent *entry = readdir(dir)) {
+        int note, velocity, alternate;
+        if (parseFileName(entry->d_name, instrument, note, velocity, alternate)) {
+            SampleZone zone;
+            zone.note = note;
+            zone.velocity = velocity;
+            zone.alternate = alternate;
+            zone.path = directory + "/" + entry->d_name;
+            zoneList.push_back(std::move(zone));
+        }
+    }
+    closedir(dir);
+    std::sort(zoneList.begin(), zoneList.end(), zoneOrder);  // Directory order is arbitrary
+    return true;
+}
+
+SampleSet SampleSet::subset(const std::vector<int> &notes) const
+{
+    SampleSet result;
+    for (const SampleZone &zone : zoneList) {
+        if (std::find(notes.begin(), notes.end(), zone.note) != notes.end()) {
+            result.zoneList.push_back(zone);
+        }
+    }
+    return result;
+}
+
+SampleSet SampleSet::sparse(int interval) const
+{
+    SampleSet result;
+    if (zoneList.empty() || interval <= 1) {
+        result.zoneList = zoneList;
+        return result;
+    }
+    // The highest note stays too, or the top keys would be out of shifting range
+    const int lowest = zoneList.front().note;
+    const int highest = zoneList.back().note;
+    for (const SampleZone &zone : zoneList) {
+        if ((zone.note - lowest) % interval == 0 || zone.note == highest) {
+            result.zoneList.push_back(zone);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,53 @@
+#ifndef SAMPLESET_H
+#define SAMPLESET_H
+
+#include <string>
+#include <vector>
+
+// One recording in a sample set: the file that plays `note` in the velocity layer
+// whose top is `velocity`. A layer covers the velocities above the next softer
+// layer of the same note up to its own top; the loudest layer also covers
+// everything above. Several zones with the same note and velocity are round-robin
+// alternates, played in turn (in `alternate` order).
+struct SampleZone {
+    int note;  // MIDI note number
+    int velocity;  // Top of the layer, 1-127
+    int alternate;  // Order within the layer
+    std::string path;
+};
+
+// Which files play which notes at which velocities (the engine's sample-set model).
+//
+// A directory is described by its file names, "<instrument>.<dynamic>.<note>.wav"
+// with an optional alternate number before the extension:
+//   Piano.ff.C4.wav, Piano.mf.Db4.wav, Piano.pp.Db4.2.wav
+// The dynamic marking (ppp .. fff) sets the layer's top velocity. A directory of
+// fortissimo-only files gives one layer per note covering every velocity.
+class SampleSet {
+public:
+    // Notes outside 0-127 are ignored; velocity is clamped to 1-127
+    void add(int note, int velocity, int alternate, const std::string &path);
+    // Adds every sample file of `instrument` in directory (one readdir, no file is opened).
+    // Returns false if the directory can't be read.
+    bool scanDirectory(const std::string &directory, const std::string &instrument = "Piano",
+                       std::string *errorMessage = nullptr);
+    // Only the zones of the given notes (e.g. the ones a script plays)
+    SampleSet subset(const std::vector<int> &notes) const;
+    // Only the notes a whole number of intervals above the lowest one (3 = every minor third,
+    // 4 = every major third), and the highest; for a fully sampled set, PianoEngine::setPitchShiftRange with
+    // interval / 2 lets the engine pitch-shift the notes in between
+    SampleSet sparse(int interval) const;
+
+    // Sorted by note, then velocity, then alternate
+    const std::vector<SampleZone> &zones() const { return zoneList; }
+    bool empty() const { return zoneList.empty(); }
+    std::size_t size() const { return zoneList.size(); }
+
+private:
+    std::vector<SampleZone> zoneList;
+};
+
+// Top velocity of a dynamic marking's layer ("pp" -> 32, "ff" -> 112), 0 if unknown
+int dynamicVelocity(const std::string &marking);
+
+#endif // SAMPLESET_H
@@ -0,0 +1,112 @@
+#include "unacordafilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define UNACORDAFILTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Below this (16-bit sample units) the filter's tail on an empty bus counts as silent
+static const double silence = 1e-3;
+
+UnaCordaFilter::UnaCordaFilter()
+    : channels(2), alpha(0.0), active(false)
+{
+    setup(44100, 2);
+}
+
+void UnaCordaFilter::setup(int sampleRate, int channelCount)
+{
+    channels = std::max(1, channelCount);
+    const double dt = 1.0 / sampleRate;
+    const double rc = 1.0 / (2.0 * M_PI * cutoffHz);
+    alpha = dt / (dt + rc);
+    state.assign(channels, 0.0);
+    active = false;
+}
+
+void UnaCordaFilter::reset()
+{
+    std::fill(state.begin(), state.end(), 0.0);
+    active = false;
+}
+
+void UnaCordaFilter::process(float *mix, int frames, double startLevel, double endLevel)
+{
+    if (startLevel <= 0.0 && endLevel <= 0.0) {
+        active = false;  // Dry: the state is primed again when the pedal comes back
+        return;
+    }
+    run(mix, frames, startLevel, (endLevel - startLevel) / frames, endLevel);
+}
+
+bool UnaCordaFilter::processWet(float *mix, int frames, bool written)
+{
+    if (!written) {
+        if (!active) {
+            return false;
+        }
+        std::fill(mix, mix + frames * channels, 0.0f);  // Just the tail of what was on the bus
+    }
+    run(mix, frames, 1.0, 0.0, 1.0);
+    if (!written) {
+        double tail = 0.0;
+        for (double value : state) {
+            tail = std::max(tail, std::abs(value));
+        }
+        active = tail >= silence;
+    }
+    return true;
+}
+
+void UnaCordaFilter::run(float *mix, int frames, double startLevel, double levelStep, double endLevel)
+{
+    if (frames <= 0) {
+        return;
+    }
+    if (!active) {
+        std::copy(mix, mix + channels, state.begin());
+        active = true;
+    }
+    const double decay = 1.0 - alpha;
+
+    // The level of frame n is startLevel + levelStep * (n + 1), landing exactly on endLevel;
+    // fully wet frames skip the blend
+#ifdef UNACORDAFILTER_SSE2
+    if (channels == 2) {
+        const __m128d alphas = _mm_set1_pd(alpha);
+        const __m128d decays = _mm_set1_pd(decay);
+        const __m128d gains = _mm_set1_pd(gain);
+        __m128d filtered = _mm_loadu_pd(state.data());
+        float *out = mix;
+        for (int frame = 0; frame < frames; ++frame, out += 2) {
+            const double level = frame + 1 < frames ? startLevel + levelStep * (frame + 1) : endLevel;
+            const __m128d sample = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<__m128i *>(out))));
+            filtered = _mm_add_pd(_mm_mul_pd(alphas, sample), _mm_mul_pd(decays, filtered));
+            const __m128d wet = _mm_mul_pd(filtered, gains);
+            const __m128d result = level == 1.0
+                ? wet : _mm_add_pd(sample, _mm_mul_pd(_mm_sub_pd(wet, sample), _mm_set1_pd(level)));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_castps_si128(_mm_cvtpd_ps(result)));
+        }
+        _mm_storeu_pd(state.data(), filtered);
+        return;
+    }
+#endif
+    double *filtered = state.data();
+    float *out = mix;
+    for (int frame = 0; frame < frames; ++frame, out += channels) {
+        const double level = frame + 1 < frames ? startLevel + levelStep * (frame + 1) : endLevel;
+        for (int channel = 0; channel < channels; ++channel) {
+            const double sample = out[channel];
+            filtered[channel] = alpha * sample + decay * filtered[channel];
+            const double wet = filtered[channel] * gain;
+            out[channel] = static_cast<float>(level == 1.0 ? wet : sample + (wet - sample) * level);
+        }
+    }
+}
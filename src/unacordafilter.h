@@ -0,0 +1,49 @@
+#ifndef UNACORDAFILTER_H
+#define UNACORDAFILTER_H
+
+#include <vector>
+
+// The una corda's muted tone: a one-pole low-pass (about 2500 Hz) and a 21% level drop,
+// blended with the dry signal by the pedal's amount.
+//
+// The coefficient is computed once per output format, not per block. The blend level
+// ramps linearly across each block from where the last one left it, so pressing the
+// pedal (or easing it part way) fades the filter in and out instead of switching it.
+// While the level is 0 the filter doesn't run; when it comes back, its state starts
+// from the first dry frame rather than from zero, so the filtered signal joins the dry
+// one where it is instead of rising from silence.
+//
+// The recurrence runs across frames, so it can't be vectorized along the block; in
+// stereo both channels run side by side in one SSE2 register instead (same operations
+// in the same order as the scalar loop, so the results are identical).
+class UnaCordaFilter {
+public:
+    static constexpr double cutoffHz = 2500.0;
+    static constexpr double gain = 0.79;
+
+    UnaCordaFilter();
+
+    // Setup (not real-time safe): computes the coefficient for the rate and clears the state
+    void setup(int sampleRate, int channels);
+    void reset();
+
+    // Filters frames of interleaved mix (16-bit sample units) in place, blended with the dry
+    // signal by a level going linearly from startLevel (just before the first frame) to
+    // endLevel (at the last). Nothing happens while both are 0.
+    void process(float *mix, int frames, double startLevel, double endLevel);
+
+    // Fully filtered, for a bus that only carries una corda voices. A bus with nothing on it
+    // (written false) is filled with the filter's decaying tail until that falls silent.
+    // Returns whether the bus holds anything.
+    bool processWet(float *mix, int frames, bool written);
+
+private:
+    void run(float *mix, int frames, double startLevel, double levelStep, double endLevel);
+
+    int channels;
+    double alpha;  // dt / (dt + RC), RC = 1 / (2 pi cutoff)
+    std::vector<double> state;  // Last output, per channel
+    bool active;  // State holds the filter's history (false: primed from the next frame)
+};
+
+#endif // UNACORDAFILTER_H
@@ -0,0 +1,41 @@
+#include "virtualmidiinput.h"
+#include "noteeventqueue.h"
+
+VirtualMidiInput::VirtualMidiInput()
+    : running(false)
+{
+}
+
+VirtualMidiInput::~VirtualMidiInput()
+{
+    stop();
+}
+
+bool VirtualMidiInput::start(PianoEngine *target, const std::string &portName, std::string *errorMessage)
+{
+    if (!target) {
+        if (errorMessage) {
+            *errorMessage = "No engine for the virtual MIDI input";
+        }
+        return false;
+    }
+    engine = target;
+    port = portName.empty() ? "virtual" : portName;
+    resetParser();
+    running = true;
+    return true;
+}
+
+void VirtualMidiInput::stop()
+{
+    running = false;
+}
+
+bool VirtualMidiInput::send(const std::uint8_t *bytes, int count, std::uint64_t timestamp)
+{
+    if (!running) {
+        return false;
+    }
+    receive(bytes, count, timestamp != 0 ? timestamp : NoteEvent::now());
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef VIRTUALMIDIINPUT_H
+#define VIRTUALMIDIINPUT_H
+
+#include "midiinput.h"
+
+// A MIDI input without a device: the program itself sends it raw MIDI bytes, which go
+// through the same parsing and delivery as a device's. The thread calling send() takes
+// the place of the input thread (one thread at a time). Runs anywhere - for tests,
+// benchmarks and scripted input. The port name is only kept for description().
+class VirtualMidiInput : public MidiInput {
+public:
+    VirtualMidiInput();
+    ~VirtualMidiInput() override;
+
+    const char *name() const override { return "virtual"; }
+    bool start(PianoEngine *engine, const std::string &port, std::string *errorMessage = nullptr) override;
+    void stop() override;
+    std::string description() const override { return "virtual port '" + port + "'"; }
+
+    // Raw MIDI bytes as if they had just arrived (timestamp 0: now). Returns false if the
+    // input isn't started.
+    bool send(const std::uint8_t *bytes, int count, std::uint64_t timestamp = 0);
+
+private:
+    std::string port;
+    bool running;
+};
+
+#endif // VIRTUALMIDIINPUT_H
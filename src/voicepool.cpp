@@ -0,0 +1,108 @@
+#include "voicepool.h"
+#include "mixkernels.h"
+
+VoicePool::VoicePool(int capacity)
+    : maxVoices(0), count(0), stealPolicy(StealOldest), nextStartOrder(0), stolen(0)
+{
+    setCapacity(capacity);
+}
+
+void VoicePool::setCapacity(int capacity)
+{
+    maxVoices = capacity > 0 ? capacity : 1;
+    count = 0;
+
+    data.assign(maxVoices, nullptr);
+    position.assign(maxVoices, 0);
+    fraction.assign(maxVoices, 0);
+    length.assign(maxVoices, 0);
+    resident.assign(maxVoices, 0);
+    stream.assign(maxVoices, -1);
+    step.assign(maxVoices, 0);
+    sincTable.assign(maxVoices, nullptr);
+    channels.assign(maxVoices, 0);
+    framesPlayed.assign(maxVoices, 0);
+    gain.assign(maxVoices, mixUnityGain);
+    envelopeStage.assign(maxVoices, Envelope::Sustain);
+    envelopeLevel.assign(maxVoices, 1.0f);
+    keyDown.assign(maxVoices, 0);
+    loop.assign(maxVoices, nullptr);
+    looping.assign(maxVoices, 0);
+    unaCorda.assign(maxVoices, 0);
+    note.assign(maxVoices, 0);
+    sample.assign(maxVoices, 0);
+    startOrder.assign(maxVoices, 0);
+}
+
+int VoicePool::allocate()
+{
+    int slot;
+    if (count < maxVoices) {
+        slot = count++;
+    } else {
+        slot = findVictim();
+        ++stolen;
+    }
+    startOrder[slot] = nextStartOrder++;
+    return slot;
+}
+
+void VoicePool::retire(int i)
+{
+    const int last = count - 1;
+    if (i != last) {
+        moveVoice(last, i);
+    }
+    count = last;
+}
+
+double VoicePool::level(int i) const
+{
+    return gain[i] * envelopeLevel[i];
+}
+
+void VoicePool::moveVoice(int from, int to)
+{
+    data[to] = data[from];
+    position[to] = position[from];
+    fraction[to] = fraction[from];
+    length[to] = length[from];
+    resident[to] = resident[from];
+    stream[to] = stream[from];
+    step[to] = step[from];
+    sincTable[to] = sincTable[from];
+    channels[to] = channels[from];
+    framesPlayed[to] = framesPlayed[from];
+    gain[to] = gain[from];
+    envelopeStage[to] = envelopeStage[from];
+    envelopeLevel[to] = envelopeLevel[from];
+    keyDown[to] = keyDown[from];
+    loop[to] = loop[from];
+    looping[to] = looping[from];
+    unaCorda[to] = unaCorda[from];
+    note[to] = note[from];
+    sample[to] = sample[from];
+    startOrder[to] = startOrder[from];
+}
+
+int VoicePool::findVictim() const
+{
+    int victim = 0;
+    if (stealPolicy == StealQuietest) {
+        double quietest = level(0);
+        for (int i = 1; i < count; ++i) {
+            const double current = level(i);
+            if (current < quietest || (current == quietest && startOrder[i] < startOrder[victim])) {
+                quietest = current;
+                victim = i;
+            }
+        }
+    } else {
+        for (int i = 1; i < count; ++i) {
+            if (startOrder[i] < startOrder[victim]) {
+                victim = i;
+            }
+        }
+    }
+    return victim;
+}
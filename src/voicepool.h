@@ -0,0 +1,83 @@
+#ifndef VOICEPOOL_H
+#define VOICEPOOL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "envelope.h"
+
+class SincTable;
+struct SampleLoop;
+
+// Fixed-capacity pool of playing voices in structure-of-arrays layout.
+//
+// Every field lives in its own contiguous array, indexed 0..size()-1, so the mixer
+// streams through exactly the fields it needs. All storage is allocated by
+// setCapacity(); allocate() and retire() never allocate or shift memory:
+// retirement moves the last voice into the freed slot (swap-and-pop), and when
+// the pool is full allocate() steals a voice according to the steal policy.
+class VoicePool {
+public:
+    enum StealPolicy {
+        StealOldest,   // Reuse the voice that started first
+        StealQuietest  // Reuse the voice with the lowest current level (ties: oldest)
+    };
+
+    explicit VoicePool(int capacity = 256);
+
+    // Setup (not real-time safe): drops all voices
+    void setCapacity(int capacity);
+    void setStealPolicy(StealPolicy policy) { stealPolicy = policy; }
+
+    int capacity() const { return maxVoices; }
+    int size() const { return count; }
+    StealPolicy policy() const { return stealPolicy; }
+    std::uint64_t stolenCount() const { return stolen; }
+
+    // Returns the slot for a new voice. If the pool is full, a voice is stolen
+    // (its slot is returned for reuse). Fields must be initialized by the caller.
+    int allocate();
+
+    // Removes voice i by moving the last voice into its slot. When iterating,
+    // walk indices downwards so the moved voice has already been visited.
+    void retire(int i);
+
+    void clear() { count = 0; }
+
+    // Current level of voice i (velocity gain times envelope), used for stealing
+    double level(int i) const;
+
+    // Per-voice fields (valid for indices 0..size()-1)
+    std::vector<const std::int16_t *> data;
+    std::vector<int> position;  // In samples (not frames)
+    std::vector<std::uint32_t> fraction;  // Fractional frame position when resampling (0.32 fixed point)
+    std::vector<int> length;  // In samples
+    std::vector<int> resident;  // Samples readable through data; the rest comes from the disk stream
+    std::vector<int> stream;  // DiskStreamer stream id, -1 if the voice doesn't stream
+    std::vector<std::uint64_t> step;  // 32.32 source frames per output frame (rate conversion and pitch shift)
+    std::vector<const SincTable *> sincTable;  // Sinc quality only, for the voice's effective rate
+    std::vector<int> channels;
+    std::vector<int> framesPlayed;  // Number of frames played so far (for 1-second cutoff)
+    std::vector<float> gain;  // Velocity as linear gain (mixUnityGain = full velocity)
+    std::vector<Envelope::Stage> envelopeStage;
+    std::vector<float> envelopeLevel;  // Envelope gain on top of the velocity gain (0..1)
+    std::vector<std::uint8_t> keyDown;  // Key still held: no note-off yet and within the cutoff
+    std::vector<const SampleLoop *> loop;  // The sample's sustain loop, null if it has none
+    std::vector<std::uint8_t> looping;  // Playing the loop: data and position refer to loop->pcm
+    std::vector<std::uint8_t> unaCorda;  // Struck with the una corda down (per-voice una corda): mixed muted
+    std::vector<std::int16_t> note;  // MIDI note number
+    std::vector<int> sample;  // Slot of the sample being played (layer and alternate)
+    std::vector<std::uint64_t> startOrder;  // Monotonic counter at allocation (for oldest-first stealing)
+
+private:
+    void moveVoice(int from, int to);
+    int findVictim() const;
+
+    int maxVoices;
+    int count;
+    StealPolicy stealPolicy;
+    std::uint64_t nextStartOrder;
+    std::uint64_t stolen;
+};
+
+#endif // VOICEPOOL_H
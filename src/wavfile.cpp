@@ -0,0 +1,253 @@
+#include "wavfile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static std::uint16_t readLe16(const unsigned char *p)
+{
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+static std::uint32_t readLe32(const unsigned char *p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+static void writeLe16(std::ofstream &file, std::uint16_t value)
+{
+    const unsigned char bytes[2] = {
+        static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8)
+    };
+    file.write(reinterpret_cast<const char *>(bytes), 2);
+}
+
+static void writeLe32(std::ofstream &file, std::uint32_t value)
+{
+    const unsigned char bytes[4] = {
+        static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+        static_cast<unsigned char>(value >> 16), static_cast<unsigned char>(value >> 24)
+    };
+    file.write(reinterpret_cast<const char *>(bytes), 4);
+}
+
+static bool fail(std::string *errorMessage, const std::string &message)
+{
+    if (errorMessage) {
+        *errorMessage = message;
+    }
+    return false;
+}
+
+bool readFileBytes(const std::string &path, std::vector<unsigned char> &bytes, std::string *errorMessage)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return fail(errorMessage, "Failed to open file: " + path);
+    }
+    const std::streamsize size = file.tellg();
+    file.seekg(0);
+    bytes.resize(static_cast<std::size_t>(size));
+    if (!file.read(reinterpret_cast<char *>(bytes.data()), size)) {
+        return fail(errorMessage, "Failed to read file: " + path);
+    }
+    return true;
+}
+
+bool readWavFile(const std::string &path, WavData &wav, std::string *errorMessage)
+{
+    std::vector<unsigned char> bytes;
+    if (!readFileBytes(path, bytes, nullptr)) {
+        return fail(errorMessage, "Failed to open WAV file: " + path);
+    }
+    if (!parseWavData(bytes.data(), bytes.size(), wav, path, errorMessage)) {
+        return false;
+    }
+    readLoopSidecar(path, static_cast<int>(wav.samples.size() / std::max(1, wav.channels)), wav.loopStart,
+                    wav.loopEnd);
+    return true;
+}
+
+bool readLoopSidecar(const std::string &wavPath, int frames, int &loopStart, int &loopEnd)
+{
+    const std::size_t dot = wavPath.rfind('.');
+    const std::size_t slash = wavPath.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return false;
+    }
+    std::ifstream file(wavPath.substr(0, dot) + ".loop");
+    long start = -1;
+    long end = -1;
+    if (!file || !(file >> start >> end) || start < 0 || end <= start || end > frames) {
+        return false;
+    }
+    loopStart = static_cast<int>(start);
+    loopEnd = static_cast<int>(end);
+    return true;
+}
+
+bool locateWavData(const unsigned char *bytes, std::size_t size, WavLayout &layout,
+                   const std::string &name, std::string *errorMessage)
+{
+    // RIFF header
+    if (size < 12 || std::memcmp(bytes, "RIFF", 4) != 0 || std::memcmp(bytes + 8, "WAVE", 4) != 0) {
+        return fail(errorMessage, "Invalid WAV file format: " + name);
+    }
+
+    // Walk the chunks once, picking up "fmt ", "data" and the optional "smpl"
+    bool foundFmt = false;
+    bool foundData = false;
+    std::size_t offset = 12;
+    while (offset + 8 <= size) {
+        const unsigned char *chunkHeader = bytes + offset;
+        const std::uint32_t chunkSize = readLe32(chunkHeader + 4);
+        const unsigned char *chunk = chunkHeader + 8;
+        const std::size_t available = size - offset - 8;
+
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+            if (chunkSize < 16 || available < 16) {
+                return fail(errorMessage, "Truncated fmt chunk in WAV file: " + name);
+            }
+            layout.channels = readLe16(chunk + 2);
+            layout.sampleRate = static_cast<int>(readLe32(chunk + 4));
+            const std::uint16_t bitsPerSample = readLe16(chunk + 14);
+            if (bitsPerSample != 16) {
+                return fail(errorMessage, "Only 16-bit PCM is supported: " + name);
+            }
+            foundFmt = true;
+        } else if (std::memcmp(chunkHeader, "data", 4) == 0) {
+            if (!foundFmt) {
+                return fail(errorMessage, "Could not find fmt chunk in WAV file: " + name);
+            }
+            // Tolerate files whose data chunk claims more than is actually present
+            layout.dataOffset = offset + 8;
+            layout.sampleCount = std::min<std::size_t>(chunkSize, available) / sizeof(std::int16_t);
+            foundData = true;
+        } else if (std::memcmp(chunkHeader, "smpl", 4) == 0 && chunkSize >= 60 && available >= 60) {
+            // Sampler chunk: 36-byte header, then 24-byte loop records. Only the first
+            // loop is used; its end frame is inclusive in the file.
+            const std::uint32_t loopCount = readLe32(chunk + 28);
+            if (loopCount > 0) {
+                const std::uint32_t start = readLe32(chunk + 36 + 8);
+                const std::uint32_t end = readLe32(chunk + 36 + 12);
+                if (start <= end && end < 0x7fffffffu) {
+                    layout.loopStart = static_cast<int>(start);
+                    layout.loopEnd = static_cast<int>(end) + 1;
+                }
+            }
+        }
+        // Next chunk (chunks are padded to an even size)
+        offset += 8 + static_cast<std::size_t>(chunkSize) + (chunkSize & 1);
+    }
+
+    if (foundData) {
+        // Drop loops that don't fit the audio
+        const int frames = static_cast<int>(layout.sampleCount / std::max(1, layout.channels));
+        if (layout.loopEnd > frames) {
+            layout.loopStart = layout.loopEnd = -1;
+        }
+        return true;
+    }
+    return fail(errorMessage, foundFmt ? "Could not find data chunk in WAV file: " + name
+                                       : "Could not find fmt chunk in WAV file: " + name);
+}
+
+bool parseWavData(const unsigned char *bytes, std::size_t size, WavData &wav,
+                  const std::string &name, std::string *errorMessage)
+{
+    WavLayout layout;
+    if (!locateWavData(bytes, size, layout, name, errorMessage)) {
+        return false;
+    }
+    wav.sampleRate = layout.sampleRate;
+    wav.channels = layout.channels;
+    wav.loopStart = layout.loopStart;
+    wav.loopEnd = layout.loopEnd;
+    wav.samples.resize(layout.sampleCount);
+    std::memcpy(wav.samples.data(), bytes + layout.dataOffset, layout.sampleCount * sizeof(std::int16_t));
+    return true;
+}
+
+// RIFF header of a 32-bit float WAV file whose data chunk holds frameCount frames
+static void writeFloatWavHeader(std::ofstream &file, std::size_t frameCount, int sampleRate, int channels)
+{
+    const std::uint32_t bytesPerSample = sizeof(float);
+    const std::uint32_t dataSize = static_cast<std::uint32_t>(frameCount * channels * bytesPerSample);
+
+    file.write("RIFF", 4);
+    writeLe32(file, 36 + dataSize);
+    file.write("WAVE", 4);
+
+    file.write("fmt ", 4);
+    writeLe32(file, 16);
+    writeLe16(file, 3);  // WAVE_FORMAT_IEEE_FLOAT
+    writeLe16(file, static_cast<std::uint16_t>(channels));
+    writeLe32(file, static_cast<std::uint32_t>(sampleRate));
+    writeLe32(file, static_cast<std::uint32_t>(sampleRate * channels * bytesPerSample));
+    writeLe16(file, static_cast<std::uint16_t>(channels * bytesPerSample));
+    writeLe16(file, 32);
+
+    file.write("data", 4);
+    writeLe32(file, dataSize);
+}
+
+bool writeWavFile(const std::string &path, const float *samples, std::size_t frameCount,
+                  int sampleRate, int channels, std::string *errorMessage)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return fail(errorMessage, "Failed to create WAV file: " + path);
+    }
+
+    writeFloatWavHeader(file, frameCount, sampleRate, channels);
+    // Samples are written in host order; all supported targets are little-endian
+    file.write(reinterpret_cast<const char *>(samples), frameCount * channels * sizeof(float));
+
+    if (!file) {
+        return fail(errorMessage, "Failed to write WAV file: " + path);
+    }
+    return true;
+}
+
+WavFileWriter::~WavFileWriter()
+{
+    close();
+}
+
+bool WavFileWriter::open(const std::string &path, int sampleRate, int channels, std::string *errorMessage)
+{
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return fail(errorMessage, "Failed to create WAV file: " + path);
+    }
+    filePath = path;
+    rate = sampleRate;
+    channelCount = channels;
+    frames = 0;
+    writeFloatWavHeader(file, 0, rate, channelCount);  // Sizes are filled in by close()
+    return true;
+}
+
+bool WavFileWriter::write(const float *samples, std::size_t frameCount)
+{
+    file.write(reinterpret_cast<const char *>(samples), frameCount * channelCount * sizeof(float));
+    frames += frameCount;
+    return static_cast<bool>(file);
+}
+
+bool WavFileWriter::close(std::string *errorMessage)
+{
+    if (!file.is_open()) {
+        return true;
+    }
+    file.seekp(0);
+    writeFloatWavHeader(file, frames, rate, channelCount);
+    const bool ok = static_cast<bool>(file);
+    file.close();
+    if (!ok) {
+        return fail(errorMessage, "Failed to write WAV file: " + filePath);
+    }
+    return true;
+}
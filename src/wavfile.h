@@ -0,0 +1,79 @@
+#ifndef WAVFILE_H
+#define WAVFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Decoded 16-bit PCM WAV file (interleaved samples)
+struct WavData {
+    std::vector<std::int16_t> samples;
+    int sampleRate = 0;
+    int channels = 0;
+    int loopStart = -1;  // First frame of the sustain loop from a "smpl" chunk, -1 if none
+    int loopEnd = -1;  // One past the last loop frame
+};
+
+// Read a 16-bit PCM WAV file (and its loop sidecar, if any). Returns false and fills
+// errorMessage (if given) on failure.
+bool readWavFile(const std::string &path, WavData &wav, std::string *errorMessage = nullptr);
+
+// Where the 16-bit PCM payload of a WAV file image lives
+struct WavLayout {
+    std::size_t dataOffset = 0;  // Bytes from the start of the file
+    std::size_t sampleCount = 0;  // Interleaved samples (frames * channels)
+    int sampleRate = 0;
+    int channels = 0;
+    int loopStart = -1;  // As in WavData
+    int loopEnd = -1;
+};
+
+// Validate the RIFF chunks of a WAV file in memory (e.g. a mapping) and locate its PCM
+// data without copying it; name is only used in error messages
+bool locateWavData(const unsigned char *bytes, std::size_t size, WavLayout &layout,
+                   const std::string &name, std::string *errorMessage = nullptr);
+
+// Parse a WAV file already in memory into owned samples
+bool parseWavData(const unsigned char *bytes, std::size_t size, WavData &wav,
+                  const std::string &name, std::string *errorMessage = nullptr);
+
+// Sustain loop from a sidecar text file next to a WAV file ("Piano.ff.C4.loop" for
+// "Piano.ff.C4.wav"): two frame numbers, start and end (exclusive), e.g. "52100 97300".
+// For recordings without a "smpl" chunk, or to override it. Leaves the loop unchanged and
+// returns false if there is no sidecar or it doesn't fit the given number of frames.
+bool readLoopSidecar(const std::string &wavPath, int frames, int &loopStart, int &loopEnd);
+
+// Read a whole file into memory
+bool readFileBytes(const std::string &path, std::vector<unsigned char> &bytes,
+                   std::string *errorMessage = nullptr);
+
+// Write interleaved float samples as a 32-bit IEEE float WAV file
+bool writeWavFile(const std::string &path, const float *samples, std::size_t frameCount,
+                  int sampleRate, int channels, std::string *errorMessage = nullptr);
+
+// The same format written a block at a time, for output of unknown length: the header
+// sizes are filled in when the file is closed
+class WavFileWriter {
+public:
+    WavFileWriter() = default;
+    ~WavFileWriter();
+
+    WavFileWriter(const WavFileWriter &) = delete;
+    WavFileWriter &operator=(const WavFileWriter &) = delete;
+
+    bool open(const std::string &path, int sampleRate, int channels, std::string *errorMessage = nullptr);
+    bool write(const float *samples, std::size_t frameCount);  // False once a write has failed
+    bool close(std::string *errorMessage = nullptr);
+    std::size_t frameCount() const { return frames; }
+
+private:
+    std::ofstream file;
+    std::string filePath;
+    int rate = 0;
+    int channelCount = 0;
+    std::size_t frames = 0;
+};
+
+#endif // WAVFILE_H
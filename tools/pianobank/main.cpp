@@ -0,0 +1,92 @@
+// pianobank - pack a directory's sample set into a single sample bank file
+//
+// Usage: pianobank [options]
+//   --samples <dir>     directory containing Piano.<dynamic>.<note>[.<n>].wav (default: src/NotesFF)
+//   -o <file.pnb>       output bank (default: <samples dir>/Piano.pnb)
+//   --rate <hz>         convert every sample to this rate (default: keep)
+//   --channels <n>      convert every sample to this channel count (default: keep)
+//
+// The app and pianorender (--bank) load the bank with one open and one mmap.
+// See src/samplebank.h for the file layout.
+
+#include "samplebank.h"
+#include "samplecache.h"
+#include "sampleset.h"
+#include "wavfile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    std::string samplesDir = "src/NotesFF";
+    std::string outputPath;
+    int sampleRate = 0;
+    int channels = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--samples") == 0 && hasValue) {
+            samplesDir = argv[++i];
+        } else if (std::strcmp(argv[i], "-o") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+            sampleRate = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--channels") == 0 && hasValue) {
+            channels = std::atoi(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--samples dir] [-o bank.pnb] [--rate hz] [--channels n]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (outputPath.empty()) {
+        outputPath = samplesDir + "/Piano.pnb";
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    SampleSet set;
+    std::string scanError;
+    if (!set.scanDirectory(samplesDir, "Piano", &scanError)) {
+        std::fprintf(stderr, "%s\n", scanError.c_str());
+        return 1;
+    }
+    std::vector<SampleBankInput> samples;
+    std::size_t totalBytes = 0;
+    for (const SampleZone &zone : set.zones()) {
+        SampleBankInput input;
+        input.note = zone.note;
+        input.velocity = zone.velocity;
+        input.alternate = zone.alternate;
+        std::string error;
+        if (!readWavFile(zone.path, input.wav, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (sampleRate > 0 || channels > 0) {
+            convertSampleFormat(input.wav, sampleRate > 0 ? sampleRate : input.wav.sampleRate,
+                                channels > 0 ? channels : input.wav.channels);
+        }
+        totalBytes += input.wav.samples.size() * sizeof(std::int16_t);
+        samples.push_back(std::move(input));
+    }
+    if (samples.empty()) {
+        std::fprintf(stderr, "No samples found in %s\n", samplesDir.c_str());
+        return 1;
+    }
+
+    std::string error;
+    if (!writeSampleBank(outputPath, samples, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::printf("Packed %zu samples (%.1f MB of PCM) into %s in %.1f ms\n",
+                samples.size(), totalBytes / (1024.0 * 1024.0), outputPath.c_str(), elapsedMs);
+    return 0;
+}
@@ -0,0 +1,15 @@
+# Sample bank builder: packs the per-note WAV files into one mmap-able bank file
+QT -= core gui
+CONFIG += console c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+
+TARGET = pianobank
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp
+
+include(../../src/engine.pri)
+
+DESTDIR = $$PWD/../../build
+OBJECTS_DIR = $$PWD/../../build/obj/pianobank
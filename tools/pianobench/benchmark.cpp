@@ -0,0 +1,137 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <thread>
+
+std::uint64_t benchmarkNow()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+bool matchesFilter(const std::string &name, const BenchmarkOptions &options)
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+void printResult(const BenchmarkOptions &options, const BenchmarkResult &result)
+{
+    std::fprintf(options.log, "%-52s", result.name.c_str());
+    for (const auto &metric : result.metrics) {
+        std::fprintf(options.log, "  %s=%.6g", metric.first.c_str(), metric.second);
+    }
+    if (!result.ok) {
+        std::fprintf(options.log, "  FAILED");
+    }
+    std::fprintf(options.log, "\n");
+    std::fflush(options.log);
+}
+
+void writeJson(std::FILE *file, const std::vector<BenchmarkResult> &results)
+{
+    char date[64];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    std::fprintf(file, "{\n  \"context\": {\n");
+    std::fprintf(file, "    \"date\": \"%s\",\n", date);
+    std::fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+    std::fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+    std::fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+    std::fprintf(file, "  },\n  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &result = results[i];
+        std::fprintf(file, "%s\n    {\n      \"name\": \"%s\",\n      \"ok\": %s",
+                     i == 0 ? "" : ",", result.name.c_str(), result.ok ? "true" : "false");
+        for (const auto &metric : result.metrics) {
+            std::fprintf(file, ",\n      \"%s\": %.9g", metric.first.c_str(), metric.second);
+        }
+        std::fprintf(file, "\n    }");
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+}
+
+double noteFrequency(int note)
+{
+    return 440.0 * std::pow(2.0, (note - 69) / 12.0);
+}
+
+std::vector<std::int16_t> makeTestSample(const TestTone &tone, int frames, int sampleRate)
+{
+    std::vector<std::int16_t> pcm(static_cast<size_t>(frames) * 2);
+    double weights = 0.0;
+    for (int partial = 1; partial <= tone.partials; ++partial) {
+        weights += 1.0 / partial;
+    }
+    const double twoPi = 2.0 * 3.14159265358979323846;
+    std::uint32_t noise = 0x12345678u + static_cast<std::uint32_t>(tone.frequency);
+    for (int i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / sampleRate;
+        double value = 0.0;
+        for (int partial = 1; partial <= tone.partials; ++partial) {
+            value += std::sin(twoPi * tone.frequency * partial * t) / partial;
+        }
+        value = value / weights * tone.level;
+        if (tone.noise > 0.0) {
+            noise = noise * 1664525u + 1013904223u;
+            value += ((noise >> 16) / 65536.0 - 0.5) * 2.0 * tone.noise;
+        }
+        if (tone.decay > 0.0) {
+            value *= std::exp(-tone.decay * t);
+        }
+        const auto sample = static_cast<std::int16_t>(std::lround(std::clamp(value, -32768.0, 32767.0)));
+        pcm[i * 2] = sample;
+        pcm[i * 2 + 1] = tone.invertRight ? static_cast<std::int16_t>(-std::max<int>(sample, -32767)) : sample;
+    }
+    return pcm;
+}
+
+bool writeTestWav(const std::string &path, int note, int frames, int sampleRate)
+{
+    TestTone tone;
+    tone.frequency = noteFrequency(note);
+    const std::vector<std::int16_t> pcm = makeTestSample(tone, frames, sampleRate);
+
+    const std::uint32_t dataSize = static_cast<std::uint32_t>(pcm.size() * sizeof(std::int16_t));
+    const std::uint32_t byteRate = sampleRate * 4;
+    const std::uint32_t riffSize = 36 + dataSize;
+    const std::uint32_t fmtSize = 16;
+    const std::uint16_t format = 1;
+    const std::uint16_t channels = 2;
+    const std::uint32_t rate = sampleRate;
+    const std::uint16_t blockAlign = 4;
+    const std::uint16_t bits = 16;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write("RIFF", 4);
+    file.write(reinterpret_cast<const char *>(&riffSize), 4);
+    file.write("WAVEfmt ", 8);
+    file.write(reinterpret_cast<const char *>(&fmtSize), 4);
+    file.write(reinterpret_cast<const char *>(&format), 2);
+    file.write(reinterpret_cast<const char *>(&channels), 2);
+    file.write(reinterpret_cast<const char *>(&rate), 4);
+    file.write(reinterpret_cast<const char *>(&byteRate), 4);
+    file.write(reinterpret_cast<const char *>(&blockAlign), 2);
+    file.write(reinterpret_cast<const char *>(&bits), 2);
+    file.write("data", 4);
+    file.write(reinterpret_cast<const char *>(&dataSize), 4);
+    file.write(reinterpret_cast<const char *>(pcm.data()), dataSize);
+    return static_cast<bool>(file);
+}
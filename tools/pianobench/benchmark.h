@@ -0,0 +1,73 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal Google-Benchmark style harness: named cases, a substring filter,
+// console or JSON output. Kept dependency-free so it builds anywhere the engine does.
+
+struct BenchmarkOptions {
+    std::string filter;  // Only run cases whose name contains this
+    int bufferFrames = 512;  // Frames per simulated device buffer
+    int buffers = 64;  // Timed buffers per repetition
+    int repetitions = 8;  // Repetitions per case (fresh voices each time)
+    std::uint64_t queueEvents = 5000000;  // Events pushed by queue_stress
+    std::uint64_t queuePeriodUs = 50;  // Simulated render period for queue_stress
+    std::string streamDir = "/tmp";  // Where stream/, layers/ and sparse/ write their test files
+    std::FILE *log = stdout;  // Human-readable per-case lines (stderr when JSON goes to stdout)
+};
+
+struct BenchmarkResult {
+    std::string name;
+    std::vector<std::pair<std::string, double>> metrics;  // Reported in insertion order
+    bool ok = true;  // False if the case detected an error (not just slowness)
+
+    void add(const std::string &key, double value) { metrics.emplace_back(key, value); }
+};
+
+// Wall-clock time in nanoseconds (steady clock)
+std::uint64_t benchmarkNow();
+
+// p in [0, 1]; reorders values
+double percentile(std::vector<double> &values, double p);
+
+bool matchesFilter(const std::string &name, const BenchmarkOptions &options);
+
+// Synthetic samples for the benchmarks: a tone of a few harmonics (the nth at 1/n of the
+// fundamental), scaled so the sum peaks at level, decaying exponentially, with optional
+// dither; 16-bit stereo.
+struct TestTone {
+    double frequency = 440.0;  // Fundamental, Hz
+    int partials = 1;
+    double decay = 0.0;  // Per second (0: steady)
+    double level = 3000.0;
+    double noise = 0.0;  // Dither amplitude, in LSB, decaying with the tone
+    bool invertRight = false;  // Right channel the inverse of the left (not a mono-compatible copy)
+};
+double noteFrequency(int note);  // Equal temperament, A4 = 440 Hz
+std::vector<std::int16_t> makeTestSample(const TestTone &tone, int frames, int sampleRate);
+
+// Minimal 16-bit stereo sine WAV at the note's pitch (the engine's writer produces float WAVs)
+bool writeTestWav(const std::string &path, int note, int frames, int sampleRate);
+
+void printResult(const BenchmarkOptions &options, const BenchmarkResult &result);
+void writeJson(std::FILE *file, const std::vector<BenchmarkResult> &results);
+
+// Benchmark families
+void runKernelBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runMixerBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runResampleBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runStreamBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runLayerBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runSparseBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runParallelBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runRealtimeChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runMidiChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runTimingChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+void runQueueStress(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,157 @@
+// kernels/<set>/<kernel>: throughput of each mixing kernel set available on this CPU.
+//
+// Before timing, every set is checked bit-for-bit against the scalar reference on
+// random data (odd lengths, full-scale samples, fractional mix values including
+// rounding ties, values far outside 16 bits, gain ramps over 1-3 channels); any
+// difference marks the case as failed.
+
+#include "benchmark.h"
+#include "mixkernels.h"
+
+#include <cstring>
+
+static std::uint32_t nextRandom(std::uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static std::int16_t randomSample(std::uint32_t &state)
+{
+    const std::uint32_t r = nextRandom(state);
+    switch (r & 15) {
+    case 0: return -32768;
+    case 1: return 32767;
+    default: return static_cast<std::int16_t>(r >> 16);
+    }
+}
+
+// Number of output values that differ from the scalar reference
+static long verifyKernels(const MixKernels &kernels)
+{
+    const MixKernels &reference = scalarMixKernels();
+    std::uint32_t state = 0x9e3779b9u;
+    long mismatches = 0;
+
+    for (int length = 0; length <= 1100; length += (length < 70 ? 1 : 257)) {
+        std::vector<std::int16_t> src(length + 1);
+        std::vector<float> base(length + 1);
+        for (int i = 0; i < length; ++i) {
+            src[i] = randomSample(state);
+            // Mix values up to ~8x full scale in quarter steps (so x.5 ties occur),
+            // and now and then far beyond int32 range, so saturation is exercised
+            const std::uint32_t r = nextRandom(state);
+            base[i] = ((r & 63) == 0) ? ((r & 64) ? 3e10f : -3e10f)
+                                      : static_cast<float>(static_cast<int>(r % 2097152u) - 1048576) * 0.25f;
+        }
+        const float gains[] = {0.0f, 1.0f / 32768.0f, 0.376739f, 0.79f, 0.999969f};
+        const int count = length - length / 5;  // store() with a zero tail
+
+        std::vector<float> expected = base, actual = base;
+        reference.accumulate(expected.data(), src.data(), length);
+        kernels.accumulate(actual.data(), src.data(), length);
+        mismatches += std::memcmp(expected.data(), actual.data(), length * sizeof(float)) != 0;
+
+        for (float gain : gains) {
+            expected = base;
+            actual = base;
+            reference.accumulateGain(expected.data(), src.data(), length, gain);
+            kernels.accumulateGain(actual.data(), src.data(), length, gain);
+            mismatches += std::memcmp(expected.data(), actual.data(), length * sizeof(float)) != 0;
+        }
+
+        // Ramps over mono, stereo and (scalar fallback) 3-channel frames, rising and falling
+        for (int channels = 1; channels <= 3; ++channels) {
+            for (float gainStep : {1.0f / 512.0f, -0.0123f}) {
+                expected = base;
+                actual = base;
+                reference.accumulateRamp(expected.data(), src.data(), length, channels, 0.376739f, gainStep);
+                kernels.accumulateRamp(actual.data(), src.data(), length, channels, 0.376739f, gainStep);
+                mismatches += std::memcmp(expected.data(), actual.data(), length * sizeof(float)) != 0;
+            }
+        }
+
+        expected = base;
+        actual = base;
+        reference.store(expected.data(), src.data(), count, length);
+        kernels.store(actual.data(), src.data(), count, length);
+        mismatches += std::memcmp(expected.data(), actual.data(), length * sizeof(float)) != 0;
+
+        std::vector<std::int16_t> expectedOut(length + 1), actualOut(length + 1);
+        reference.saturate(expectedOut.data(), base.data(), length);
+        kernels.saturate(actualOut.data(), base.data(), length);
+        mismatches += std::memcmp(expectedOut.data(), actualOut.data(), length * sizeof(std::int16_t)) != 0;
+    }
+    return mismatches;
+}
+
+void runKernelBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    const MixKernels *sets[] = {&scalarMixKernels(), sse2MixKernels(), avx2MixKernels()};
+    const char *kernelNames[] = {"accumulate", "accumulate_gain", "accumulate_ramp", "store", "saturate"};
+
+    // One buffer per voice, as in a 128-voice block, so the loop streams through memory
+    const int voices = 128;
+    const int samples = options.bufferFrames * 2;
+    std::vector<std::int16_t> voiceData(static_cast<size_t>(voices) * samples);
+    std::uint32_t state = 12345;
+    for (std::int16_t &sample : voiceData) {
+        sample = randomSample(state);
+    }
+    std::vector<float> mix(samples);
+    std::vector<std::int16_t> out(samples);
+
+    for (const MixKernels *kernels : sets) {
+        if (!kernels) {
+            continue;
+        }
+        long mismatches = -1;  // Verified lazily, once per set
+
+        for (int k = 0; k < 5; ++k) {
+            const std::string name = std::string("kernels/") + kernels->name + "/" + kernelNames[k];
+            if (!matchesFilter(name, options)) {
+                continue;
+            }
+            if (mismatches < 0) {
+                mismatches = verifyKernels(*kernels);
+            }
+
+            std::vector<double> times;
+            for (int rep = 0; rep < options.repetitions * options.buffers; ++rep) {
+                const std::uint64_t start = benchmarkNow();
+                for (int v = 0; v < voices; ++v) {
+                    const std::int16_t *src = voiceData.data() + static_cast<size_t>(v) * samples;
+                    switch (k) {
+                    case 0: kernels->accumulate(mix.data(), src, samples); break;
+                    case 1: kernels->accumulateGain(mix.data(), src, samples, 0.7071f); break;
+                    case 2: kernels->accumulateRamp(mix.data(), src, samples, 2, 0.7071f, -1.0f / 32768.0f); break;
+                    case 3: kernels->store(mix.data(), src, samples, samples); break;
+                    default: kernels->saturate(out.data(), mix.data(), samples); break;
+                    }
+                }
+                times.push_back(static_cast<double>(benchmarkNow() - start));
+            }
+
+            double total = 0.0;
+            for (double t : times) {
+                total += t;
+            }
+            const double meanNs = total / times.size();
+            const double sampleCount = static_cast<double>(voices) * samples;
+            // Bytes touched per sample: 2 in + 4 read-modify-write (accumulate), 2+4 (store), 4+2 (saturate)
+            const double bytesPerSample = (k <= 2) ? 10.0 : 6.0;
+
+            BenchmarkResult result;
+            result.name = name;
+            result.ok = mismatches == 0;
+            result.add("mismatches", static_cast<double>(mismatches));
+            result.add("ns_per_sample", meanNs / sampleCount);
+            result.add("gb_per_s", sampleCount * bytesPerSample / meanNs);
+            result.add("p99_ns_per_128_voices", percentile(times, 0.99));
+            printResult(options, result);
+            results.push_back(result);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+// layers/...: cost of velocity layers and round-robin alternates as the sample set grows.
+//
+// Writes a sample set of 88 keys x L layers x A alternates (short WAV files) to
+// --stream_dir, then times the directory scan, loading it on the loader pool, and
+// the note-on path: 64 note-ons at random keys and velocities are queued and one
+// frame is rendered; the same render without events is subtracted, leaving the
+// per-note-on cost of the layer lookup, round-robin step and voice setup. That cost
+// should not grow with the number of zones.
+
+#include "benchmark.h"
+#include "notenames.h"
+#include "pianoengine.h"
+#include "sampleset.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int outputRate = 44100;
+static const int fileFrames = outputRate / 50;  // 20 ms: small files, the set size is what matters
+static const int noteOnsPerRound = 64;
+
+void runLayerBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    static const struct {
+        int layers;
+        int alternates;
+    } shapes[] = {{1, 1}, {3, 2}, {8, 3}, {8, 10}};
+    static const char *const threeLayers[] = {"pp", "mf", "ff"};
+    static const char *const eightLayers[] = {"ppp", "pp", "p", "mp", "mf", "f", "ff", "fff"};
+
+    for (const auto &shape : shapes) {
+        const int zoneCount = 88 * shape.layers * shape.alternates;
+        const std::string name = "layers/zones:" + std::to_string(zoneCount) + "/layers:" +
+                                 std::to_string(shape.layers) + "/alternates:" + std::to_string(shape.alternates);
+        if (!matchesFilter(name, options)) {
+            continue;
+        }
+
+        BenchmarkResult result;
+        result.name = name;
+        const std::string dir = options.streamDir + "/pianobench-layers-" + std::to_string(zoneCount);
+        mkdir(dir.c_str(), 0755);
+        std::vector<std::string> files;
+        for (int note = 21; note <= 108 && result.ok; ++note) {
+            for (int layer = 0; layer < shape.layers && result.ok; ++layer) {
+                const char *dynamic = shape.layers == 1 ? "ff"
+                                    : shape.layers == 3 ? threeLayers[layer] : eightLayers[layer];
+                for (int alternate = 0; alternate < shape.alternates; ++alternate) {
+                    files.push_back(dir + "/Piano." + dynamic + "." + noteNameFromNumber(note) +
+                                    (alternate > 0 ? "." + std::to_string(alternate + 1) : "") + ".wav");
+                    if (!writeTestWav(files.back(), note, fileFrames, outputRate)) {
+                        std::fprintf(options.log, "%s: failed to write %s\n", name.c_str(), files.back().c_str());
+                        result.ok = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (result.ok) {
+            PianoEngine engine(outputRate, 2, options.bufferFrames);
+            engine.setNoteCutoff(0);
+
+            std::uint64_t start = benchmarkNow();
+            SampleSet set;
+            result.ok = set.scanDirectory(dir) && static_cast<int>(set.size()) == zoneCount;
+            const double scanNs = static_cast<double>(benchmarkNow() - start);
+
+            start = benchmarkNow();
+            engine.setSampleSet(set);
+            engine.loadSampleSetAsync();
+            engine.waitForLoading();
+            const double loadNs = static_cast<double>(benchmarkNow() - start);
+            result.ok = result.ok && engine.sampleCount() == zoneCount;
+
+            std::mt19937 random(1);
+            std::uniform_int_distribution<int> keys(21, 108);
+            std::uniform_real_distribution<float> velocities(0.05f, 1.0f);
+            std::vector<float> out(2);
+            std::vector<double> noteOnTimes;
+            const int rounds = options.buffers * options.repetitions;
+            for (int round = 0; round < rounds; ++round) {
+                engine.reset();
+                for (int i = 0; i < noteOnsPerRound; ++i) {
+                    engine.noteOn(keys(random), velocities(random));
+                }
+                start = benchmarkNow();
+                engine.render(out.data(), 1);  // Drains the note-ons and mixes one frame
+                const double withEvents = static_cast<double>(benchmarkNow() - start);
+                if (engine.activeVoiceCount() != noteOnsPerRound) {
+                    result.ok = false;
+                }
+                start = benchmarkNow();
+                engine.render(out.data(), 1);  // Same voices, no events
+                const double mixOnly = static_cast<double>(benchmarkNow() - start);
+                noteOnTimes.push_back(std::max(0.0, withEvents - mixOnly) / noteOnsPerRound);
+            }
+
+            result.add("zones", zoneCount);
+            result.add("scan_ms", scanNs / 1e6);
+            result.add("load_ms", loadNs / 1e6);
+            result.add("noteon_ns", percentile(noteOnTimes, 0.5));
+            result.add("noteon_p99_ns", percentile(noteOnTimes, 0.99));
+        }
+        printResult(options, result);
+        results.push_back(result);
+
+        for (const std::string &file : files) {
+            std::remove(file.c_str());
+        }
+        rmdir(dir.c_str());
+    }
+}
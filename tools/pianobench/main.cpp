@@ -0,0 +1,105 @@
+// pianobench - benchmarks for the real-time audio path
+//
+// Usage: pianobench [options]
+//   --benchmark_filter=<substring>   only run cases whose name contains this (e.g. "mix/", "bus/", "envelope/", "resonance/", "kernels/", "resample/", "stream/", "layers/", "sparse/", "parallel/", "realtime/", "midi/", "timing/", "queue")
+//   --benchmark_format=console|json  output format on stdout (default: console)
+//   --benchmark_out=<file.json>      also write JSON results to a file
+//   --buffer_frames=N                frames per simulated device buffer (default: 512)
+//   --buffers=N                      timed buffers per repetition (default: 64)
+//   --repetitions=N                  repetitions per case (default: 8)
+//   --events=N                       events pushed by queue_stress (default: 5000000)
+//   --period_us=N                    simulated render period for queue_stress (default: 50)
+//   --stream_dir=<dir>               where stream/, layers/ and sparse/ write their test WAV files (default: $TMPDIR or /tmp)
+//
+// Exits non-zero if any case reports an error.
+
+#include "benchmark.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static bool parseFlag(const char *arg, const char *name, const char *&value)
+{
+    const size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) == 0 && arg[length] == '=') {
+        value = arg + length + 1;
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    if (const char *tmp = std::getenv("TMPDIR")) {
+        options.streamDir = tmp;
+    }
+    bool jsonToStdout = false;
+    std::string outPath;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *value = nullptr;
+        if (parseFlag(argv[i], "--benchmark_filter", value)) {
+            options.filter = value;
+        } else if (parseFlag(argv[i], "--benchmark_format", value)) {
+            jsonToStdout = std::strcmp(value, "json") == 0;
+        } else if (parseFlag(argv[i], "--benchmark_out", value)) {
+            outPath = value;
+        } else if (parseFlag(argv[i], "--buffer_frames", value)) {
+            options.bufferFrames = std::atoi(value);
+        } else if (parseFlag(argv[i], "--buffers", value)) {
+            options.buffers = std::atoi(value);
+        } else if (parseFlag(argv[i], "--repetitions", value)) {
+            options.repetitions = std::atoi(value);
+        } else if (parseFlag(argv[i], "--events", value)) {
+            options.queueEvents = std::strtoull(value, nullptr, 10);
+        } else if (parseFlag(argv[i], "--period_us", value)) {
+            options.queuePeriodUs = std::strtoull(value, nullptr, 10);
+        } else if (parseFlag(argv[i], "--stream_dir", value)) {
+            options.streamDir = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s (see the top of tools/pianobench/main.cpp)\n", argv[i]);
+            return 2;
+        }
+    }
+    if (options.bufferFrames <= 0 || options.buffers <= 0 || options.repetitions <= 0) {
+        std::fprintf(stderr, "--buffer_frames, --buffers and --repetitions must be positive\n");
+        return 2;
+    }
+    if (jsonToStdout) {
+        options.log = stderr;  // Keep stdout clean for the JSON document
+    }
+
+    std::vector<BenchmarkResult> results;
+    runKernelBenchmarks(options, results);
+    runMixerBenchmarks(options, results);
+    runResampleBenchmarks(options, results);
+    runStreamBenchmarks(options, results);
+    runLayerBenchmarks(options, results);
+    runSparseBenchmarks(options, results);
+    runParallelBenchmarks(options, results);
+    runRealtimeChecks(options, results);
+    runMidiChecks(options, results);
+    runTimingChecks(options, results);
+    runQueueStress(options, results);
+
+    if (jsonToStdout) {
+        writeJson(stdout, results);
+    }
+    if (!outPath.empty()) {
+        std::FILE *file = std::fopen(outPath.c_str(), "w");
+        if (!file) {
+            std::fprintf(stderr, "Failed to open %s for writing\n", outPath.c_str());
+            return 1;
+        }
+        writeJson(file, results);
+        std::fclose(file);
+    }
+
+    for (const BenchmarkResult &result : results) {
+        if (!result.ok) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// midi/virtual: MIDI input parsing and delivery through the virtual input.
+//
+// Raw MIDI goes through VirtualMidiInput into an engine: a chord sent with running status,
+// with clock bytes between a message's data bytes and a system exclusive message in the
+// middle, velocity-0 note-offs, the sustain and soft pedals on another channel, and all
+// notes off. After a render the engine must hold exactly the chord's voices and the pedal
+// positions sent. All sound off must silence a chord the damper holds in the very next
+// render, where all notes off lets it ring. A MIDI pedal event and a UI pedal event queued together (the UI one
+// stamped later) must be applied in time order, whichever queue they came through.
+// Then a long stream of note-on/off pairs is timed through send() - parsing and pushing
+// to the engine's queue, the input thread's whole share - with a render between batches.
+
+#include "benchmark.h"
+#include "pianoengine.h"
+#include "virtualmidiinput.h"
+
+static const int outputRate = 44100;
+
+void runMidiChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    const std::string name = "midi/virtual";
+    if (!matchesFilter(name, options)) {
+        return;
+    }
+
+    PianoEngine engine(outputRate, 2, options.bufferFrames);
+    engine.setNoteCutoff(0);
+    for (int note = 21; note <= 108; ++note) {
+        // A second of a quiet sine: just something to play
+        TestTone tone;
+        tone.frequency = noteFrequency(note);
+        tone.level = 1000.0;
+        engine.setSample(note, makeTestSample(tone, outputRate, outputRate), outputRate, 2);
+    }
+    std::vector<std::int16_t> out(static_cast<std::size_t>(options.bufferFrames) * 2);
+
+    VirtualMidiInput midi;
+    std::string error;
+    BenchmarkResult result;
+    result.name = name;
+    result.ok = midi.start(&engine, "pianobench", &error);
+
+    // C major chord (running status, a clock byte inside a message, sysex in between), and an
+    // octave let go again by a velocity-0 note-on - the sustain pedal, down in the same block,
+    // holds it. The pedals are on channel 2.
+    const std::uint8_t chord[] = {
+        0x90, 60, 100, 64, 0xf8, 90,
+        0xf0, 0x7e, 0x7f, 0x09, 0x01, 0xf7,
+        0x90, 67, 80, 72, 70, 72, 0,
+        0xb1, 64, 127, 67, 64,
+        0xfe,
+    };
+    midi.send(chord, sizeof(chord));
+    engine.render(out.data(), options.bufferFrames);
+    const bool chordOk = engine.activeVoiceCount() == 4 && engine.damperPedal() == 1.0f &&
+                         engine.unaCorda() == 64 / 127.0f;
+    result.ok = result.ok && chordOk && midi.eventCount() == 7;
+
+    // All notes off with the damper up: the chord is released (and fades out)
+    const std::uint8_t release[] = {0xb1, 64, 0, 67, 0, 123, 0};
+    midi.send(release, sizeof(release));
+    for (int block = 0; block < outputRate / options.bufferFrames && engine.activeVoiceCount() > 0; ++block) {
+        engine.render(out.data(), options.bufferFrames);
+    }
+    result.ok = result.ok && engine.activeVoiceCount() == 0 && engine.damperPedal() == 0.0f;
+
+    // All sound off with the damper down: the chord is cut at once, and the pedal stays down
+    const std::uint8_t heldChord[] = {0xb0, 64, 127, 0x90, 60, 100, 64, 90, 67, 80};
+    const std::uint8_t notesOff[] = {0xb0, 123, 0};
+    const std::uint8_t soundOff[] = {120, 0};  // Running status
+    midi.send(heldChord, sizeof(heldChord));
+    engine.render(out.data(), options.bufferFrames);
+    const bool heldOk = engine.activeVoiceCount() == 3;
+    midi.send(notesOff, sizeof(notesOff));
+    engine.render(out.data(), options.bufferFrames);
+    const bool notesOffRing = engine.activeVoiceCount() == 3;  // Released, but the damper pedal holds them
+    midi.send(soundOff, sizeof(soundOff));
+    engine.render(out.data(), options.bufferFrames);
+    const bool soundOffOk = heldOk && notesOffRing && engine.activeVoiceCount() == 0 && engine.damperPedal() == 1.0f;
+    result.ok = result.ok && soundOffOk;
+    engine.setDamperPedal(0.0f);
+
+    // Two sources, applied in time order: the UI's pedal-down is the later event
+    const std::uint64_t now = NoteEvent::now();
+    const std::uint8_t pedalUp[] = {0xb0, 64, 0};
+    engine.setDamperPedal(1.0f, now - 1000000);
+    midi.send(pedalUp, sizeof(pedalUp), now - 2000000);
+    engine.render(out.data(), options.bufferFrames);
+    const bool orderOk = engine.damperPedal() == 1.0f;
+    result.ok = result.ok && orderOk;
+    engine.setDamperPedal(0.0f);
+
+    // Throughput: note-on/off pairs with running status, a render every 256 messages (the
+    // engine's queue holds 1024)
+    const int messages = 1 << 18;
+    const int batch = 256;
+    std::uint64_t sendNs = 0;
+    std::uint8_t stream[batch * 2 + 1];
+    for (int sent = 0; sent < messages; sent += batch) {
+        stream[0] = 0x90;
+        for (int i = 0; i < batch; i += 2) {
+            const std::uint8_t note = static_cast<std::uint8_t>(21 + (sent + i) / 2 % 88);
+            stream[1 + i * 2] = note;
+            stream[2 + i * 2] = 100;
+            stream[3 + i * 2] = note;
+            stream[4 + i * 2] = 0;
+        }
+        const std::uint64_t start = benchmarkNow();
+        midi.send(stream, sizeof(stream));
+        sendNs += benchmarkNow() - start;
+        engine.render(out.data(), options.bufferFrames);
+    }
+    result.ok = result.ok && midi.droppedCount() == 0;
+
+    result.add("chord_ok", chordOk ? 1 : 0);
+    result.add("sound_off_ok", soundOffOk ? 1 : 0);
+    result.add("time_order_ok", orderOk ? 1 : 0);
+    result.add("events", static_cast<double>(midi.eventCount()));
+    result.add("dropped", static_cast<double>(midi.droppedCount()));
+    result.add("ns_per_message", static_cast<double>(sendNs) / messages);
+    printResult(options, result);
+    results.push_back(result);
+}
@@ -0,0 +1,228 @@
+// mix/...: cost of PianoEngine::render per device buffer as polyphony grows.
+//
+// Each case triggers N voices on synthetic samples and times every buffer of a
+// short run (kept under the 1-second cutoff so the voice count stays constant).
+// Variants:
+//   rate:matched     samples at the output rate (direct-mix fast path)
+//   rate:mismatched  48 kHz samples on a 44.1 kHz output (resampling branch)
+//   sustain:1        damper down with short looped samples, so every voice is looping
+//   unacorda:1       soft pedal down (low-pass filter on the output)
+//   unacorda:2       same with the per-voice una corda: every voice is struck with the pedal
+//                    down and mixed on the muted bus, which is filtered and added to the mix
+//
+// bus/...: the float mix bus and master stage at 1, 32 and 128 voices, with unity
+// (plain accumulate) or scaled (gain kernel) velocities and the limiter on or off.
+// Compare with mix/ results of the same voice counts from before the float bus.
+//
+// envelope/...: 32 and 128 voices held at the sustain level, in a 5-second attack, or
+// released (note-off) with a 5-second release, so every buffer of the moving stages
+// is mixed through gain ramps. A ramping voice should cost about as much as a steady one.
+//
+// resonance/...: 1, 32 and 128 voices with the damper down, with the sympathetic resonance
+// bank off or on. The voices play notes below the bank, so all of its strings are driven;
+// the bank's cost (the difference) should not grow with the voice count.
+
+#include "benchmark.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+static const int outputRate = 44100;
+static const int mismatchedRate = 48000;
+
+// Deterministic stereo test signal: a decaying partial series plus a little noise,
+// different for every note so voices don't share cache lines
+static TestTone noteTone(int note)
+{
+    TestTone tone;
+    tone.frequency = noteFrequency(note);
+    tone.partials = 4;
+    tone.decay = 3.0;
+    tone.level = 1500.0;
+    tone.noise = 8.0;
+    tone.invertRight = true;
+    return tone;
+}
+
+static BenchmarkResult runCase(PianoEngine &engine, const BenchmarkOptions &options, const std::string &name,
+                               int voices, int noteCount, bool sustain, bool unaCorda, float velocity = 1.0f,
+                               bool releaseKeys = false)
+{
+    const int bufferFrames = options.bufferFrames;
+    std::vector<std::int16_t> out(static_cast<size_t>(bufferFrames) * engine.channels());
+    std::vector<double> bufferTimes;
+    bufferTimes.reserve(static_cast<size_t>(options.buffers) * options.repetitions);
+    bool voiceCountOk = true;
+
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        engine.reset();
+        if (sustain) {
+            engine.setDamperPedal(1.0f);
+        }
+        if (unaCorda) {
+            engine.setUnaCorda(1.0f);
+        }
+        for (int v = 0; v < voices; ++v) {
+            engine.noteOn(v % noteCount, velocity);
+        }
+        for (int note = 0; releaseKeys && note < std::min(voices, noteCount); ++note) {
+            engine.noteOff(note);
+        }
+
+        // Untimed warm-up buffer: drains the note-ons and, for sustain cases,
+        // runs the short samples into their loops
+        engine.render(out.data(), bufferFrames);
+        if (engine.activeVoiceCount() != voices) {
+            voiceCountOk = false;
+        }
+
+        for (int b = 0; b < options.buffers; ++b) {
+            const std::uint64_t start = benchmarkNow();
+            engine.render(out.data(), bufferFrames);
+            bufferTimes.push_back(static_cast<double>(benchmarkNow() - start));
+        }
+        if (engine.activeVoiceCount() != voices) {
+            voiceCountOk = false;
+        }
+    }
+
+    const double meanNs = std::accumulate(bufferTimes.begin(), bufferTimes.end(), 0.0) / bufferTimes.size();
+    const double maxNs = *std::max_element(bufferTimes.begin(), bufferTimes.end());
+    const double bufferNs = bufferFrames * 1e9 / engine.sampleRate();
+
+    BenchmarkResult result;
+    result.name = name;
+    result.ok = voiceCountOk;  // Voices dropping out mid-run would make the numbers meaningless
+    result.add("voices", voices);
+    result.add("buffer_frames", bufferFrames);
+    result.add("iterations", static_cast<double>(bufferTimes.size()));
+    result.add("ns_per_frame", meanNs / bufferFrames);
+    // Voice-milliseconds of audio produced per millisecond of CPU: how many such voices fit in real time
+    result.add("voices_per_cpu_ms", voices * bufferNs / meanNs);
+    result.add("mean_buffer_ns", meanNs);
+    result.add("p99_buffer_ns", percentile(bufferTimes, 0.99));
+    result.add("max_buffer_ns", maxNs);
+    result.add("dsp_load_pct", 100.0 * meanNs / bufferNs);
+    return result;
+}
+
+void runMixerBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    static const int voiceCounts[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+    const int noteCount = 128;  // Distinct samples; voices beyond this reuse them
+    const int longFrames = outputRate * 2;  // Outlasts the timed run
+    // Short samples whose 10 ms loop is reached inside the warm-up buffer -> every voice loops
+    const int loopStart = 64;
+    const int shortFrames = loopStart + outputRate / 100;
+
+    for (int mismatched = 0; mismatched <= 1; ++mismatched) {
+        for (int sustain = 0; sustain <= 1; ++sustain) {
+            // One engine per sample set; samples are built lazily so filtered-out cases cost nothing
+            std::unique_ptr<PianoEngine> engine;
+
+            for (int unaCorda = 0; unaCorda <= 2; ++unaCorda) {
+                for (int voices : voiceCounts) {
+                    const std::string name = "mix/voices:" + std::to_string(voices) +
+                                             "/rate:" + (mismatched ? "mismatched" : "matched") +
+                                             "/sustain:" + std::to_string(sustain) +
+                                             "/unacorda:" + std::to_string(unaCorda);
+                    if (!matchesFilter(name, options)) {
+                        continue;
+                    }
+                    if (!engine) {
+                        engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+                        for (int note = 0; note < noteCount; ++note) {
+                            const int rate = mismatched ? mismatchedRate : outputRate;
+                            engine->setSample(note, makeTestSample(noteTone(note), sustain ? shortFrames : longFrames, rate),
+                                              rate, 2,
+                                              sustain ? loopStart : -1, sustain ? shortFrames : -1);
+                        }
+                    }
+                    engine->setUnaCordaPerVoice(unaCorda == 2);
+                    BenchmarkResult result = runCase(*engine, options, name, voices, noteCount,
+                                                     sustain != 0, unaCorda != 0);
+                    printResult(options, result);
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    // Master bus: matched-rate voices only, so the bus and limiter are a visible share
+    static const int busVoiceCounts[] = {1, 32, 128};
+    std::unique_ptr<PianoEngine> engine;
+    for (int limiter = 0; limiter <= 1; ++limiter) {
+        for (float velocity : {1.0f, 0.7f}) {
+            for (int voices : busVoiceCounts) {
+                const std::string name = "bus/voices:" + std::to_string(voices) +
+                                         "/velocity:" + (velocity == 1.0f ? "1" : "0.7") +
+                                         "/limiter:" + std::to_string(limiter);
+                if (!matchesFilter(name, options)) {
+                    continue;
+                }
+                if (!engine) {
+                    engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+                    for (int note = 0; note < noteCount; ++note) {
+                        engine->setSample(note, makeTestSample(noteTone(note), longFrames, outputRate), outputRate, 2);
+                    }
+                }
+                engine->setLimiter(limiter != 0);
+                BenchmarkResult result = runCase(*engine, options, name, voices, noteCount, false, false, velocity);
+                printResult(options, result);
+                results.push_back(result);
+            }
+        }
+    }
+
+    // Envelope stages: steady, attacking, releasing
+    static const int envelopeVoiceCounts[] = {32, 128};
+    static const char *const stages[] = {"sustain", "attack", "release"};
+    engine.reset();  // A fresh engine: the bus cases leave their limiter setting behind
+    for (int stage = 0; stage < 3; ++stage) {
+        for (int voices : envelopeVoiceCounts) {
+            const std::string name = "envelope/voices:" + std::to_string(voices) + "/stage:" + stages[stage];
+            if (!matchesFilter(name, options)) {
+                continue;
+            }
+            if (!engine) {
+                engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+                for (int note = 0; note < noteCount; ++note) {
+                    engine->setSample(note, makeTestSample(noteTone(note), longFrames, outputRate), outputRate, 2);
+                }
+            }
+            EnvelopeSettings envelope;
+            envelope.attackMs = stage == 1 ? 5000.0 : 0.0;
+            envelope.releaseMs = stage == 2 ? 5000.0 : EnvelopeSettings::defaultReleaseMs;
+            engine->setEnvelope(envelope);
+            BenchmarkResult result = runCase(*engine, options, name, voices, noteCount, false, false, 1.0f,
+                                             stage == 2);
+            printResult(options, result);
+            results.push_back(result);
+        }
+    }
+
+    // Sympathetic resonance with every string free
+    static const int resonanceVoiceCounts[] = {1, 32, 128};
+    engine.reset();  // Default envelope again
+    for (int bank = 0; bank <= 1; ++bank) {
+        for (int voices : resonanceVoiceCounts) {
+            const std::string name = "resonance/voices:" + std::to_string(voices) + "/bank:" + std::to_string(bank);
+            if (!matchesFilter(name, options)) {
+                continue;
+            }
+            if (!engine) {
+                engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+                for (int note = 0; note < noteCount; ++note) {
+                    engine->setSample(note, makeTestSample(noteTone(note), longFrames, outputRate), outputRate, 2);
+                }
+            }
+            engine->setResonance(bank ? ResonanceBank::defaultLevel : 0.0f);
+            // Notes below the bank, so no string is left out for sounding itself
+            BenchmarkResult result = runCase(*engine, options, name, voices, ResonanceBank::lowestNote, true, false);
+            printResult(options, result);
+            results.push_back(result);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+// parallel/...: scaling of parallel voice rendering from 1 to N cores.
+//
+// 256 voices of 48 kHz samples on a 44.1 kHz output (every voice resampled at the
+// engine's default Cubic quality, the expensive case parallel rendering is for) are
+// rendered with the audio thread alone (cores:1, the serial mixer) and with 1 .. N-1
+// worker threads besides it, N being the hardware thread count (at least 2, so the
+// parallel path is exercised on any machine). Reports ns per frame, the speedup over
+// cores:1, the share of voice groups the workers mixed and the deadline misses.
+// Every parallel case must produce the same output, bit for bit: the groups are summed
+// in a fixed order whoever mixed them. A case whose output differs fails - unless it
+// missed the deadline, which leaves a late worker's groups out of a block by design.
+
+#include "benchmark.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <thread>
+
+static const int outputRate = 44100;
+static const int sampleRate = 48000;
+static const int benchVoices = 256;
+static const int noteCount = 64;
+
+// A decaying two-partial tone per note
+static TestTone noteTone(int note)
+{
+    TestTone tone;
+    tone.frequency = noteFrequency(note + 33);  // A1 up
+    tone.partials = 2;
+    tone.decay = 1.0;
+    tone.level = 1500.0;
+    tone.invertRight = true;
+    return tone;
+}
+
+void runParallelBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    const int maxCores = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+    std::unique_ptr<PianoEngine> engine;
+    std::vector<std::int16_t> reference;  // Output of the first parallel case
+    double serialNs = 0.0;
+
+    for (int cores = 1; cores <= maxCores; ++cores) {
+        const std::string name = "parallel/voices:" + std::to_string(benchVoices) + "/cores:" + std::to_string(cores);
+        if (!matchesFilter(name, options)) {
+            continue;
+        }
+        if (!engine) {
+            engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+            engine->setNoteCutoff(0);
+            for (int note = 0; note < noteCount; ++note) {
+                engine->setSample(note, makeTestSample(noteTone(note), sampleRate * 3, sampleRate), sampleRate, 2);
+            }
+        }
+        engine->setParallelRendering(cores - 1);
+        const std::uint64_t missesBefore = engine->parallelDeadlineMisses();
+        const std::uint64_t workerTasksBefore = engine->parallelWorkerTaskCount();
+
+        BenchmarkResult result;
+        result.name = name;
+        std::vector<std::int16_t> out(static_cast<size_t>(options.bufferFrames) * 2);
+        std::vector<std::int16_t> rendered;  // Every timed buffer of the first repetition
+        std::vector<double> bufferTimes;
+        for (int rep = 0; rep < options.repetitions; ++rep) {
+            engine->reset();
+            for (int v = 0; v < benchVoices; ++v) {
+                engine->noteOn(v % noteCount, 0.5f + 0.5f * (v % 7) / 7.0f);
+            }
+            // Untimed: drains the note-ons, all on the first frame (the buffer starts after
+            // them), so every run renders the same
+            engine->render(out.data(), options.bufferFrames, NoteEvent::now());
+            for (int b = 0; b < options.buffers; ++b) {
+                const std::uint64_t start = benchmarkNow();
+                engine->render(out.data(), options.bufferFrames);
+                bufferTimes.push_back(static_cast<double>(benchmarkNow() - start));
+                if (rep == 0) {
+                    rendered.insert(rendered.end(), out.begin(), out.end());
+                }
+            }
+            result.ok = result.ok && engine->activeVoiceCount() == benchVoices;
+        }
+
+        const double meanNs = std::accumulate(bufferTimes.begin(), bufferTimes.end(), 0.0) / bufferTimes.size();
+        const double bufferNs = options.bufferFrames * 1e9 / outputRate;
+        const std::uint64_t misses = engine->parallelDeadlineMisses() - missesBefore;
+        if (cores == 1) {
+            serialNs = meanNs;
+        } else if (misses > 0) {
+            // Groups were left out: nothing to compare
+        } else if (reference.empty()) {
+            reference = rendered;
+        } else if (rendered != reference) {
+            result.ok = false;  // Parallel output must not depend on the number of threads
+        }
+        const double tasks = static_cast<double>(options.repetitions) * (options.buffers + 1) *
+                             ((benchVoices + PianoEngine::voicesPerTask - 1) / PianoEngine::voicesPerTask);
+        result.add("threads", cores - 1);
+        result.add("realtime_threads", engine->parallelRealtimeThreads());
+        result.add("ns_per_frame", meanNs / options.bufferFrames);
+        if (serialNs > 0.0) {
+            result.add("speedup", serialNs / meanNs);
+        }
+        result.add("worker_share_pct",
+                   100.0 * static_cast<double>(engine->parallelWorkerTaskCount() - workerTasksBefore) / tasks);
+        result.add("deadline_misses", static_cast<double>(misses));
+        result.add("p99_buffer_ns", percentile(bufferTimes, 0.99));
+        result.add("dsp_load_pct", 100.0 * meanNs / bufferNs);
+        printResult(options, result);
+        results.push_back(result);
+    }
+    if (engine) {
+        engine->setParallelRendering(0);
+    }
+}
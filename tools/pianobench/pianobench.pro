@@ -0,0 +1,40 @@
+# Stand-alone benchmarks for the real-time audio path (no Qt, no Core Audio)
+QT -= core gui
+CONFIG += console c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+
+TARGET = pianobench
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp \
+    benchmark.cpp \
+    kernelbench.cpp \
+    layerbench.cpp \
+    midicheck.cpp \
+    mixerbench.cpp \
+    parallelbench.cpp \
+    queuestress.cpp \
+    realtimecheck.cpp \
+    resamplebench.cpp \
+    sparsebench.cpp \
+    timingcheck.cpp \
+    streambench.cpp
+
+HEADERS += \
+    benchmark.h
+
+include(../../src/engine.pri)
+include(../../src/midi.pri)
+
+# realtime/ looks up libc's lock functions behind its own
+linux {
+    LIBS += -ldl
+}
+
+# Always benchmark optimized code
+CONFIG -= debug
+CONFIG += release
+
+DESTDIR = $$PWD/../../build
+OBJECTS_DIR = $$PWD/../../build/obj/pianobench
@@ -0,0 +1,104 @@
+// queue_stress: pushes millions of note events from a producer thread (standing in
+// for the UI thread) while a simulated render loop drains the queue once per
+// "buffer", and reports how long the worst drain took.
+
+#include "benchmark.h"
+#include "noteeventqueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+static void spinFor(std::uint64_t nanoseconds)
+{
+    const std::uint64_t until = benchmarkNow() + nanoseconds;
+    while (benchmarkNow() < until) {
+        // Busy-wait to simulate mixing work without giving up the core
+    }
+}
+
+void runQueueStress(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    const std::string name = "queue_stress";
+    if (!matchesFilter(name, options)) {
+        return;
+    }
+
+    static NoteEventQueue queue;  // Static: the ring is too large to keep on the stack
+    const std::uint64_t eventCount = options.queueEvents;
+    const std::uint64_t periodNs = options.queuePeriodUs * 1000;
+    std::atomic<bool> producerDone(false);
+    std::uint64_t fullRetries = 0;
+
+    std::thread producer([&]() {
+        NoteEvent event;
+        std::memset(&event, 0, sizeof(event));
+        for (std::uint64_t i = 0; i < eventCount; ++i) {
+            event.type = (i % 8 == 7) ? NoteEvent::DamperPedal : NoteEvent::NoteOn;
+            event.note = static_cast<int>(i & 0x7fffffff);  // Sequence number for order checking
+            event.timestamp = NoteEvent::now();
+            while (!queue.push(event)) {
+                ++fullRetries;
+                std::this_thread::yield();
+            }
+        }
+        producerDone.store(true, std::memory_order_release);
+    });
+
+    // Simulated render loop: drain, then "mix" for one buffer period
+    std::vector<double> drainTimes;
+    drainTimes.reserve(1 << 20);
+    std::uint64_t received = 0;
+    std::uint64_t maxEventLatency = 0;
+    std::uint64_t maxBatch = 0;
+    bool orderOk = true;
+    const std::uint64_t startTime = benchmarkNow();
+
+    while (received < eventCount) {
+        const bool finished = producerDone.load(std::memory_order_acquire);
+        std::uint64_t batch = 0;
+        std::uint64_t oldest = 0;  // Timestamp of the batch's first event, the one that waited longest
+        const std::uint64_t drainStart = NoteEvent::now();
+        NoteEvent event;
+        while (queue.pop(event)) {
+            if (event.note != static_cast<int>(received & 0x7fffffff)) {
+                orderOk = false;
+            }
+            if (batch == 0) {
+                oldest = event.timestamp;
+            }
+            ++received;
+            ++batch;
+        }
+        const std::uint64_t drainEnd = NoteEvent::now();
+        if (batch > 0) {
+            maxEventLatency = std::max(maxEventLatency, drainEnd - oldest);
+        }
+        maxBatch = std::max(maxBatch, batch);
+        drainTimes.push_back(static_cast<double>(drainEnd - drainStart));
+        if (finished && batch == 0) {
+            break;
+        }
+        spinFor(periodNs);
+    }
+
+    producer.join();
+    const double elapsedMs = (benchmarkNow() - startTime) / 1e6;
+    const double worstDrain = *std::max_element(drainTimes.begin(), drainTimes.end());
+    const double cycles = static_cast<double>(drainTimes.size());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.ok = orderOk && received == eventCount;
+    result.add("events", static_cast<double>(received));
+    result.add("events_per_sec", received / (elapsedMs / 1e3));
+    result.add("drain_cycles", cycles);
+    result.add("max_batch", static_cast<double>(maxBatch));
+    result.add("p99_drain_ns", percentile(drainTimes, 0.99));
+    result.add("max_drain_ns", worstDrain);
+    result.add("max_event_latency_ns", static_cast<double>(maxEventLatency));
+    result.add("producer_retries", static_cast<double>(fullRetries));
+    printResult(options, result);
+    results.push_back(result);
+}
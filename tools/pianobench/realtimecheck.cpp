@@ -0,0 +1,223 @@
+// realtime/...: checks that PianoEngine::render never locks or allocates.
+//
+// A scripted session - notes struck faster than the polyphony limit allows (voice
+// stealing), note-offs, resampled and looped samples, a continuously moving damper and
+// una corda (on the whole bus for the first half, per voice for the second), the
+// limiter - is rendered block by block, with the rendering thread flagged while it is
+// inside render(). For the duration, this binary's replacements of operator new/delete
+// and (on Linux, where the executable can interpose libc's symbols)
+// pthread_mutex_lock/trylock and the rwlock calls count every call made from the flagged
+// thread. A condition variable wait needs a locked mutex, so it is caught as well.
+// Variants: threads:0 (the serial mixer) and threads:1 (parallel mixing, where the render
+// thread hands work to the pool). Any lock or allocation fails the case; so does a lock
+// check that can't see a deliberate std::mutex lock (the hooks aren't in effect).
+
+#include "benchmark.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <pthread.h>
+#define PIANOBENCH_LOCK_HOOKS 1
+#endif
+
+namespace {
+
+thread_local bool inRender = false;  // Set on the rendering thread around render()
+std::atomic<std::uint64_t> lockCalls(0);
+std::atomic<std::uint64_t> allocations(0);
+
+void countLock()
+{
+    if (inRender) {
+        lockCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void countAllocation()
+{
+    if (inRender) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+// Global allocation functions, counting calls from the render thread (the sized and
+// array forms route here through the standard library's defaults)
+void *operator new(std::size_t size)
+{
+    countAllocation();
+    if (void *memory = std::malloc(size != 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    if (memory) {
+        countAllocation();
+    }
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    operator delete(memory);
+}
+
+#ifdef PIANOBENCH_LOCK_HOOKS
+// libc's own implementation, looked up on first use (dlsym takes no pthread lock)
+template <typename Function>
+static Function nextSymbol(std::atomic<void *> &cache, const char *name)
+{
+    void *symbol = cache.load(std::memory_order_acquire);
+    if (!symbol) {
+        symbol = dlsym(RTLD_NEXT, name);
+        cache.store(symbol, std::memory_order_release);
+    }
+    return reinterpret_cast<Function>(symbol);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    static std::atomic<void *> next(nullptr);
+    countLock();
+    return nextSymbol<int (*)(pthread_mutex_t *)>(next, "pthread_mutex_lock")(mutex);
+}
+
+extern "C" int pthread_mutex_trylock(pthread_mutex_t *mutex)
+{
+    static std::atomic<void *> next(nullptr);
+    countLock();
+    return nextSymbol<int (*)(pthread_mutex_t *)>(next, "pthread_mutex_trylock")(mutex);
+}
+
+extern "C" int pthread_rwlock_rdlock(pthread_rwlock_t *lock)
+{
+    static std::atomic<void *> next(nullptr);
+    countLock();
+    return nextSymbol<int (*)(pthread_rwlock_t *)>(next, "pthread_rwlock_rdlock")(lock);
+}
+
+extern "C" int pthread_rwlock_wrlock(pthread_rwlock_t *lock)
+{
+    static std::atomic<void *> next(nullptr);
+    countLock();
+    return nextSymbol<int (*)(pthread_rwlock_t *)>(next, "pthread_rwlock_wrlock")(lock);
+}
+#endif
+
+static const int outputRate = 44100;
+static const int sessionPolyphony = 32;
+
+
+// Whether a deliberate lock on this thread is seen (the hooks are in effect)
+static bool lockHooksWork()
+{
+#ifdef PIANOBENCH_LOCK_HOOKS
+    std::mutex mutex;
+    const std::uint64_t before = lockCalls.load(std::memory_order_relaxed);
+    inRender = true;
+    mutex.lock();
+    inRender = false;
+    mutex.unlock();
+    return lockCalls.load(std::memory_order_relaxed) > before;
+#else
+    return false;
+#endif
+}
+
+void runRealtimeChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    for (int threads = 0; threads <= 1; ++threads) {
+        const std::string name = "realtime/lock_free/threads:" + std::to_string(threads);
+        if (!matchesFilter(name, options)) {
+            continue;
+        }
+        BenchmarkResult result;
+        result.name = name;
+        const bool lockCheck = lockHooksWork();
+#ifdef PIANOBENCH_LOCK_HOOKS
+        result.ok = lockCheck;  // Otherwise the lock count below would prove nothing
+#endif
+
+        PianoEngine engine(outputRate, 2, options.bufferFrames);
+        engine.setMaxPolyphony(sessionPolyphony);
+        engine.setEnvelope(EnvelopeSettings{5.0, 50.0, 0.7, 80.0});
+        engine.setNoteCutoff(0);
+        for (int note = 21; note <= 108; ++note) {
+            // Every other note off-rate, so the resampling path is exercised too
+            const int sampleRate = note % 2 ? 48000 : outputRate;
+            // Half a second of a decaying tone, with a sustain loop over its last 100 ms
+            const int frames = sampleRate / 2;
+            TestTone tone;
+            tone.frequency = noteFrequency(note);
+            tone.decay = 2.0;
+            tone.level = 6000.0;
+            engine.setSample(note, makeTestSample(tone, frames, sampleRate), sampleRate, 2, frames - sampleRate / 10,
+                             frames);
+        }
+        engine.setParallelRendering(threads);
+
+        std::vector<std::int16_t> out(static_cast<size_t>(options.bufferFrames) * 2);
+        const std::uint64_t locksBefore = lockCalls.load(std::memory_order_relaxed);
+        const std::uint64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+        const int blocks = options.buffers * options.repetitions;
+        std::uint64_t worstNs = 0;
+        for (int block = 0; block < blocks; ++block) {
+            // The producer's side of the session, between blocks
+            for (int strike = 0; strike < 3; ++strike) {
+                const int note = 21 + (block * 7 + strike * 19) % 88;
+                engine.noteOn(note, 0.3f + 0.7f * ((block + strike) % 5) / 4.0f);
+                if (block % 2) {
+                    engine.noteOff(21 + (note + 12 - 21) % 88);
+                }
+            }
+            engine.setDamperPedal(0.5f + 0.5f * static_cast<float>(std::sin(block / 20.0)));
+            engine.setUnaCorda(static_cast<float>(std::abs((block % 64) - 32)) / 32.0f);
+            engine.setUnaCordaPerVoice(block >= blocks / 2);
+
+            const std::uint64_t start = benchmarkNow();
+            inRender = true;
+            engine.render(out.data(), options.bufferFrames);
+            inRender = false;
+            worstNs = std::max(worstNs, benchmarkNow() - start);
+        }
+        const std::uint64_t locks = lockCalls.load(std::memory_order_relaxed) - locksBefore;
+        const std::uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+        result.ok = result.ok && locks == 0 && allocated == 0 && engine.stolenVoiceCount() > 0;
+
+        result.add("blocks", blocks);
+        result.add("locks_checked", lockCheck ? 1 : 0);
+        result.add("lock_calls", static_cast<double>(locks));
+        result.add("allocations", static_cast<double>(allocated));
+        result.add("stolen_voices", static_cast<double>(engine.stolenVoiceCount()));
+        result.add("worst_buffer_ns", static_cast<double>(worstNs));
+        printResult(options, result);
+        results.push_back(result);
+    }
+}
@@ -0,0 +1,123 @@
+// resample/...: cost and accuracy of each resampling tier.
+//
+// Each case calls resampleMix() directly for a bank of voices over a long sine
+// sample, timing whole buffers. Accuracy is measured separately by resampling a
+// single 1 kHz sine and comparing the result with the ideal sine at the output
+// rate; snr_db is the ratio of signal to that error.
+//   from:48000   downsampling to 44.1 kHz (the band-limited case)
+//   from:22050   upsampling to 44.1 kHz
+
+#include "benchmark.h"
+#include "mixkernels.h"
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const int outputRate = 44100;
+static const int voiceCount = 64;
+
+static std::vector<std::int16_t> makeSine(int sampleRate, double frequency, int frames)
+{
+    TestTone tone;
+    tone.frequency = frequency;
+    tone.level = 16000.0;
+    return makeTestSample(tone, frames, sampleRate);
+}
+
+// Signal-to-error ratio of a resampled 1 kHz sine, skipping the filter's edge frames
+static double measureSnr(ResampleQuality quality, const SincTable *table, int sourceRate)
+{
+    const double frequency = 1000.0;
+    const int outputFrames = 8192;
+    const std::vector<std::int16_t> pcm = makeSine(sourceRate, frequency, sourceRate);
+    std::vector<float> mix(static_cast<size_t>(outputFrames) * 2, 0.0f);
+    int frame = 0;
+    std::uint32_t fraction = 0;
+    resampleMix(quality, table, mix.data(), 2, outputFrames, pcm.data(), sourceRate, 2,
+                frame, fraction, resampleStep(sourceRate, outputRate), 1.0f);
+
+    double signal = 0.0;
+    double error = 0.0;
+    for (int i = SincTable::taps; i < outputFrames; ++i) {
+        const double ideal = 16000.0 * std::sin(2.0 * M_PI * frequency * i / outputRate);
+        const double difference = mix[i * 2] - ideal;
+        signal += ideal * ideal;
+        error += difference * difference;
+    }
+    return 10.0 * std::log10(signal / std::max(error, 1e-9));
+}
+
+void runResampleBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    static const ResampleQuality tiers[] = {
+        ResampleQuality::Nearest, ResampleQuality::Linear, ResampleQuality::Cubic, ResampleQuality::Sinc
+    };
+    static const int sourceRates[] = {48000, 22050};
+
+    for (int sourceRate : sourceRates) {
+        for (ResampleQuality quality : tiers) {
+            const std::string name = std::string("resample/") + resampleQualityName(quality) +
+                                     "/from:" + std::to_string(sourceRate);
+            if (!matchesFilter(name, options)) {
+                continue;
+            }
+
+            std::unique_ptr<SincTable> table;
+            if (quality == ResampleQuality::Sinc) {
+                table.reset(new SincTable(sourceRate, outputRate));
+            }
+            const std::uint64_t step = resampleStep(sourceRate, outputRate);
+            const int bufferFrames = options.bufferFrames;
+            const int totalFrames = bufferFrames * options.buffers;
+            // Long enough that no voice runs out during a repetition
+            const std::vector<std::int16_t> pcm =
+                makeSine(sourceRate, 440.0, static_cast<int>(step * totalFrames >> 32) + SincTable::taps * 2);
+            const int lengthFrames = static_cast<int>(pcm.size() / 2);
+            std::vector<float> mix(static_cast<size_t>(bufferFrames) * 2);
+            std::vector<int> frames(voiceCount);
+            std::vector<std::uint32_t> fractions(voiceCount);
+            std::vector<double> bufferTimes;
+            bufferTimes.reserve(static_cast<size_t>(options.buffers) * options.repetitions);
+
+            for (int rep = 0; rep < options.repetitions; ++rep) {
+                // Stagger the voices so they don't all share a phase
+                for (int v = 0; v < voiceCount; ++v) {
+                    frames[v] = v;
+                    fractions[v] = static_cast<std::uint32_t>(v) * 0x9e3779b9u;
+                }
+                for (int b = 0; b < options.buffers; ++b) {
+                    std::fill(mix.begin(), mix.end(), 0.0f);
+                    const std::uint64_t start = benchmarkNow();
+                    for (int v = 0; v < voiceCount; ++v) {
+                        resampleMix(quality, table.get(), mix.data(), 2, bufferFrames, pcm.data(),
+                                    lengthFrames, 2, frames[v], fractions[v], step,
+                                    0.5f / voiceCount);
+                    }
+                    bufferTimes.push_back(static_cast<double>(benchmarkNow() - start));
+                }
+            }
+
+            const double meanNs = std::accumulate(bufferTimes.begin(), bufferTimes.end(), 0.0) /
+                                  bufferTimes.size();
+            const double snr = measureSnr(quality, table.get(), sourceRate);
+
+            BenchmarkResult result;
+            result.name = name;
+            result.add("voices", voiceCount);
+            result.add("buffer_frames", bufferFrames);
+            result.add("iterations", static_cast<double>(bufferTimes.size()));
+            result.add("ns_per_voice_frame", meanNs / (static_cast<double>(voiceCount) * bufferFrames));
+            result.add("p99_buffer_ns", percentile(bufferTimes, 0.99));
+            result.add("snr_db", snr);
+            printResult(options, result);
+            results.push_back(result);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+// sparse/...: memory saved and CPU spent by pitch-shifting a sparse sample set.
+//
+// Writes 88 one-second keys to --stream_dir and loads every interval-th one (interval:1 is
+// the full set) with the pitch-shift range that covers the gaps, heap-loaded so the
+// resident size is the PCM itself. Then 32 voices are rendered on sampled keys (direct
+// mix) and 32 on keys in between (pitch-shifted through the resampler at the engine's
+// default Cubic quality), and the cost per voice per buffer is reported for both.
+
+#include "benchmark.h"
+#include "notenames.h"
+#include "pianoengine.h"
+#include "sampleset.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const int outputRate = 44100;
+static const int fileFrames = outputRate;  // Outlasts the timed run (the cutoff is off)
+static const int benchVoices = 32;
+
+// Mean render time per voice of one buffer, with `voices` note-ons spread over keys
+static double voiceCost(PianoEngine &engine, const BenchmarkOptions &options, const std::vector<int> &keys,
+                        bool &ok)
+{
+    std::vector<float> out(static_cast<size_t>(options.bufferFrames) * engine.channels());
+    std::vector<double> bufferTimes;
+    for (int rep = 0; rep < options.repetitions; ++rep) {
+        engine.reset();
+        for (int v = 0; v < benchVoices; ++v) {
+            engine.noteOn(keys[v % keys.size()]);
+        }
+        engine.render(out.data(), options.bufferFrames);  // Untimed: drains the note-ons
+        for (int b = 0; b < options.buffers; ++b) {
+            const std::uint64_t start = benchmarkNow();
+            engine.render(out.data(), options.bufferFrames);
+            bufferTimes.push_back(static_cast<double>(benchmarkNow() - start));
+        }
+        if (engine.activeVoiceCount() != benchVoices) {
+            ok = false;
+        }
+    }
+    return std::accumulate(bufferTimes.begin(), bufferTimes.end(), 0.0) / bufferTimes.size() / benchVoices;
+}
+
+void runSparseBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    static const int intervals[] = {1, 3, 4};
+    const std::string dir = options.streamDir + "/pianobench-sparse";
+    std::vector<std::string> files;
+    SampleSet full;
+    double fullBytes = 0.0;
+
+    for (int interval : intervals) {
+        const std::string name = "sparse/interval:" + std::to_string(interval);
+        if (!matchesFilter(name, options)) {
+            continue;
+        }
+        BenchmarkResult result;
+        result.name = name;
+
+        // The full set is written once, by the first case that runs
+        if (files.empty()) {
+            mkdir(dir.c_str(), 0755);
+            for (int note = 21; note <= 108; ++note) {
+                files.push_back(dir + "/Piano.ff." + noteNameFromNumber(note) + ".wav");
+                if (!writeTestWav(files.back(), note, fileFrames, outputRate)) {
+                    std::fprintf(options.log, "%s: failed to write %s\n", name.c_str(), files.back().c_str());
+                    result.ok = false;
+                    break;
+                }
+            }
+            result.ok = result.ok && full.scanDirectory(dir) && full.size() == 88;
+            fullBytes = 88.0 * fileFrames * 2 * sizeof(std::int16_t);
+        }
+
+        if (result.ok) {
+            PianoEngine engine(outputRate, 2, options.bufferFrames);
+            engine.setNoteCutoff(0);
+            engine.setMemoryMapping(false);
+            engine.setPitchShiftRange(interval / 2);
+            const SampleSet set = full.sparse(interval);
+            engine.setSampleSet(set);
+            engine.loadSampleSetAsync();
+            engine.waitForLoading();
+            result.ok = engine.sampleCount() == static_cast<int>(set.size());
+
+            std::vector<int> sampled;
+            std::vector<int> shifted;
+            for (int note = 21; note <= 108; ++note) {
+                const bool own = std::any_of(set.zones().begin(), set.zones().end(),
+                                             [note](const SampleZone &zone) { return zone.note == note; });
+                result.ok = result.ok && engine.hasSample(note);  // Every key plays, sampled or not
+                (own ? sampled : shifted).push_back(note);
+            }
+
+            const double resident = static_cast<double>(engine.residentSampleBytes());
+            result.add("samples", static_cast<double>(set.size()));
+            result.add("resident_mb", resident / (1024.0 * 1024.0));
+            result.add("ram_saved_pct", 100.0 * (1.0 - resident / fullBytes));
+            const double directNs = voiceCost(engine, options, sampled, result.ok);
+            result.add("voice_ns_direct", directNs);
+            if (!shifted.empty()) {
+                const double shiftedNs = voiceCost(engine, options, shifted, result.ok);
+                result.add("voice_ns_shifted", shiftedNs);
+                result.add("shift_cost_ratio", shiftedNs / directNs);
+            }
+        }
+        printResult(options, result);
+        results.push_back(result);
+    }
+
+    for (const std::string &file : files) {
+        std::remove(file.c_str());
+    }
+    if (!files.empty()) {
+        rmdir(dir.c_str());
+    }
+}
@@ -0,0 +1,119 @@
+// stream/...: how many disk-streamed voices can be sustained in real time.
+//
+// Writes a set of long 16-bit WAV files to --stream_dir, loads them with streaming
+// on (50 ms resident head, so almost everything comes through the reader thread)
+// and renders N voices paced at the real device rate, counting ring underruns.
+// A case is sustainable when underruns stay at zero. The files are usually still
+// in the page cache right after being written; drop caches (or point --stream_dir
+// at the disk under test and rerun) to include the device itself.
+//
+// Reports dsp load of the render thread and the disk throughput the voices need.
+
+#include "benchmark.h"
+#include "notenames.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <thread>
+
+static const int outputRate = 44100;
+static const int fileCount = 8;  // Distinct files, so voices don't all read the same pages
+static const int fileSeconds = 20;
+
+void runStreamBenchmarks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    static const int voiceCounts[] = {8, 32, 64, 128, 256};
+    std::vector<std::string> files;
+    std::unique_ptr<PianoEngine> engine;
+
+    for (int voices : voiceCounts) {
+        const std::string name = "stream/voices:" + std::to_string(voices);
+        if (!matchesFilter(name, options)) {
+            continue;
+        }
+
+        BenchmarkResult result;
+        result.name = name;
+        if (!engine) {
+            // Built on first use so filtered-out runs don't write anything
+            engine.reset(new PianoEngine(outputRate, 2, options.bufferFrames));
+            engine->setMaxPolyphony(256);
+            engine->setNoteCutoff(0);
+            engine->setStreaming(true, 50, 256);
+            std::vector<std::pair<int, std::string>> load;
+            for (int i = 0; i < fileCount; ++i) {
+                const int note = 60 + i;
+                files.push_back(options.streamDir + "/pianobench-stream-" + std::to_string(i) + ".wav");
+                if (!writeTestWav(files.back(), note, outputRate * fileSeconds, outputRate)) {
+                    std::fprintf(options.log, "%s: failed to write %s\n", name.c_str(), files.back().c_str());
+                    result.ok = false;
+                    break;
+                }
+                load.emplace_back(note, files.back());
+            }
+            if (result.ok && engine->loadSamples(load) != fileCount) {
+                result.ok = false;
+            }
+        }
+        if (!result.ok) {
+            printResult(options, result);
+            results.push_back(result);
+            break;
+        }
+
+        const int bufferFrames = options.bufferFrames;
+        std::vector<std::int16_t> out(static_cast<size_t>(bufferFrames) * 2);
+        const auto period = std::chrono::nanoseconds(static_cast<long long>(bufferFrames * 1e9 / outputRate));
+        std::vector<double> bufferTimes;
+
+        // Streams closed by the previous case are released by the reader thread
+        engine->reset();
+        while (engine->activeStreamCount() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const std::uint64_t underrunsBefore = engine->streamUnderrunCount();
+        const std::uint64_t unavailableBefore = engine->streamUnavailableCount();
+        for (int v = 0; v < voices; ++v) {
+            engine->noteOn(60 + v % fileCount);
+        }
+
+        // Paced like a device: one buffer per period, sleeping in between
+        auto deadline = std::chrono::steady_clock::now();
+        const int buffers = options.buffers * options.repetitions;
+        for (int b = 0; b < buffers; ++b) {
+            const std::uint64_t start = benchmarkNow();
+            engine->render(out.data(), bufferFrames);
+            bufferTimes.push_back(static_cast<double>(benchmarkNow() - start));
+            deadline += period;
+            std::this_thread::sleep_until(deadline);
+        }
+        const int activeVoices = engine->activeVoiceCount();
+        engine->reset();
+
+        const double meanNs = std::accumulate(bufferTimes.begin(), bufferTimes.end(), 0.0) / bufferTimes.size();
+        const double periodNs = static_cast<double>(period.count());
+        const std::uint64_t underruns = engine->streamUnderrunCount() - underrunsBefore;
+        const std::uint64_t unavailable = engine->streamUnavailableCount() - unavailableBefore;
+        result.ok = activeVoices == voices && unavailable == 0;
+        result.add("voices", voices);
+        result.add("buffers", buffers);
+        result.add("underruns", static_cast<double>(underruns));
+        result.add("unavailable", static_cast<double>(unavailable));
+        result.add("sustainable", underruns == 0 ? 1.0 : 0.0);
+        result.add("dsp_load_pct", 100.0 * meanNs / periodNs);
+        result.add("p99_buffer_ns", percentile(bufferTimes, 0.99));
+        result.add("disk_mb_per_s", voices * outputRate * 4.0 / (1024.0 * 1024.0));
+        result.add("cores", std::thread::hardware_concurrency());
+        printResult(options, result);
+        results.push_back(result);
+    }
+
+    engine.reset();
+    for (const std::string &file : files) {
+        std::remove(file.c_str());
+    }
+}
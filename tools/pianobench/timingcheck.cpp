@@ -0,0 +1,150 @@
+// timing/click_train: events applied on the frame their timestamp falls on.
+//
+// A click (one loud frame, then silence) is struck at irregular frame positions, queued
+// ahead with their timestamps and rendered in device-sized buffers given their own time:
+// the output must be exactly the click train, each click on its frame (plus the limiter's
+// lookahead) wherever it falls in a buffer. Then a held tone (a constant sample) takes an
+// una corda press and a note-off on frames of their own, and the output must start to
+// change right there - not at the start of the buffer they fell in.
+
+#include "benchmark.h"
+#include "pianoengine.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static const int outputRate = 44100;
+static const std::int16_t clickLevel = 20000;
+static const std::int16_t toneLevel = 8000;
+static const int clickNote = 60;
+static const int toneNote = 72;
+
+// Frame -> event clock, rounded up so that the engine's frame (rounded down) is the same one
+static std::uint64_t frameTime(std::uint64_t start, std::int64_t frame)
+{
+    return start + static_cast<std::uint64_t>((frame * 1000000000ll + outputRate - 1) / outputRate);
+}
+
+// Renders frames from start in buffers of bufferFrames, each given its time
+static std::vector<std::int16_t> renderFrom(PianoEngine &engine, std::uint64_t start, int frames, int bufferFrames)
+{
+    std::vector<std::int16_t> out(static_cast<std::size_t>(frames) * 2);
+    for (int frame = 0; frame < frames; frame += bufferFrames) {
+        const int count = std::min(bufferFrames, frames - frame);
+        engine.render(out.data() + static_cast<std::size_t>(frame) * 2, count,
+                      start + static_cast<std::uint64_t>(frame) * 1000000000ull / outputRate);
+    }
+    return out;
+}
+
+// Frames from due to the nearest click within range (range itself if there is none)
+static int clickError(const std::vector<std::int16_t> &out, int due, int range)
+{
+    for (int offset = 0; offset < range; ++offset) {
+        for (const int frame : {due - offset, due + offset}) {
+            if (frame >= 0 && static_cast<std::size_t>(frame) * 2 < out.size() && out[frame * 2] != 0) {
+                return offset;
+            }
+        }
+    }
+    return range;
+}
+
+// First frame from `from` on whose left channel differs from level by more than 1
+static int firstChange(const std::vector<std::int16_t> &out, int from, int level)
+{
+    for (std::size_t frame = from; frame * 2 < out.size(); ++frame) {
+        if (std::abs(out[frame * 2] - level) > 1) {
+            return static_cast<int>(frame);
+        }
+    }
+    return -1;
+}
+
+void runTimingChecks(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results)
+{
+    const std::string name = "timing/click_train";
+    if (!matchesFilter(name, options)) {
+        return;
+    }
+
+    PianoEngine engine(outputRate, 2, options.bufferFrames);
+    engine.setNoteCutoff(0);
+    engine.setResonance(0.0f);  // Nothing but the voices in the output
+    std::vector<std::int16_t> click(64 * 2, 0);
+    click[0] = click[1] = clickLevel;
+    engine.setSample(clickNote, click, outputRate, 2);
+    engine.setSample(toneNote, std::vector<std::int16_t>(static_cast<std::size_t>(outputRate) * 2 * 2, toneLevel),
+                     outputRate, 2);
+    const int latency = engine.outputLatency();
+
+    BenchmarkResult result;
+    result.name = name;
+
+    // Clicks 700 to 1600 frames apart, so they fall all over the buffers
+    const int clicks = 256;
+    std::vector<int> clickFrames;
+    for (int i = 0, frame = 100; i < clicks; ++i) {
+        clickFrames.push_back(frame);
+        frame += 700 + (i * 7919) % 900;
+    }
+    const int trainFrames = clickFrames.back() + latency + options.bufferFrames;
+    std::uint64_t start = NoteEvent::now();
+    std::vector<std::int16_t> expected(static_cast<std::size_t>(trainFrames) * 2, 0);
+    for (int frame : clickFrames) {
+        expected[static_cast<std::size_t>(frame + latency) * 2] = clickLevel;
+        expected[static_cast<std::size_t>(frame + latency) * 2 + 1] = clickLevel;
+    }
+    std::vector<std::int16_t> train(static_cast<std::size_t>(trainFrames) * 2);
+    int queued = 0;
+    int boundaryClicks = 0;  // Clicks on a buffer's first frame, where they used to snap to
+    std::uint64_t renderNs = 0;
+    for (int frame = 0; frame < trainFrames; frame += options.bufferFrames) {
+        // Queued a buffer or so ahead, the way a sequencer would
+        while (queued < clicks && clickFrames[queued] < frame + 2 * options.bufferFrames) {
+            engine.noteOn(clickNote, 1.0f, frameTime(start, clickFrames[queued]));
+            boundaryClicks += clickFrames[queued] % options.bufferFrames == 0 ? 1 : 0;
+            ++queued;
+        }
+        const int count = std::min(options.bufferFrames, trainFrames - frame);
+        const std::uint64_t before = benchmarkNow();
+        engine.render(train.data() + static_cast<std::size_t>(frame) * 2, count,
+                      start + static_cast<std::uint64_t>(frame) * 1000000000ull / outputRate);
+        renderNs += benchmarkNow() - before;
+    }
+    int worstError = 0;  // Frames between a click and where it was due
+    for (int frame : clickFrames) {
+        worstError = std::max(worstError, clickError(train, frame + latency, options.bufferFrames));
+    }
+    const bool trainOk = train == expected;
+
+    // The una corda pedal and a note-off on frames of their own, in the middle of buffers
+    engine.reset();
+    start = NoteEvent::now();
+    const int pedalFrame = options.bufferFrames * 3 + options.bufferFrames / 3 + 1;
+    const int releaseFrame = options.bufferFrames * 6 + options.bufferFrames * 2 / 3 + 1;
+    engine.noteOn(toneNote, 1.0f, frameTime(start, 0));
+    engine.setUnaCorda(1.0f, frameTime(start, pedalFrame));
+    std::vector<std::int16_t> tone = renderFrom(engine, start, pedalFrame + latency + options.bufferFrames,
+                                                options.bufferFrames);
+    const int pedalError = firstChange(tone, latency, toneLevel) - (pedalFrame + latency);
+
+    engine.reset();
+    start = NoteEvent::now();
+    engine.noteOn(toneNote, 1.0f, frameTime(start, 0));
+    engine.noteOff(toneNote, frameTime(start, releaseFrame));
+    tone = renderFrom(engine, start, releaseFrame + latency + options.bufferFrames, options.bufferFrames);
+    // The release ramp starts from the level the voice is at, so the frame after is the first lowered
+    const int releaseError = firstChange(tone, latency, toneLevel) - (releaseFrame + 1 + latency);
+
+    result.ok = trainOk && worstError == 0 && pedalError == 0 && releaseError == 0;
+    result.add("clicks", clicks);
+    result.add("on_boundary", boundaryClicks);
+    result.add("train_exact", trainOk ? 1 : 0);
+    result.add("onset_error_frames", worstError);
+    result.add("pedal_error_frames", pedalError);
+    result.add("release_error_frames", releaseError);
+    result.add("ns_per_frame", static_cast<double>(renderNs) / trainFrames);
+    printResult(options, result);
+    results.push_back(result);
+}
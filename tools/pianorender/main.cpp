@@ -0,0 +1,462 @@
+// pianorender - render a scripted note sequence to a WAV file, as fast as possible
+//
+// Usage: pianorender [options] <script.txt>
+//   -o <file.wav>       output file (default: out.wav)
+//   --samples <dir>     directory containing Piano.<dynamic>.<note>[.<n>].wav (default: src/NotesFF)
+//   --bank <file.pnb>   load every note from a packed bank instead (see tools/pianobank)
+//   --rate <hz>         output sample rate (default: 44100)
+//   --block <frames>    render block size (default: 512)
+//   --tail <ms>         extra time rendered after the last event (default: 2000)
+//   --polyphony <n>     maximum simultaneous voices (default: 256)
+//   --steal <policy>    voice to reuse when polyphony is exceeded: oldest | quietest (default: oldest)
+//   --resample <tier>   interpolation for off-rate samples: nearest | linear | cubic | sinc (default: cubic)
+//   --normalize         convert samples to the output format at load time
+//   --cache <dir>       with --normalize, keep converted samples in <dir> for the next run
+//   --no-mmap           copy samples to the heap instead of playing them from file mappings
+//   --prefetch <ms>     attack read in at load time for mapped samples (default: 1000)
+//   --cutoff <ms>       release notes without a note-off after this long, 0 = never (default: 1000)
+//   --envelope <a,d,s,r>  voice envelope: attack ms, decay ms, sustain level 0..1, release ms
+//                       (default: 0,0,1,150)
+//   --stream <ms>       keep only the first <ms> of each sample in memory and stream the rest
+//   --realtime          pace rendering at real time (needed for meaningful streaming results)
+//   --gain <dB>         master gain ahead of the limiter (default: 0)
+//   --no-limiter        hard-clip the mix bus at full scale instead of limiting it
+//   --resonance <level> sympathetic string resonance level, 0 = off (default: 0.25)
+//   --unacorda-per-voice  mute the notes struck with the una corda down instead of the whole mix
+//   --budget <MB>       keep at most this much sample data in memory, paging other layers in on use
+//   --threads <n>       mix voices in parallel on n worker threads plus the render thread (default: 0)
+//   --sparse <n>        with --samples, keep a sample only every n semitones (3 = minor thirds,
+//                       4 = major thirds) and pitch-shift the keys in between
+//   --telemetry <file>  append render telemetry (DSP load, cycle times, voices) to <file> as JSON
+//                       lines, and print a summary at the end; use with --realtime for soak tests
+//   --telemetry-interval <ms>  telemetry log interval (default: 1000)
+//
+// See example.txt for the script format.
+
+#include "notenames.h"
+#include "pianoengine.h"
+#include "rendertelemetry.h"
+#include "sampleset.h"
+#include "wavfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sys/resource.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ScriptEvent {
+    double timeMs;
+    NoteEvent::Type type;
+    int note;
+    float value;
+};
+
+static bool parseScript(const std::string &path, std::vector<ScriptEvent> &events)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::fprintf(stderr, "Failed to open script: %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream words(line);
+        ScriptEvent event;
+        std::string command;
+        if (!(words >> event.timeMs)) {
+            continue;  // Blank or comment-only line
+        }
+        if (!(words >> command)) {
+            std::fprintf(stderr, "%s:%d: missing command\n", path.c_str(), lineNumber);
+            return false;
+        }
+
+        event.note = -1;
+        event.value = 1.0f;
+        if (command == "on" || command == "off") {
+            std::string noteName;
+            words >> noteName;
+            event.note = noteNumberFromName(noteName);
+            if (event.note < 0) {
+                std::fprintf(stderr, "%s:%d: bad note '%s'\n", path.c_str(), lineNumber, noteName.c_str());
+                return false;
+            }
+            event.type = (command == "on") ? NoteEvent::NoteOn : NoteEvent::NoteOff;
+            if (event.type == NoteEvent::NoteOn) {
+                words >> event.value;  // Optional velocity
+            }
+        } else if (command == "damper" || command == "unacorda") {
+            event.type = (command == "damper") ? NoteEvent::DamperPedal : NoteEvent::UnaCorda;
+            if (!(words >> event.value)) {
+                std::fprintf(stderr, "%s:%d: missing pedal position\n", path.c_str(), lineNumber);
+                return false;
+            }
+        } else if (command == "soundoff") {
+            event.type = NoteEvent::AllSoundOff;
+        } else {
+            std::fprintf(stderr, "%s:%d: unknown command '%s'\n", path.c_str(), lineNumber, command.c_str());
+            return false;
+        }
+        events.push_back(event);
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const ScriptEvent &a, const ScriptEvent &b) { return a.timeMs < b.timeMs; });
+    return true;
+}
+
+// Script time (ms) on the engine's event clock, counted from start
+static std::uint64_t scriptTime(std::uint64_t start, double timeMs)
+{
+    return start + static_cast<std::uint64_t>(std::llround(timeMs * 1e6));
+}
+
+static void sendEvent(PianoEngine &engine, const ScriptEvent &event, std::uint64_t start)
+{
+    const std::uint64_t timestamp = scriptTime(start, event.timeMs);
+    switch (event.type) {
+    case NoteEvent::NoteOn:
+        engine.noteOn(event.note, event.value, timestamp);
+        break;
+    case NoteEvent::NoteOff:
+        engine.noteOff(event.note, timestamp);
+        break;
+    case NoteEvent::DamperPedal:
+        engine.setDamperPedal(event.value, timestamp);
+        break;
+    case NoteEvent::UnaCorda:
+        engine.setUnaCorda(event.value, timestamp);
+        break;
+    case NoteEvent::AllSoundOff:
+        engine.allSoundOff(timestamp);
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string scriptPath;
+    std::string outputPath = "out.wav";
+    std::string samplesDir = "src/NotesFF";
+    std::string bankPath;
+    int sampleRate = 44100;
+    int blockFrames = 512;
+    double tailMs = 2000.0;
+    int polyphony = PianoEngine::defaultMaxPolyphony;
+    VoicePool::StealPolicy stealPolicy = VoicePool::StealOldest;
+    ResampleQuality resampleQuality = ResampleQuality::Cubic;
+    bool validOptions = true;
+    bool normalize = false;
+    std::string cacheDir;
+    bool memoryMapping = true;
+    int prefetchMs = PianoEngine::defaultPrefetchMs;
+    int cutoffMs = PianoEngine::defaultNoteCutoffMs;
+    EnvelopeSettings envelope;
+    int streamPreloadMs = -1;
+    bool realtime = false;
+    double gainDb = 0.0;
+    bool limiter = true;
+    float resonance = ResonanceBank::defaultLevel;
+    bool unaCordaPerVoice = false;
+    double budgetMb = 0.0;
+    int sparseInterval = 1;
+    int renderThreads = 0;
+    std::string telemetryPath;
+    int telemetryIntervalMs = 1000;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "-o") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--samples") == 0 && hasValue) {
+            samplesDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--bank") == 0 && hasValue) {
+            bankPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--rate") == 0 && hasValue) {
+            sampleRate = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--block") == 0 && hasValue) {
+            blockFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--tail") == 0 && hasValue) {
+            tailMs = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--polyphony") == 0 && hasValue) {
+            polyphony = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--steal") == 0 && hasValue) {
+            stealPolicy = std::strcmp(argv[++i], "quietest") == 0 ? VoicePool::StealQuietest
+                                                                   : VoicePool::StealOldest;
+        } else if (std::strcmp(argv[i], "--resample") == 0 && hasValue) {
+            validOptions = parseResampleQuality(argv[++i], resampleQuality);
+        } else if (std::strcmp(argv[i], "--normalize") == 0) {
+            normalize = true;
+        } else if (std::strcmp(argv[i], "--cache") == 0 && hasValue) {
+            cacheDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-mmap") == 0) {
+            memoryMapping = false;
+        } else if (std::strcmp(argv[i], "--prefetch") == 0 && hasValue) {
+            prefetchMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cutoff") == 0 && hasValue) {
+            cutoffMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--envelope") == 0 && hasValue) {
+            validOptions = std::sscanf(argv[++i], "%lf,%lf,%lf,%lf", &envelope.attackMs, &envelope.decayMs,
+                                       &envelope.sustainLevel, &envelope.releaseMs) == 4;
+        } else if (std::strcmp(argv[i], "--stream") == 0 && hasValue) {
+            streamPreloadMs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (std::strcmp(argv[i], "--gain") == 0 && hasValue) {
+            gainDb = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--no-limiter") == 0) {
+            limiter = false;
+        } else if (std::strcmp(argv[i], "--resonance") == 0 && hasValue) {
+            resonance = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--unacorda-per-voice") == 0) {
+            unaCordaPerVoice = true;
+        } else if (std::strcmp(argv[i], "--budget") == 0 && hasValue) {
+            budgetMb = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sparse") == 0 && hasValue) {
+            sparseInterval = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            renderThreads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue) {
+            telemetryPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--telemetry-interval") == 0 && hasValue) {
+            telemetryIntervalMs = std::atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && scriptPath.empty()) {
+            scriptPath = argv[i];
+        } else {
+            scriptPath.clear();
+            break;
+        }
+    }
+    if (!validOptions || scriptPath.empty() || sampleRate <= 0 || blockFrames <= 0 || polyphony <= 0 ||
+        sparseInterval < 1 || sparseInterval / 2 > PianoEngine::maxPitchShift || telemetryIntervalMs <= 0) {
+        std::fprintf(stderr, "Usage: %s [-o out.wav] [--samples dir | --bank file] [--rate hz] [--block frames] "
+                             "[--tail ms] [--polyphony n] [--steal oldest|quietest] "
+                             "[--resample nearest|linear|cubic|sinc] [--normalize [--cache dir]] "
+                             "[--no-mmap] [--prefetch ms] [--cutoff ms] [--envelope a,d,s,r] [--stream ms] [--realtime] [--gain dB] "
+                             "[--no-limiter] [--resonance level] [--unacorda-per-voice] [--budget MB] [--sparse semitones] [--threads n] "
+                             "[--telemetry file [--telemetry-interval ms]] <script.txt>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<ScriptEvent> events;
+    if (!parseScript(scriptPath, events)) {
+        return 1;
+    }
+
+    PianoEngine engine(sampleRate, 2, blockFrames);
+    engine.setMaxPolyphony(polyphony);
+    engine.setVoiceStealPolicy(stealPolicy);
+    engine.setResampleQuality(resampleQuality);
+    engine.setSampleNormalization(normalize, cacheDir);
+    engine.setMemoryMapping(memoryMapping, prefetchMs);
+    engine.setNoteCutoff(cutoffMs);
+    engine.setEnvelope(envelope);
+    engine.setMasterGain(static_cast<float>(std::pow(10.0, gainDb / 20.0)));
+    engine.setLimiter(limiter);
+    engine.setResonance(resonance);
+    engine.setUnaCordaPerVoice(unaCordaPerVoice);
+    engine.setSampleMemoryBudget(static_cast<std::size_t>(budgetMb * 1024.0 * 1024.0));
+    if (streamPreloadMs >= 0) {
+        engine.setStreaming(true, streamPreloadMs);
+    }
+    engine.setPitchShiftRange(sparseInterval / 2);
+    engine.setParallelRendering(renderThreads);
+    // Without a bank, load only the samples the script actually uses
+    std::set<int> notes;
+    for (const ScriptEvent &event : events) {
+        if (event.type == NoteEvent::NoteOn) {
+            notes.insert(event.note);
+        }
+    }
+    int filesQueued = 0;
+    const auto loadStart = std::chrono::steady_clock::now();
+    double firstSampleMs = -1.0;
+    if (!bankPath.empty()) {
+        std::string error;
+        if (!engine.loadSampleBank(bankPath, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    } else {
+        SampleSet set;
+        std::string error;
+        if (!set.scanDirectory(samplesDir, "Piano", &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        // Sparse: the notes the script plays come from the nearest kept note (the lower one on
+        // a tie, as the engine picks them), so load those instead
+        const SampleSet kept = set.sparse(sparseInterval);
+        std::set<int> keptNotes;
+        for (const SampleZone &zone : kept.zones()) {
+            keptNotes.insert(zone.note);
+        }
+        std::vector<int> sources;
+        for (const int note : notes) {
+            for (int distance = 0; distance <= sparseInterval / 2; ++distance) {
+                if (keptNotes.count(note - distance) || keptNotes.count(note + distance)) {
+                    sources.push_back(keptNotes.count(note - distance) ? note - distance : note + distance);
+                    break;
+                }
+            }
+        }
+        engine.setSampleSet(kept.subset(sources));
+        if (sparseInterval > 1) {
+            std::printf("Sparse set: %zu of %zu samples kept (every %d semitones)\n", kept.size(), set.size(),
+                        sparseInterval);
+        }
+        // Same loader as the app: a thread pool publishing each sample as it is decoded
+        std::mutex reportMutex;
+        filesQueued = engine.loadSampleSetAsync([&](int, bool ok, const std::string &error) {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            if (!ok) {
+                std::fprintf(stderr, "Warning: %s\n", error.c_str());
+            } else if (firstSampleMs < 0.0) {
+                firstSampleMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - loadStart).count();
+            }
+        });
+        engine.waitForLoading();
+    }
+    const double loadMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - loadStart).count();
+
+    const double lastEventMs = events.empty() ? 0.0 : events.back().timeMs;
+    const size_t totalFrames = static_cast<size_t>((lastEventMs + tailMs) * sampleRate / 1000.0);
+    // The limiter lookahead delays the output: render that much more and drop it from
+    // the start, so notes land where the script puts them
+    const size_t latency = static_cast<size_t>(engine.outputLatency());
+    const size_t renderFrames = totalFrames + latency;
+    std::vector<float> output(renderFrames * engine.channels());
+
+    // Each block is timed into the telemetry the way the audio backends time theirs
+    RenderTelemetry telemetry;
+    TelemetryLog telemetryLog;
+    if (!telemetryPath.empty()) {
+        std::string error;
+        if (!telemetryLog.start(telemetryPath, telemetryIntervalMs, telemetry, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    // Events are handed to the engine before the block that contains their start time, stamped
+    // with their script time, and each block with the script time of its first frame: the
+    // engine starts every event on its own frame
+    const auto renderStart = std::chrono::steady_clock::now();
+    const std::uint64_t clockStart = NoteEvent::now();
+    size_t nextEvent = 0;
+    for (size_t frame = 0; frame < renderFrames; frame += blockFrames) {
+        const int frames = static_cast<int>(std::min<size_t>(blockFrames, renderFrames - frame));
+        const double blockEndMs = (frame + frames) * 1000.0 / sampleRate;
+        while (nextEvent < events.size() && events[nextEvent].timeMs < blockEndMs) {
+            sendEvent(engine, events[nextEvent++], clockStart);
+        }
+        const auto blockStart = std::chrono::steady_clock::now();
+        engine.render(output.data() + frame * engine.channels(), frames,
+                      clockStart + frame * 1000000000ull / sampleRate);
+        telemetry.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - blockStart).count(),
+                         frames, sampleRate, engine.activeVoiceCount(), engine.stolenVoiceCount(), 0);
+        if (realtime) {
+            std::this_thread::sleep_until(renderStart + std::chrono::microseconds(
+                static_cast<long long>(blockEndMs * 1000.0)));
+        }
+    }
+    const double renderMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - renderStart).count();
+    telemetryLog.stop();
+
+    std::string error;
+    if (!writeWavFile(outputPath, output.data() + latency * engine.channels(), totalFrames, sampleRate,
+                      engine.channels(), &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const double audioMs = totalFrames * 1000.0 / sampleRate;
+    std::printf("Loaded %d samples in %.1f ms", engine.sampleCount(), loadMs);
+    if (firstSampleMs >= 0.0) {
+        std::printf(" (first playable after %.1f ms)", firstSampleMs);
+    }
+    std::printf("\n");
+    std::printf("Resident sample data: %.2f MB\n", engine.residentSampleBytes() / (1024.0 * 1024.0));
+    if (budgetMb > 0.0) {
+        std::printf("Memory budget %.1f MB: %d files loaded up front, %.1f MB resident at the end, "
+                    "%llu note-ons played a stand-in layer\n", budgetMb, filesQueued,
+                    engine.residentSampleBytes() / (1024.0 * 1024.0),
+                    static_cast<unsigned long long>(engine.sampleFallbackCount()));
+    }
+    if (normalize) {
+        std::printf("Normalized to %d Hz: %d converted, %d from cache\n", sampleRate,
+                    engine.normalizationCache().misses(), engine.normalizationCache().hits());
+    }
+    std::printf("Rendered %.1f s of audio in %.1f ms (%.0fx real time) -> %s\n",
+                audioMs / 1000.0, renderMs, renderMs > 0.0 ? audioMs / renderMs : 0.0,
+                outputPath.c_str());
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        const double peakMb = usage.ru_maxrss / (1024.0 * 1024.0);  // Bytes on macOS
+#else
+        const double peakMb = usage.ru_maxrss / 1024.0;  // Kilobytes on Linux
+#endif
+        std::printf("Peak RSS %.1f MB, %ld major page faults\n", peakMb, usage.ru_majflt);
+    }
+    if (streamPreloadMs >= 0) {
+        std::printf("Streaming: %llu underruns, %llu note-ons without a free stream\n",
+                    static_cast<unsigned long long>(engine.streamUnderrunCount()),
+                    static_cast<unsigned long long>(engine.streamUnavailableCount()));
+    }
+    if (renderThreads > 0) {
+        std::printf("Parallel: %d worker threads (%d real-time), %llu voice groups mixed by workers, "
+                    "%llu deadline misses\n", engine.parallelThreads(), engine.parallelRealtimeThreads(),
+                    static_cast<unsigned long long>(engine.parallelWorkerTaskCount()),
+                    static_cast<unsigned long long>(engine.parallelDeadlineMisses()));
+    }
+    if (!telemetryPath.empty()) {
+        const RenderTelemetry::Snapshot totals = telemetry.snapshot();
+        std::printf("Telemetry: DSP load %.1f%% average, %.1f%% peak, longest block %.0f us, %llu deadline "
+                    "misses, up to %d voices -> %s\n", 100.0 * totals.load(), 100.0 * totals.peakLoad,
+                    totals.maxRenderNs / 1000.0, static_cast<unsigned long long>(totals.deadlineMisses),
+                    totals.peakVoices, telemetryPath.c_str());
+        std::printf("Block times:");
+        for (int i = 0; i < RenderTelemetry::histogramBuckets; ++i) {
+            if (totals.histogram[i] > 0) {
+                if (i + 1 < RenderTelemetry::histogramBuckets) {
+                    std::printf(" <%.0fus:%llu", RenderTelemetry::bucketLimitUs(i),
+                                static_cast<unsigned long long>(totals.histogram[i]));
+                } else {
+                    std::printf(" longer:%llu", static_cast<unsigned long long>(totals.histogram[i]));
+                }
+            }
+        }
+        std::printf("\n");
+    }
+    if (engine.limiterReduction() < 0.0) {
+        std::printf("Limiter: up to %.1f dB gain reduction\n", -engine.limiterReduction());
+    }
+    if (engine.stolenVoiceCount() > 0) {
+        std::printf("Stole %llu voices (polyphony limit %d)\n",
+                    static_cast<unsigned long long>(engine.stolenVoiceCount()), engine.maxPolyphony());
+    }
+    return 0;
+}
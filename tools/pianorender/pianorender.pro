@@ -0,0 +1,15 @@
+# Offline renderer: plays a scripted note sequence through PianoEngine into a WAV file
+QT -= core gui
+CONFIG += console c++17 sdk_no_version_check
+CONFIG -= qt app_bundle
+
+TARGET = pianorender
+TEMPLATE = app
+
+SOURCES += \
+    main.cpp
+
+include(../../src/engine.pri)
+
+DESTDIR = $$PWD/../../build
+OBJECTS_DIR = $$PWD/../../build/obj/pianorender